@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include "BatchRunner.hpp"
+#include "WorkStealingPool.hpp"
+#include "core/AudioFrontend.hpp"
+#include "core/Checkpoint.hpp"
+#include "core/Chip8.hpp"
+#include "core/NullFrontend.hpp"
+#include "core/ScriptedFrontend.hpp"
+
+bool loadManifest(const std::string &filePath, std::vector<BatchJob> &jobs, std::string &error)
+{
+    std::ifstream inFile(filePath);
+    std::string line;
+    unsigned long lineNumber = 0;
+
+    if (!inFile) {
+        error = "cannot open " + filePath;
+        return false;
+    }
+    while (std::getline(inFile, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        BatchJob job;
+
+        if (!(fields >> job.romPath))
+            continue;
+        if (!(fields >> job.cycles)) {
+            error = filePath + ":" + std::to_string(lineNumber) + ": missing cycle budget";
+            return false;
+        }
+        if (fields >> job.inputScript && job.inputScript == "-")
+            job.inputScript.clear();
+        fields >> job.seed;
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+static bool loadJobRom(Chip8 &chip8, const BatchJob &job, const RomPack *pack, std::string &error)
+{
+    if (pack == nullptr) {
+        if (!chip8.loadFile(job.romPath)) {
+            error = "cannot load " + job.romPath;
+            return false;
+        }
+        return true;
+    }
+
+    char *end;
+    std::uint64_t hash = std::strtoull(job.romPath.c_str(), &end, 16);
+    const RomPackEntry *entry = *end == '\0' ? pack->find(hash) : nullptr;
+    if (entry == nullptr) {
+        error = "not in pack " + job.romPath;
+        return false;
+    }
+    if (!chip8.loadRom(pack->data(*entry), entry->size)) {
+        error = "cannot load " + job.romPath;
+        return false;
+    }
+    return true;
+}
+
+// Points the thread's machine back at an idle frontend when the job
+// returns, as jobd's workers do, so it never keeps the job's frontends
+// past their lifetime.
+class IdleFrontendGuard {
+    public:
+        explicit IdleFrontendGuard(Chip8 &chip8) : chip8(chip8)
+        {
+        }
+        ~IdleFrontendGuard()
+        {
+            static thread_local NullFrontend idle;
+            chip8.setFrontend(idle);
+        }
+        IdleFrontendGuard(const IdleFrontendGuard &) = delete;
+        IdleFrontendGuard &operator=(const IdleFrontendGuard &) = delete;
+
+    private:
+        Chip8 &chip8;
+};
+
+BatchResult runBatchJob(const BatchJob &job, unsigned long cyclesPerFrame, const RomPack *pack)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    BatchResult result;
+    std::vector<InputEvent> events;
+
+    if (!job.inputScript.empty() && !loadInputScript(job.inputScript, events)) {
+        result.error = "bad input script " + job.inputScript;
+        return result;
+    }
+
+    ScriptedFrontend frontend(std::move(events));
+    // Nothing drains the ring, only the hash is kept.
+    std::unique_ptr<AudioFrontend> audio(job.hashAudio ? new AudioFrontend(frontend, AUDIO_SAMPLE_RATE, 0) : nullptr);
+    // One machine per thread, reset between jobs as jobd's workers do, so
+    // its block tables and JIT arena are allocated once per thread.
+    static thread_local Chip8 machine;
+    Chip8 &chip8 = machine;
+    // Declared after the frontends, so it runs before they go.
+    IdleFrontendGuard guard(chip8);
+    chip8.resetMemory();
+    if (!loadJobRom(chip8, job, pack, result.error))
+        return result;
+    if (job.overrideQuirks)
+        chip8.setQuirks(job.quirks);
+    chip8.setFrontend(audio != nullptr ? static_cast<Frontend &>(*audio) : frontend);
+    chip8.setSeed(job.seed);
+    // Frames follow the budget, a ROM halted in FX0A still sees its timers
+    // tick, but only what ran counts as cycles.
+    for (unsigned long budget = 0; budget < job.cycles; ++result.frames) {
+        unsigned long cycles = std::min(cyclesPerFrame, job.cycles - budget);
+        result.cycles += chip8.runFrame(cycles);
+        budget += cycles;
+    }
+
+    result.idleCycles = chip8.idleCyclesSkipped();
+    result.framebufferHash = hashDisplay(chip8.getDisplay());
+    if (audio != nullptr) {
+        audio->flush();
+        result.audioHash = audio->sampleHash();
+    }
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.ok = true;
+    return result;
+}
+
+std::vector<BatchResult> runBatch(const std::vector<BatchJob> &jobs, unsigned long cyclesPerFrame, unsigned int threads,
+                                  const RomPack *pack)
+{
+    std::vector<BatchResult> results(jobs.size());
+    WorkStealingPool pool(threads);
+
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+        pool.submit([&jobs, &results, cyclesPerFrame, pack, i] {
+            results[i] = runBatchJob(jobs[i], cyclesPerFrame, pack);
+        });
+    pool.wait();
+    return results;
+}
@@ -0,0 +1,47 @@
+#ifndef NESEMULATOR_BATCHRUNNER_HPP
+#define NESEMULATOR_BATCHRUNNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "core/Quirks.hpp"
+#include "core/RomPack.hpp"
+
+struct BatchJob {
+    std::string romPath;
+    unsigned long cycles = 0;
+    std::string inputScript;
+    std::uint32_t seed = 1;
+    // Render the buzzer and hash the samples.
+    bool hashAudio = false;
+    // Run under quirks instead of the quirk database's profile.
+    bool overrideQuirks = false;
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+};
+
+struct BatchResult {
+    bool ok = false;
+    std::string error;
+    // Instructions run, short of the budget while FX0A waits for a key.
+    unsigned long cycles = 0;
+    unsigned long frames = 0;
+    // Of cycles, how many idle loop iterations skipped.
+    std::uint64_t idleCycles = 0;
+    std::uint64_t framebufferHash = 0;
+    std::uint64_t audioHash = 0;
+    double wallSeconds = 0;
+};
+
+// Manifest lines: "<rom> <cycles> [input script|-] [seed]", '#' comments.
+// When running against a ROM pack, <rom> is the hex content hash.
+bool loadManifest(const std::string &filePath, std::vector<BatchJob> &jobs, std::string &error);
+
+// Runs one job headless and uncapped, cyclesPerFrame instructions between
+// two timer ticks. The ROM comes from pack when one is given.
+BatchResult runBatchJob(const BatchJob &job, unsigned long cyclesPerFrame, const RomPack *pack = nullptr);
+
+// Runs every job on a work-stealing pool, results in manifest order.
+std::vector<BatchResult> runBatch(const std::vector<BatchJob> &jobs, unsigned long cyclesPerFrame, unsigned int threads,
+                                  const RomPack *pack = nullptr);
+
+#endif //NESEMULATOR_BATCHRUNNER_HPP
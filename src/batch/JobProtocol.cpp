@@ -0,0 +1,74 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "JobProtocol.hpp"
+
+bool sendAll(int fd, const void *data, std::size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+    while (size > 0) {
+        // No SIGPIPE from a peer that went away, just the error.
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void *data, std::size_t size)
+{
+    unsigned char *bytes = static_cast<unsigned char *>(data);
+
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+int connectJobServer(const std::string &socketPath, std::string &error)
+{
+    sockaddr_un address{};
+
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        error = "socket path too long: " + socketPath;
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        error = socketPath + ": " + std::strerror(errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool runRemoteJob(int fd, const JobRequestHeader &header, const unsigned char *rom, const std::string &script,
+                  JobResponse &response)
+{
+    // Read even when sending fails: a server turning the connection away
+    // answers JOB_BUSY without reading the request and closes it.
+    bool sent = sendAll(fd, &header, sizeof(header)) && sendAll(fd, rom, header.romSize) &&
+                sendAll(fd, script.data(), header.scriptSize);
+    return receiveAll(fd, &response, sizeof(response)) && std::memcmp(response.magic, JOB_RESPONSE_MAGIC, 4) == 0 &&
+           response.version == JOB_PROTOCOL_VERSION && (sent || response.status == JOB_BUSY);
+}
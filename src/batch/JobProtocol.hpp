@@ -0,0 +1,100 @@
+#ifndef NESEMULATOR_JOBPROTOCOL_HPP
+#define NESEMULATOR_JOBPROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "core/Display.hpp"
+
+#define JOB_REQUEST_MAGIC "C8JQ"
+#define JOB_RESPONSE_MAGIC "C8JR"
+#define JOB_PROTOCOL_VERSION 1
+// Input scripts past this are refused as bad requests.
+#define JOB_MAX_SCRIPT_SIZE (1 << 20)
+
+// The job server's wire format over a Unix stream socket, fixed layout in
+// host byte order: both ends are on the same machine. A connection sends
+// one request at a time and reads its response before the next:
+//   request:  JobRequestHeader, romSize bytes of ROM, scriptSize bytes of
+//             input script ("<frame> <key> <down|up>" lines)
+//   response: JobResponse
+// With JOB_ROM_HASH the ROM is the 8 byte fnv1a64 of a ROM in the
+// server's pack instead of the image itself.
+#define JOB_ROM_HASH 0x0001
+
+struct JobRequestHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t flags;
+    std::uint64_t cycles;
+    std::uint32_t seed;
+    // From the request's arrival, queueing included. 0 for none.
+    std::uint32_t timeoutMilliseconds;
+    std::uint32_t romSize;
+    std::uint32_t scriptSize;
+};
+
+enum JobStatus {
+    JOB_OK,
+    // The queue was full, nothing ran: try again later. Also the only
+    // response on a connection past the server's limit, which it closes.
+    JOB_BUSY,
+    // Stopped at the deadline, the state is where it got to.
+    JOB_TIMEOUT,
+    // Unreadable header, the server closes the connection after it.
+    JOB_BAD_REQUEST,
+    JOB_BAD_ROM,
+    JOB_BAD_SCRIPT,
+    JOB_STATUS_COUNT
+};
+
+const char *const jobStatusNames[JOB_STATUS_COUNT] = {
+        "ok",
+        "busy",
+        "timeout",
+        "bad_request",
+        "bad_rom",
+        "bad_script",
+};
+
+// The machine after the job: its registers and the whole display, the
+// hash being hashDisplay's, as chip8_batch prints it.
+struct JobResponse {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t status;
+    // Instructions run, as chip8_batch counts them.
+    std::uint64_t cycles;
+    std::uint64_t frames;
+    std::uint64_t framebufferHash;
+    // Waiting for a worker, then running on it.
+    std::uint32_t queueMicroseconds;
+    std::uint32_t runMicroseconds;
+    std::uint16_t indexRegister;
+    std::uint16_t programCounter;
+    std::uint16_t stackPtr;
+    std::uint8_t delayTimer;
+    std::uint8_t soundTimer;
+    std::uint8_t reg[16];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint64_t planes[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS];
+};
+
+static_assert(sizeof(JobRequestHeader) == 32, "JobRequestHeader is part of the protocol");
+static_assert(sizeof(JobResponse) == 72 + sizeof(Display::planes), "JobResponse is part of the protocol");
+
+// Whole-buffer socket I/O, retried over short transfers and EINTR. Fail
+// on errors and on the peer closing first.
+bool sendAll(int fd, const void *data, std::size_t size);
+bool receiveAll(int fd, void *data, std::size_t size);
+
+// A connected stream socket to the server at socketPath, -1 on failure.
+int connectJobServer(const std::string &socketPath, std::string &error);
+
+// One request and its response over fd. False when the connection fails,
+// unless it was refused with JOB_BUSY first.
+bool runRemoteJob(int fd, const JobRequestHeader &header, const unsigned char *rom, const std::string &script,
+                  JobResponse &response);
+
+#endif //NESEMULATOR_JOBPROTOCOL_HPP
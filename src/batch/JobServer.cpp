@@ -0,0 +1,331 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include "JobServer.hpp"
+#include "core/Checkpoint.hpp"
+#include "core/NullFrontend.hpp"
+#include "core/ScriptedFrontend.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// Lives on its connection thread's stack until a worker marks it done.
+struct JobServer::Job {
+    JobRequestHeader header{};
+    std::vector<unsigned char> rom;
+    // rom, or the packed ROM its hash names.
+    const unsigned char *romData = nullptr;
+    std::size_t romSize = 0;
+    std::vector<InputEvent> events;
+    Clock::time_point arrival;
+    JobResponse response{};
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+};
+
+static std::uint32_t microsecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+JobServer::JobServer(const JobServerOptions &options) : options(options)
+{
+    if (this->options.workers == 0)
+        this->options.workers = 1;
+    for (unsigned int i = 0; i < this->options.workers; ++i)
+        machines.emplace_back(new Chip8());
+    for (unsigned int i = 0; i < this->options.workers; ++i)
+        workers.emplace_back(&JobServer::workerLoop, this, std::ref(*machines[i]));
+}
+
+JobServer::~JobServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        workersStopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool JobServer::listen(const std::string &path, std::string &error)
+{
+    sockaddr_un address{};
+
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = "socket path too long: " + path;
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0) {
+        error = path + ": " + std::strerror(errno);
+        close(fd);
+        return false;
+    }
+    listenFd = fd;
+    socketPath = path;
+    return true;
+}
+
+void JobServer::run()
+{
+    while (!stopping.load()) {
+        // Woken now and then to notice stop().
+        pollfd listening = {listenFd, POLLIN, 0};
+        if (poll(&listening, 1, 100) <= 0)
+            continue;
+
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        std::unique_lock<std::mutex> lock(connectionsMutex);
+        if (connections.size() >= options.maxConnections) {
+            lock.unlock();
+            refuseConnection(fd);
+            continue;
+        }
+        connections.insert(fd);
+        lock.unlock();
+        std::thread(&JobServer::serveConnection, this, fd).detach();
+    }
+
+    // Ends the reads of idle connections; one waiting for its job still
+    // gets the response.
+    std::unique_lock<std::mutex> lock(connectionsMutex);
+    for (int fd : connections)
+        shutdown(fd, SHUT_RDWR);
+    connectionClosed.wait(lock, [this] { return connections.empty(); });
+}
+
+void JobServer::stop()
+{
+    stopping.store(true);
+}
+
+JobServerStatistics JobServer::statistics() const
+{
+    JobServerStatistics statistics;
+
+    statistics.completed = completed.load();
+    statistics.timedOut = timedOut.load();
+    statistics.rejected = rejected.load();
+    return statistics;
+}
+
+// Answers busy without reading the request: the client gets the status
+// in place of its response, then the end of the stream.
+void JobServer::refuseConnection(int fd)
+{
+    JobResponse response{};
+
+    std::memcpy(response.magic, JOB_RESPONSE_MAGIC, 4);
+    response.version = JOB_PROTOCOL_VERSION;
+    response.status = JOB_BUSY;
+    sendAll(fd, &response, sizeof(response));
+    close(fd);
+    ++rejected;
+}
+
+// Blocks until the next request starts arriving or the connection ends,
+// without the receive timeout: a client may stay idle between requests.
+static bool waitForRequest(int fd)
+{
+    pollfd readable = {fd, POLLIN, 0};
+
+    for (;;) {
+        int ready = poll(&readable, 1, -1);
+        if (ready > 0)
+            return true;
+        if (ready < 0 && errno != EINTR)
+            return false;
+    }
+}
+
+void JobServer::serveConnection(int fd)
+{
+    JobRequestHeader header{};
+
+    // Bounds every recv, so a request stalled halfway, its header or its
+    // ROM and script, gives up the connection instead of keeping it.
+    if (options.receiveTimeoutMilliseconds != 0) {
+        timeval timeout{};
+        timeout.tv_sec = options.receiveTimeoutMilliseconds / 1000;
+        timeout.tv_usec = options.receiveTimeoutMilliseconds % 1000 * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    while (waitForRequest(fd) && receiveAll(fd, &header, sizeof(header))) {
+        Job job;
+        JobResponse &response = job.response;
+        bool valid = std::memcmp(header.magic, JOB_REQUEST_MAGIC, 4) == 0 && header.version == JOB_PROTOCOL_VERSION &&
+                     header.romSize <= MAX_ROM_SIZE && header.scriptSize <= JOB_MAX_SCRIPT_SIZE &&
+                     ((header.flags & JOB_ROM_HASH) == 0 || header.romSize == sizeof(std::uint64_t));
+
+        job.arrival = Clock::now();
+        job.header = header;
+        std::memcpy(response.magic, JOB_RESPONSE_MAGIC, 4);
+        response.version = JOB_PROTOCOL_VERSION;
+        if (!valid) {
+            // The rest of the stream cannot be framed any more.
+            response.status = JOB_BAD_REQUEST;
+            sendAll(fd, &response, sizeof(response));
+            break;
+        }
+
+        std::string script(header.scriptSize, '\0');
+        job.rom.resize(header.romSize);
+        if (!receiveAll(fd, job.rom.data(), job.rom.size()) || !receiveAll(fd, &script[0], script.size()))
+            break;
+        if (prepare(job, script)) {
+            if (submit(job)) {
+                std::unique_lock<std::mutex> lock(job.mutex);
+                job.finished.wait(lock, [&job] { return job.done; });
+            } else {
+                response.status = JOB_BUSY;
+                ++rejected;
+            }
+        }
+        if (!sendAll(fd, &response, sizeof(response)))
+            break;
+    }
+
+    // Untracked before closed: once closed, accept() can hand the same
+    // number to a new connection that run() must keep track of. Notified
+    // under the lock too, as run() and the server may be gone as soon as
+    // the lock is released.
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(fd);
+    close(fd);
+    connectionClosed.notify_all();
+}
+
+// Finds the ROM and parses the input script on the connection's thread,
+// so only runnable jobs reach the workers. Sets the status otherwise.
+bool JobServer::prepare(Job &job, const std::string &script)
+{
+    if (job.header.flags & JOB_ROM_HASH) {
+        std::uint64_t hash;
+        std::memcpy(&hash, job.rom.data(), sizeof(hash));
+        const RomPackEntry *entry = options.pack != nullptr ? options.pack->find(hash) : nullptr;
+        if (entry != nullptr) {
+            job.romData = options.pack->data(*entry);
+            job.romSize = entry->size;
+        }
+    } else {
+        job.romData = job.rom.data();
+        job.romSize = job.rom.size();
+    }
+    if (job.romSize == 0) {
+        job.response.status = JOB_BAD_ROM;
+        return false;
+    }
+
+    std::istringstream in(script);
+    if (!parseInputScript(in, job.events)) {
+        job.response.status = JOB_BAD_SCRIPT;
+        return false;
+    }
+    return true;
+}
+
+bool JobServer::submit(Job &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= options.queueCapacity)
+            return false;
+        queue.push_back(&job);
+    }
+    jobAvailable.notify_one();
+    return true;
+}
+
+void JobServer::workerLoop(Chip8 &chip8)
+{
+    NullFrontend idle;
+
+    for (;;) {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            jobAvailable.wait(lock, [this] { return workersStopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+            job = queue.front();
+            queue.pop_front();
+        }
+        runJob(chip8, *job);
+        // The job's frontend goes with it.
+        chip8.setFrontend(idle);
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            job->done = true;
+        }
+        job->finished.notify_one();
+    }
+}
+
+// As runBatchJob does, on the worker's own machine. The deadline is
+// checked between frames.
+void JobServer::runJob(Chip8 &chip8, Job &job)
+{
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = job.arrival + std::chrono::milliseconds(job.header.timeoutMilliseconds);
+    bool hasDeadline = job.header.timeoutMilliseconds != 0;
+    JobResponse &response = job.response;
+    ScriptedFrontend frontend(std::move(job.events));
+
+    chip8.resetMemory();
+    if (!chip8.loadRom(job.romData, job.romSize)) {
+        response.status = JOB_BAD_ROM;
+        return;
+    }
+    chip8.setFrontend(frontend);
+    chip8.setSeed(job.header.seed);
+    std::uint64_t budget = 0;
+    while (budget < job.header.cycles && !(hasDeadline && Clock::now() >= deadline)) {
+        unsigned long cycles = std::min<std::uint64_t>(options.cyclesPerFrame, job.header.cycles - budget);
+        response.cycles += chip8.runFrame(cycles);
+        budget += cycles;
+        ++response.frames;
+    }
+
+    const Display &display = chip8.getDisplay();
+    response.status = budget < job.header.cycles ? JOB_TIMEOUT : JOB_OK;
+    response.framebufferHash = hashDisplay(display);
+    response.indexRegister = chip8.indexRegister;
+    response.programCounter = chip8.programCounter;
+    response.stackPtr = chip8.stackPtr;
+    response.delayTimer = chip8.delayTimer;
+    response.soundTimer = chip8.soundTimer;
+    std::memcpy(response.reg, chip8.reg, sizeof(response.reg));
+    response.width = display.width;
+    response.height = display.height;
+    std::memcpy(response.planes, display.planes, sizeof(response.planes));
+    response.queueMicroseconds = microsecondsBetween(job.arrival, start);
+    response.runMicroseconds = microsecondsBetween(start, Clock::now());
+    if (response.status == JOB_TIMEOUT)
+        ++timedOut;
+    else
+        ++completed;
+}
@@ -0,0 +1,88 @@
+#ifndef NESEMULATOR_JOBSERVER_HPP
+#define NESEMULATOR_JOBSERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "JobProtocol.hpp"
+#include "core/Chip8.hpp"
+#include "core/RomPack.hpp"
+#include "core/Scheduler.hpp"
+
+struct JobServerOptions {
+    unsigned int workers = std::thread::hardware_concurrency();
+    // Jobs waiting for a worker before new ones are answered busy.
+    std::size_t queueCapacity = 64;
+    // Connections served at once; the ones past it get a JOB_BUSY
+    // response and are closed.
+    std::size_t maxConnections = 256;
+    // Longest silence in the middle of a request before its connection
+    // is dropped, 0 for none. Waiting for the next request is not timed.
+    unsigned int receiveTimeoutMilliseconds = 5000;
+    unsigned long cyclesPerFrame = DEFAULT_IPS / TIMER_FREQUENCY;
+    // Where JOB_ROM_HASH requests find their ROM, refused without one.
+    const RomPack *pack = nullptr;
+};
+
+struct JobServerStatistics {
+    std::uint64_t completed = 0;
+    std::uint64_t timedOut = 0;
+    std::uint64_t rejected = 0;
+};
+
+// Runs ROM jobs for clients on a Unix socket, see JobProtocol.hpp, so a
+// job costs a round trip instead of starting a process. Each worker
+// thread owns one headless Chip8, allocated up front and reset between
+// jobs. Every connection has a thread reading its requests into a bounded
+// queue the workers take from; a request finding the queue full is
+// answered JOB_BUSY straight away rather than waiting, as is a connection
+// past maxConnections.
+class JobServer {
+    public:
+        explicit JobServer(const JobServerOptions &options);
+        ~JobServer();
+        JobServer(const JobServer &) = delete;
+        JobServer &operator=(const JobServer &) = delete;
+        // Binds socketPath, replacing whatever is there.
+        bool listen(const std::string &socketPath, std::string &error);
+        // Serves connections until stop(), then waits for the jobs already
+        // accepted and closes every connection.
+        void run();
+        // Only sets a flag, safe from a signal handler.
+        void stop();
+        JobServerStatistics statistics() const;
+    private:
+        struct Job;
+        void refuseConnection(int fd);
+        void serveConnection(int fd);
+        bool prepare(Job &job, const std::string &script);
+        bool submit(Job &job);
+        void workerLoop(Chip8 &chip8);
+        void runJob(Chip8 &chip8, Job &job);
+        JobServerOptions options;
+        int listenFd = -1;
+        std::string socketPath;
+        std::atomic<bool> stopping{false};
+        std::atomic<std::uint64_t> completed{0};
+        std::atomic<std::uint64_t> timedOut{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::mutex queueMutex;
+        std::condition_variable jobAvailable;
+        std::deque<Job *> queue;
+        bool workersStopping = false;
+        std::vector<std::unique_ptr<Chip8>> machines;
+        std::vector<std::thread> workers;
+        // Connection threads are detached; run() waits for this to empty.
+        std::mutex connectionsMutex;
+        std::condition_variable connectionClosed;
+        std::set<int> connections;
+};
+
+#endif //NESEMULATOR_JOBSERVER_HPP
@@ -0,0 +1,105 @@
+#include "WorkStealingPool.hpp"
+
+WorkStealingPool::WorkStealingPool(unsigned int threads)
+{
+    if (threads == 0)
+        threads = 1;
+    for (unsigned int i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (unsigned int i = 0; i < threads; ++i)
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+unsigned int WorkStealingPool::size() const
+{
+    return workers.size();
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    Queue &queue = *queues[nextQueue++ % queues.size()];
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++pending;
+    }
+    {
+        // Counted before any worker can take it, or its decrement could
+        // come first and wrap the count.
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        ++queued;
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // A worker checks queued and goes to sleep under stateMutex: taking
+        // it here means none is between the two when notified.
+        std::lock_guard<std::mutex> lock(stateMutex);
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+
+    allDone.wait(lock, [this] { return pending == 0; });
+}
+
+bool WorkStealingPool::pop(unsigned int worker, std::function<void()> &task)
+{
+    Queue &queue = *queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned int worker, std::function<void()> &task)
+{
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        Queue &victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned int worker)
+{
+    std::function<void()> task;
+
+    while (true) {
+        if (pop(worker, task) || steal(worker, task)) {
+            --queued;
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--pending == 0)
+                allDone.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
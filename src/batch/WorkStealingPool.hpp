@@ -0,0 +1,46 @@
+#ifndef NESEMULATOR_WORKSTEALINGPOOL_HPP
+#define NESEMULATOR_WORKSTEALINGPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One task deque per worker. A worker pops the newest task of its own
+// deque and, once empty, steals the oldest task of another worker, so long
+// jobs submitted together still spread over every core.
+class WorkStealingPool {
+    public:
+        explicit WorkStealingPool(unsigned int threads = std::thread::hardware_concurrency());
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+        void submit(std::function<void()> task);
+        void wait();
+        unsigned int size() const;
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+        bool pop(unsigned int worker, std::function<void()> &task);
+        bool steal(unsigned int worker, std::function<void()> &task);
+        void workerLoop(unsigned int worker);
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<unsigned int> nextQueue{0};
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        // Submitted but not finished, guarded by stateMutex.
+        std::size_t pending = 0;
+        // Submitted but not picked up yet, lets idle workers sleep.
+        std::atomic<std::size_t> queued{0};
+        bool stopping = false;
+};
+
+#endif //NESEMULATOR_WORKSTEALINGPOOL_HPP
@@ -0,0 +1,97 @@
+#include "AudioFrontend.hpp"
+#include "Scheduler.hpp"
+
+AudioFrontend::AudioFrontend(Frontend &inner, unsigned int sampleRate, std::size_t ringSize) : inner(inner),
+    rate(sampleRate), buzzer(sampleRate), ring(ringSize)
+{
+    frameSamples.reserve(sampleRate / TIMER_FREQUENCY + 1);
+}
+
+AudioFrontend::~AudioFrontend()
+{
+    flush();
+}
+
+void AudioFrontend::setWavWriter(WavWriter *writer)
+{
+    wav = writer;
+}
+
+SampleRing &AudioFrontend::samples()
+{
+    return ring;
+}
+
+unsigned int AudioFrontend::sampleRate() const
+{
+    return rate;
+}
+
+std::uint64_t AudioFrontend::sampleHash() const
+{
+    return hash;
+}
+
+unsigned long AudioFrontend::renderedSamples() const
+{
+    return rendered;
+}
+
+unsigned long AudioFrontend::droppedSamples() const
+{
+    return dropped;
+}
+
+void AudioFrontend::flush()
+{
+    if (!frameStarted)
+        return;
+    frameStarted = false;
+
+    sampleRemainder += rate;
+    frameSamples.resize(sampleRemainder / TIMER_FREQUENCY);
+    sampleRemainder %= TIMER_FREQUENCY;
+    buzzer.render(heard, frameSamples.data(), frameSamples.size());
+    heard = buzzerOn;
+
+    for (std::int16_t sample : frameSamples) {
+        unsigned char bytes[2] = {static_cast<unsigned char>(sample & 0xFF),
+                                  static_cast<unsigned char>((sample >> 8) & 0xFF)};
+        hash = fnv1a64(bytes, sizeof(bytes), hash);
+    }
+    rendered += frameSamples.size();
+
+    std::size_t queued = ring.write(frameSamples.data(), frameSamples.size());
+    dropped += frameSamples.size() - queued;
+    if (wav != nullptr) {
+        std::int16_t drained[256];
+        std::size_t count;
+
+        while ((count = ring.read(drained, sizeof(drained) / sizeof(drained[0]))) > 0)
+            wav->write(drained, count);
+    }
+}
+
+bool AudioFrontend::isOpen() const
+{
+    return inner.isOpen();
+}
+
+void AudioFrontend::pollInput(InputQueue &events)
+{
+    flush();
+    frameStarted = true;
+    inner.pollInput(events);
+}
+
+void AudioFrontend::present(const Display &display, std::uint64_t changedRows)
+{
+    inner.present(display, changedRows);
+}
+
+void AudioFrontend::setBuzzer(bool on)
+{
+    buzzerOn = on;
+    heard |= on;
+    inner.setBuzzer(on);
+}
@@ -0,0 +1,66 @@
+#ifndef NESEMULATOR_AUDIOFRONTEND_HPP
+#define NESEMULATOR_AUDIOFRONTEND_HPP
+
+#include <cstdint>
+#include <vector>
+#include "Buzzer.hpp"
+#include "Frontend.hpp"
+#include "Hash.hpp"
+#include "SampleRing.hpp"
+#include "WavWriter.hpp"
+
+#define AUDIO_SAMPLE_RATE 44100
+// About 190 ms at 44.1 kHz.
+#define AUDIO_RING_SIZE 8192
+
+// Turns the buzzer into samples while passing everything through to
+// another frontend. Audio follows emulated time, not the wall clock: every
+// frame (a pollInput call marks the start of the next one) adds
+// sampleRate / 60 samples, with the tone on if the buzzer was on at any
+// point during the frame.
+//
+// Samples go to a ring a real-time sink drains from its own thread. A full
+// ring drops the new samples, emulation never waits for the device. With a
+// WavWriter attached the ring is drained into it at the end of every frame
+// instead, so nothing is dropped and the file only depends on the frames
+// run, however fast they ran.
+class AudioFrontend : public Frontend {
+    public:
+        explicit AudioFrontend(Frontend &inner, unsigned int sampleRate = AUDIO_SAMPLE_RATE,
+                               std::size_t ringSize = AUDIO_RING_SIZE);
+        AudioFrontend(const AudioFrontend &) = delete;
+        AudioFrontend &operator=(const AudioFrontend &) = delete;
+        // Renders the frame in progress.
+        ~AudioFrontend() override;
+        void setWavWriter(WavWriter *writer);
+        SampleRing &samples();
+        unsigned int sampleRate() const;
+        // Renders the frame in progress now rather than at the next poll.
+        void flush();
+        // FNV-1a over every sample rendered, as little-endian 16-bit.
+        std::uint64_t sampleHash() const;
+        unsigned long renderedSamples() const;
+        unsigned long droppedSamples() const;
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+    private:
+        Frontend &inner;
+        unsigned int rate;
+        Buzzer buzzer;
+        SampleRing ring;
+        WavWriter *wav = nullptr;
+        std::vector<std::int16_t> frameSamples;
+        // Carries rate % 60 over to the next frames.
+        unsigned int sampleRemainder = 0;
+        bool frameStarted = false;
+        bool buzzerOn = false;
+        // Buzzer was on at some point of the frame in progress.
+        bool heard = false;
+        std::uint64_t hash = FNV_OFFSET_BASIS;
+        unsigned long rendered = 0;
+        unsigned long dropped = 0;
+};
+
+#endif //NESEMULATOR_AUDIOFRONTEND_HPP
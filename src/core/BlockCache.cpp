@@ -0,0 +1,165 @@
+#ifdef CHIP8_DISPATCH_PREDECODED
+
+#include <algorithm>
+#include <atomic>
+#include "BlockCache.hpp"
+#include "Chip8.hpp"
+
+BlockCache::Tables &BlockCache::own()
+{
+    if (tables.use_count() > 1) {
+        std::shared_ptr<Tables> copy = std::make_shared<Tables>();
+        copy->blocks = tables->blocks;
+        copy->entries.reserve(MAX_ENTRIES);
+        copy->entries = tables->entries;
+        copy->codeRegions = tables->codeRegions;
+        tables = copy;
+        return *tables;
+    }
+    // Sole owner: the forks that let go released their counts, this puts
+    // their reads of the tables before the writes to come.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *tables;
+}
+
+// Every translated block starts at one of the entries' addresses, so only
+// those are reset. Shared tables are let go rather than copied only to be
+// emptied.
+void BlockCache::flush()
+{
+    if (tables == nullptr)
+        return;
+    if (tables.use_count() > 1) {
+        tables.reset();
+        return;
+    }
+    Tables &owned = own();
+    for (const Entry &entry : owned.entries)
+        owned.blocks[entry.address] = Block();
+    owned.entries.clear();
+    owned.codeRegions.reset();
+}
+
+void BlockCache::invalidate(unsigned int address, unsigned int length)
+{
+    if (tables == nullptr)
+        return;
+
+    unsigned int end = std::min<unsigned int>(address + length, MEMORY_SIZE);
+    bool code = false;
+    for (unsigned int region = address / REGION_SIZE; region <= (end - 1) / REGION_SIZE && !code; ++region)
+        code = tables->codeRegions[region];
+    if (!code)
+        return;
+
+    unsigned int first = address >= MAX_BLOCK_LENGTH ? address - MAX_BLOCK_LENGTH + 1 : 0;
+
+    for (unsigned int start = first; start < end; ++start) {
+        const Block &block = tables->blocks[start];
+        if (block.count != 0 && start + block.length > address)
+            own().blocks[start] = Block();
+    }
+}
+
+const BlockCache::Entry *BlockCache::find(const PagedMemory &memory, unsigned short address, unsigned short &count)
+{
+    if (tables == nullptr) {
+        tables = std::make_shared<Tables>();
+        tables->blocks.resize(MEMORY_SIZE);
+        tables->entries.reserve(MAX_ENTRIES);
+    }
+
+    if (tables->blocks[address].count == 0)
+        translate(memory, own().blocks[address], address);
+    const Block &block = tables->blocks[address];
+    count = block.count;
+    return tables->entries.data() + block.first;
+}
+
+static bool isSkip(unsigned char kind)
+{
+    return kind == JMP_EQ || kind == JMP_NEQ || kind == JMP_EQ_REG || kind == JMP_NEQ_REG ||
+           kind == JMP_KEY_PRESSED || kind == JMP_NKEY_PRESSED;
+}
+
+// What has to be the last instruction of a block: anything that moves the
+// PC elsewhere, stops the machine, or writes memory that may hold the rest
+// of the block.
+static bool endsBlock(unsigned char kind)
+{
+    return isSkip(kind) || kind == GOTO || kind == SUBR_CALL || kind == RETURN || kind == JMP_TO ||
+           kind == GET_KEY || kind == EXIT || kind == STORES_BINARY || kind == REG_DUMP || kind == SAVE_RANGE;
+}
+
+// The tables are owned by the time this runs.
+void BlockCache::translate(const PagedMemory &memory, Block &block, unsigned short address)
+{
+    Entry decoded[MAX_BLOCK_INSTRUCTIONS];
+    unsigned int count = 0;
+    // Wider than the PC so a block stops at the top of memory instead of
+    // running on from 0.
+    unsigned int pc = address;
+    unsigned int end = address;
+
+    while (count < MAX_BLOCK_INSTRUCTIONS) {
+        if (pc + 1 >= MEMORY_SIZE)
+            break;
+
+        unsigned short opcode = memory.readWord(pc);
+        unsigned char kind = Chip8::decode(opcode);
+        unsigned int length = kind == SET_I_LONG ? 4 : 2;
+
+        if (pc + length > MEMORY_SIZE)
+            break;
+        decoded[count++] = {kind, 1, static_cast<unsigned short>(pc), {opcode, 0, 0}};
+        pc += length;
+        end = pc;
+        if (endsBlock(kind))
+            break;
+    }
+
+    std::vector<Entry> &entries = tables->entries;
+    if (entries.size() + count > MAX_ENTRIES)
+        flush();
+    block.first = entries.size();
+    for (unsigned int i = 0; i < count; ++i) {
+        Entry entry = decoded[i];
+        unsigned char next = i + 1 < count ? decoded[i + 1].kind : static_cast<unsigned char>(UNKNOWN);
+        unsigned char third = i + 2 < count ? decoded[i + 2].kind : static_cast<unsigned char>(UNKNOWN);
+
+        if (entry.kind == SET_VAL && next == SET_I && third == DRAW_SPRITE)
+            entry.kind = SET_VAL_SET_I_DRAW;
+        else if (entry.kind == SET_VAL && next == SET_I)
+            entry.kind = SET_VAL_SET_I;
+        else if (entry.kind == SET_I && next == DRAW_SPRITE)
+            entry.kind = SET_I_DRAW;
+        else if (entry.kind == SET_VAL && next == SET_VAL)
+            entry.kind = SET_VAL_SET_VAL;
+        else if (entry.kind == SET_I && next == REG_LOAD)
+            entry.kind = SET_I_REG_LOAD;
+        else if (entry.kind == ADD_I && next == REG_LOAD)
+            entry.kind = ADD_I_REG_LOAD;
+        else if (entry.kind == ADD_VAL && (next == JMP_EQ || next == JMP_NEQ) && i + 2 == count &&
+                 end + 1 < MEMORY_SIZE && Chip8::decode(memory.readWord(end)) == GOTO) {
+            // The jump the skip steps over sits right after the block.
+            entry.kind = next == JMP_EQ ? ADD_VAL_JMP_EQ_GOTO : ADD_VAL_JMP_NEQ_GOTO;
+            entry.opcodes[2] = memory.readWord(end);
+            end += 2;
+        }
+        if (entry.kind > UNKNOWN) {
+            entry.instructions = entry.kind == SET_VAL_SET_I_DRAW || entry.kind == ADD_VAL_JMP_EQ_GOTO ||
+                                 entry.kind == ADD_VAL_JMP_NEQ_GOTO ? 3 : 2;
+            entry.opcodes[1] = decoded[i + 1].opcodes[0];
+            if (entry.kind == SET_VAL_SET_I_DRAW)
+                entry.opcodes[2] = decoded[i + 2].opcodes[0];
+            i += entry.kind == SET_VAL_SET_I_DRAW ? 2 : 1;
+        }
+        entries.push_back(entry);
+    }
+    block.count = entries.size() - block.first;
+    block.length = end - address;
+    for (unsigned int region = address / REGION_SIZE; region < (end + REGION_SIZE - 1) / REGION_SIZE; ++region)
+        tables->codeRegions[region] = true;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef NESEMULATOR_BLOCKCACHE_HPP
+#define NESEMULATOR_BLOCKCACHE_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "PagedMemory.hpp"
+
+// Predecoded straight-line runs for the predecoded dispatch, keyed by
+// start address. A block is every instruction up to and including the
+// first jump, call, return, skip, memory write, FX0A or 00FD, each fetched
+// and decoded once; common pairs and triples are fused into one
+// superinstruction entry. Memory writes drop exactly the blocks whose
+// bytes they touch.
+class BlockCache {
+    public:
+        struct Entry {
+            // An OpCode, or a Superinstruction for a fused run.
+            unsigned char kind;
+            // Instructions the entry stands for. A fused skip that is taken
+            // runs one fewer.
+            unsigned char instructions;
+            unsigned short address;
+            unsigned short opcodes[3];
+        };
+
+        BlockCache() = default;
+        // Copies share the translations until either side changes them.
+        BlockCache(const BlockCache &) = default;
+        BlockCache &operator=(const BlockCache &) = delete;
+        // The entries of the block at address, translated on a miss, and
+        // their count. 0 where not even one instruction fits in memory.
+        const Entry *find(const PagedMemory &memory, unsigned short address, unsigned short &count);
+        void invalidate(unsigned int address, unsigned int length);
+        void flush();
+    private:
+        struct Block {
+            std::uint32_t first = 0;
+            unsigned short count = 0;
+            unsigned short length = 0;
+        };
+        static const unsigned short MAX_BLOCK_INSTRUCTIONS = 32;
+        // All of them F000 NNNN, or a fused 7XNN 3XNN 1NNN reaching past
+        // its closing skip.
+        static const unsigned short MAX_BLOCK_LENGTH = MAX_BLOCK_INSTRUCTIONS * 4;
+        static const std::size_t MAX_ENTRIES = 1 << 16;
+        static const unsigned int REGION_SIZE = 256;
+        struct Tables {
+            // One per start address, count 0 until translated.
+            std::vector<Block> blocks;
+            std::vector<Entry> entries;
+            // Regions any block was translated from since the last flush,
+            // so writes to data elsewhere skip the scan for blocks.
+            std::bitset<MEMORY_SIZE / REGION_SIZE> codeRegions;
+        };
+        // The tables, copied first if a fork still shares them.
+        Tables &own();
+        void translate(const PagedMemory &memory, Block &block, unsigned short address);
+        std::shared_ptr<Tables> tables;
+};
+
+#endif //NESEMULATOR_BLOCKCACHE_HPP
@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Buzzer.hpp"
+
+// Gate fade length.
+static const double rampSeconds = 0.002;
+
+// Residual subtracted around a step at t = 0 (t is the phase in [0, 1)
+// and dt the phase increment), turning the naive edge into a band-limited
+// one.
+static double polyBlep(double t, double dt)
+{
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0;
+    }
+    if (t > 1.0 - dt) {
+        t = (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+Buzzer::Buzzer(unsigned int sampleRate, double frequency, std::int16_t amplitude) :
+    increment(frequency / sampleRate), gainStep(1.0 / (sampleRate * rampSeconds)), amplitude(amplitude)
+{
+}
+
+void Buzzer::render(bool on, std::int16_t *out, std::size_t count)
+{
+    // Silent and staying so: only the phase moves.
+    if (!on && gain == 0) {
+        std::memset(out, 0, count * sizeof(std::int16_t));
+        phase = std::fmod(phase + increment * count, 1.0);
+        return;
+    }
+
+    double target = on ? 1.0 : 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        double value = phase < 0.5 ? 1.0 : -1.0;
+        double falling = phase + 0.5;
+
+        value += polyBlep(phase, increment);
+        value -= polyBlep(falling >= 1.0 ? falling - 1.0 : falling, increment);
+        gain = on ? std::min(target, gain + gainStep) : std::max(target, gain - gainStep);
+        out[i] = static_cast<std::int16_t>(std::lround(value * gain * amplitude));
+        phase += increment;
+        if (phase >= 1.0)
+            phase -= 1.0;
+    }
+}
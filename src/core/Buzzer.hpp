@@ -0,0 +1,29 @@
+#ifndef NESEMULATOR_BUZZER_HPP
+#define NESEMULATOR_BUZZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#define BUZZER_FREQUENCY 440
+#define BUZZER_AMPLITUDE 8000
+
+// Square wave oscillator for the sound timer. The edges are band-limited
+// with PolyBLEP so the tone does not alias at low sample rates, and the
+// gate fades in and out over a couple of milliseconds instead of clicking.
+// Only plain double arithmetic, so the same calls give the same samples.
+class Buzzer {
+    public:
+        explicit Buzzer(unsigned int sampleRate, double frequency = BUZZER_FREQUENCY,
+                        std::int16_t amplitude = BUZZER_AMPLITUDE);
+        // Appends count samples with the gate on or off. The oscillator
+        // keeps running while off, so a tone resumes in phase.
+        void render(bool on, std::int16_t *out, std::size_t count);
+    private:
+        double phase = 0;
+        double increment;
+        double gain = 0;
+        double gainStep;
+        std::int16_t amplitude;
+};
+
+#endif //NESEMULATOR_BUZZER_HPP
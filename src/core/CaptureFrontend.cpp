@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <fstream>
+#include "CaptureFrontend.hpp"
+#include "Scheduler.hpp"
+
+bool parseCaptureFormat(const std::string &name, CaptureFormat &format)
+{
+    if (name == "raw")
+        format = CAPTURE_RAW;
+    else if (name == "y4m")
+        format = CAPTURE_Y4M;
+    else if (name == "png")
+        format = CAPTURE_PNG;
+    else
+        return false;
+    return true;
+}
+
+static const std::array<std::uint32_t, 256> crcTable = [] {
+    std::array<std::uint32_t, 256> table{};
+
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        table[i] = crc;
+    }
+    return table;
+}();
+
+static void putBigEndian(std::vector<unsigned char> &out, std::uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void putChunk(std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data)
+{
+    std::uint32_t crc = 0xFFFFFFFF;
+
+    putBigEndian(out, data.size());
+    std::size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    for (std::size_t i = start; i < out.size(); ++i)
+        crc = crcTable[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+    putBigEndian(out, crc ^ 0xFFFFFFFF);
+}
+
+// Packed 2-bit rows, each prefixed with PNG filter type 0, wrapped in a
+// zlib stream of stored deflate blocks: frames are tiny and mostly
+// written once, so not compressing keeps the encoder trivial and fast.
+static void encodePng(std::vector<unsigned char> &out, const std::vector<unsigned char> &rows,
+                      std::uint32_t width, std::uint32_t height)
+{
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data = {0x78, 0x01};
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+
+    out.assign(signature, signature + sizeof(signature));
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), {2, 0, 0, 0, 0});
+    putChunk(out, "IHDR", header);
+
+    for (std::size_t offset = 0; offset < rows.size(); offset += 0xFFFF) {
+        std::size_t length = std::min<std::size_t>(rows.size() - offset, 0xFFFF);
+        data.push_back(offset + length == rows.size());
+        data.push_back(length & 0xFF);
+        data.push_back(length >> 8);
+        data.push_back(~length & 0xFF);
+        data.push_back((~length >> 8) & 0xFF);
+        data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + length);
+    }
+    for (unsigned char byte : rows) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBigEndian(data, b << 16 | a);
+    putChunk(out, "IDAT", data);
+    putChunk(out, "IEND", {});
+}
+
+CaptureFrontend::CaptureFrontend(Frontend &inner, CaptureFormat format, const std::string &path,
+                                 unsigned int scale, std::size_t queueDepth)
+        : inner(inner), format(format), path(path), scale(scale > 0 ? scale : 1),
+          queueDepth(queueDepth > 0 ? queueDepth : 1)
+{
+    if (format != CAPTURE_PNG) {
+        file = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            failed = true;
+    }
+    if (file != nullptr && format == CAPTURE_Y4M)
+        std::fprintf(file, "YUV4MPEG2 W%u H%u F%d:1 Ip A1:1 Cmono\n",
+                     DISPLAY_WIDTH * this->scale, DISPLAY_HEIGHT * this->scale, TIMER_FREQUENCY);
+    thread = std::thread(&CaptureFrontend::encodeLoop, this);
+}
+
+CaptureFrontend::~CaptureFrontend()
+{
+    if (frameStarted)
+        endFrame();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    thread.join();
+    if (file != nullptr && file != stdout)
+        std::fclose(file);
+    else if (file != nullptr)
+        std::fflush(file);
+}
+
+bool CaptureFrontend::good() const
+{
+    return !failed.load();
+}
+
+bool CaptureFrontend::isOpen() const
+{
+    return inner.isOpen();
+}
+
+void CaptureFrontend::pollInput(InputQueue &events)
+{
+    if (frameStarted)
+        endFrame();
+    frameStarted = true;
+    inner.pollInput(events);
+}
+
+void CaptureFrontend::present(const Display &display, std::uint64_t changedRows)
+{
+    current = display;
+    changed = true;
+    inner.present(display, changedRows);
+}
+
+void CaptureFrontend::setBuzzer(bool on)
+{
+    inner.setBuzzer(on);
+}
+
+unsigned long CaptureFrontend::encodedFrames() const
+{
+    return encoded.load();
+}
+
+unsigned long CaptureFrontend::repeatedFrames() const
+{
+    return repeated.load();
+}
+
+void CaptureFrontend::endFrame()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    queueChanged.wait(lock, [this] { return queue.size() < queueDepth; });
+    queue.push_back(Item{!changed, current});
+    changed = false;
+    lock.unlock();
+    queueChanged.notify_all();
+}
+
+void CaptureFrontend::encodeLoop()
+{
+    while (true) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            break;
+        Item item = queue.front();
+        queue.pop_front();
+        lock.unlock();
+        queueChanged.notify_all();
+
+        if (!failed.load())
+            encode(item);
+    }
+}
+
+void CaptureFrontend::encode(const Item &item)
+{
+    // Gray level of each plane colour.
+    static const unsigned char grayLevels[4] = {0, 3, 1, 2};
+    const std::uint32_t width = DISPLAY_WIDTH * scale;
+    const std::uint32_t height = DISPLAY_HEIGHT * scale;
+    const unsigned int shift = item.display.isHires() ? 0 : 1;
+
+    if (item.repeat && !lastEncoded.empty()) {
+        ++repeated;
+        if (format == CAPTURE_RAW)
+            write({'R'});
+        else
+            write(lastEncoded);
+        return;
+    }
+
+    // One byte per output pixel first, packed afterwards where needed.
+    std::vector<unsigned char> gray(width * height);
+    for (std::uint32_t y = 0; y < height; ++y) {
+        std::uint32_t row = y / scale >> shift;
+        for (std::uint32_t x = 0; x < width; ++x) {
+            std::uint32_t column = x / scale >> shift;
+            unsigned int colour = 0;
+            for (unsigned int p = 0; p < DISPLAY_PLANES; ++p)
+                colour |= ((item.display.planes[p][row][column / 64] >> (63 - column % 64)) & 1) << p;
+            gray[y * width + x] = grayLevels[colour];
+        }
+    }
+
+    lastEncoded.clear();
+    if (format == CAPTURE_Y4M) {
+        static const char frameHeader[] = "FRAME\n";
+        lastEncoded.assign(frameHeader, frameHeader + sizeof(frameHeader) - 1);
+        for (unsigned char level : gray)
+            lastEncoded.push_back(level * 85);
+    } else {
+        // PNG rows start with their filter type, raw frames with the tag.
+        const std::uint32_t rowBytes = (width + 3) / 4;
+        std::vector<unsigned char> packed;
+        if (format == CAPTURE_RAW)
+            packed.push_back('F');
+        for (std::uint32_t y = 0; y < height; ++y) {
+            if (format == CAPTURE_PNG)
+                packed.push_back(0);
+            std::size_t start = packed.size();
+            packed.resize(start + rowBytes, 0);
+            for (std::uint32_t x = 0; x < width; ++x)
+                packed[start + x / 4] |= gray[y * width + x] << (6 - 2 * (x % 4));
+        }
+        if (format == CAPTURE_PNG)
+            encodePng(lastEncoded, packed, width, height);
+        else
+            lastEncoded.swap(packed);
+    }
+    ++encoded;
+    write(lastEncoded);
+}
+
+void CaptureFrontend::write(const std::vector<unsigned char> &bytes)
+{
+    if (format == CAPTURE_PNG) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "%06lu.png", frameNumber++);
+        std::ofstream outFile(path + name, std::ios::binary | std::ios::trunc);
+        outFile.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        if (!outFile)
+            failed = true;
+        return;
+    }
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+        failed = true;
+}
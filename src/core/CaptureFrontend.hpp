@@ -0,0 +1,90 @@
+#ifndef NESEMULATOR_CAPTUREFRONTEND_HPP
+#define NESEMULATOR_CAPTUREFRONTEND_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+#include "Frontend.hpp"
+
+// Output formats, every frame 128x64 (low resolution pixels doubled) and
+// scaled up by an integer factor. A pixel is a 2-bit gray level: black,
+// dark and light gray for XO-CHIP plane colours 0, 2 and 3, white for 1,
+// so a plain CHIP-8 screen stays black and white.
+//   CAPTURE_RAW  'F' then the frame as 2 bits per pixel, rows MSB first and
+//                padded to a byte, or a single 'R' for a repeated frame.
+//   CAPTURE_Y4M  YUV4MPEG2 "Cmono" at 60 fps, for ffmpeg -i -.
+//   CAPTURE_PNG  one 2-bit grayscale PNG per frame, <prefix>000000.png on.
+// Y4M and PNG have no repeat marker, a repeated frame is the previous
+// encoded bytes written again.
+enum CaptureFormat {
+    CAPTURE_RAW,
+    CAPTURE_Y4M,
+    CAPTURE_PNG
+};
+
+bool parseCaptureFormat(const std::string &name, CaptureFormat &format);
+
+// Records one frame per emulated frame (a pollInput call marks the start
+// of the next one) while passing everything through to another frontend.
+// Frames go through a bounded queue to an encoder thread: the emulation
+// thread only copies the display, or queues a repeat marker if nothing was
+// presented, and blocks only when the encoder is queueDepth frames behind.
+class CaptureFrontend : public Frontend {
+    public:
+        // path is a file, "-" for stdout, or the file name prefix for PNG.
+        CaptureFrontend(Frontend &inner, CaptureFormat format, const std::string &path,
+                        unsigned int scale = 1, std::size_t queueDepth = 64);
+        CaptureFrontend(const CaptureFrontend &) = delete;
+        CaptureFrontend &operator=(const CaptureFrontend &) = delete;
+        // Captures the frame in progress, then waits for the encoder.
+        ~CaptureFrontend() override;
+        // False if the output could not be opened or written.
+        bool good() const;
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+        unsigned long encodedFrames() const;
+        unsigned long repeatedFrames() const;
+    private:
+        struct Item {
+            bool repeat;
+            Display display;
+        };
+        void endFrame();
+        void encodeLoop();
+        void encode(const Item &item);
+        void write(const std::vector<unsigned char> &bytes);
+        Frontend &inner;
+        CaptureFormat format;
+        std::string path;
+        unsigned int scale;
+        std::size_t queueDepth;
+        std::FILE *file = nullptr;
+        // Emulation thread side.
+        Display current;
+        bool frameStarted = false;
+        bool changed = true;
+        // Shared with the encoder.
+        std::deque<Item> queue;
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        bool stopping = false;
+        std::atomic<bool> failed{false};
+        std::atomic<unsigned long> encoded{0};
+        std::atomic<unsigned long> repeated{0};
+        // Encoder side: the last frame's bytes, reused for repeats.
+        std::vector<unsigned char> lastEncoded;
+        unsigned long frameNumber = 0;
+        std::thread thread;
+};
+
+#endif //NESEMULATOR_CAPTUREFRONTEND_HPP
@@ -0,0 +1,169 @@
+#include <cstring>
+#include <sstream>
+#include "Checkpoint.hpp"
+#include "Chip8.hpp"
+#include "Hash.hpp"
+
+// Frames are small and written at thousands a second.
+#define CHECKPOINT_BUFFER_SIZE (1 << 16)
+
+std::uint64_t hashDisplay(const Display &display)
+{
+    std::uint64_t resolution = static_cast<std::uint64_t>(display.width) << 32 | display.height;
+
+    return hashWords64(&display.planes[0][0][0], sizeof(display.planes) / sizeof(std::uint64_t),
+                       hashWords64(&resolution, 1));
+}
+
+void Chip8::saveCheckpoint(FrameCheckpoint &checkpoint) const
+{
+    checkpoint.displayHash = hashDisplay(display);
+    checkpoint.cycles = 0;
+    checkpoint.randomState = randomState;
+    checkpoint.indexRegister = indexRegister;
+    checkpoint.programCounter = programCounter;
+    checkpoint.stackPtr = stackPtr;
+    checkpoint.delayTimer = delayTimer;
+    checkpoint.soundTimer = soundTimer;
+    checkpoint.eventCount = 0;
+    std::memcpy(checkpoint.reg, reg, sizeof(checkpoint.reg));
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &path, const CheckpointHeader &header)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        failed = true;
+        return;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, CHECKPOINT_BUFFER_SIZE);
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1)
+        failed = true;
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    close();
+}
+
+bool CheckpointWriter::good() const
+{
+    return !failed;
+}
+
+unsigned long CheckpointWriter::framesWritten() const
+{
+    return frames;
+}
+
+void CheckpointWriter::keyEvent(unsigned char key, bool pressed)
+{
+    if (eventCount < INPUT_QUEUE_SIZE)
+        events[eventCount++] = CheckpointKey{key, pressed};
+    else
+        failed = true;
+}
+
+void CheckpointWriter::frame(FrameCheckpoint &checkpoint)
+{
+    checkpoint.eventCount = eventCount;
+    if (file != nullptr && (std::fwrite(&checkpoint, sizeof(checkpoint), 1, file) != 1 ||
+                            std::fwrite(events, sizeof(CheckpointKey), eventCount, file) != eventCount))
+        failed = true;
+    eventCount = 0;
+    ++frames;
+}
+
+bool CheckpointWriter::close()
+{
+    if (file == nullptr)
+        return good();
+    if (std::fclose(file) != 0)
+        failed = true;
+    file = nullptr;
+    return good();
+}
+
+CheckpointReader::CheckpointReader(const std::string &path)
+{
+    file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        message = "cannot open checkpoint log " + path;
+        return;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, CHECKPOINT_BUFFER_SIZE);
+    if (std::fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 ||
+        std::memcmp(fileHeader.magic, CHECKPOINT_MAGIC, 4) != 0)
+        message = path + " is not a checkpoint log";
+    else if (fileHeader.version != CHECKPOINT_VERSION)
+        message = path + " is checkpoint log version " + std::to_string(fileHeader.version) + ", expected " +
+                  std::to_string(CHECKPOINT_VERSION);
+}
+
+CheckpointReader::~CheckpointReader()
+{
+    if (file != nullptr)
+        std::fclose(file);
+}
+
+bool CheckpointReader::good() const
+{
+    return message.empty();
+}
+
+const std::string &CheckpointReader::error() const
+{
+    return message;
+}
+
+const CheckpointHeader &CheckpointReader::header() const
+{
+    return fileHeader;
+}
+
+bool CheckpointReader::next(FrameCheckpoint &checkpoint, CheckpointKey *keys)
+{
+    if (!good())
+        return false;
+    std::size_t read = std::fread(&checkpoint, 1, sizeof(checkpoint), file);
+    if (read == 0)
+        return false;
+    if (read != sizeof(checkpoint) || checkpoint.eventCount > INPUT_QUEUE_SIZE ||
+        std::fread(keys, sizeof(CheckpointKey), checkpoint.eventCount, file) != checkpoint.eventCount) {
+        message = "checkpoint log cut short";
+        return false;
+    }
+    return true;
+}
+
+static void compareField(std::ostringstream &out, const char *name, unsigned long long expected,
+                         unsigned long long actual, int width)
+{
+    if (expected == actual)
+        return;
+    out.fill('0');
+    out << name << ": expected 0x" << std::hex;
+    out.width(width);
+    out << expected << ", got 0x";
+    out.width(width);
+    out << actual << std::dec << "\n";
+}
+
+std::string describeCheckpointDifference(const FrameCheckpoint &expected, const FrameCheckpoint &actual)
+{
+    std::ostringstream out;
+
+    compareField(out, "display", expected.displayHash, actual.displayHash, 16);
+    compareField(out, "pc", expected.programCounter, actual.programCounter, 4);
+    compareField(out, "i", expected.indexRegister, actual.indexRegister, 4);
+    for (int i = 0; i < 16; ++i) {
+        char name[4];
+        std::snprintf(name, sizeof(name), "v%X", i);
+        compareField(out, name, expected.reg[i], actual.reg[i], 2);
+    }
+    compareField(out, "sp", expected.stackPtr, actual.stackPtr, 2);
+    compareField(out, "delay", expected.delayTimer, actual.delayTimer, 2);
+    compareField(out, "sound", expected.soundTimer, actual.soundTimer, 2);
+    compareField(out, "random", expected.randomState, actual.randomState, 8);
+    return out.str();
+}
@@ -0,0 +1,105 @@
+#ifndef NESEMULATOR_CHECKPOINT_HPP
+#define NESEMULATOR_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "Display.hpp"
+#include "InputQueue.hpp"
+
+#define CHECKPOINT_MAGIC "C8CP"
+#define CHECKPOINT_VERSION 1
+
+// A checkpoint log is this header then one FrameCheckpoint per 60 Hz
+// frame, each followed by the eventCount key events the frame applied:
+// enough to replay the run from the ROM and check every frame of it
+// without keeping a single image.
+struct CheckpointHeader {
+    char magic[4];
+    std::uint32_t version;
+    // fnv1a64 of the ROM image the run started from.
+    std::uint64_t romHash;
+    std::uint32_t seed;
+    std::uint32_t quirks;
+};
+
+// The machine at the end of a frame, after its timer tick and present.
+struct FrameCheckpoint {
+    std::uint64_t displayHash;
+    // The frame's cycle budget, replayed as is. It ran fewer if FX0A
+    // halted the machine, and so does the replay.
+    std::uint32_t cycles;
+    std::uint32_t randomState;
+    std::uint16_t indexRegister;
+    std::uint16_t programCounter;
+    std::uint8_t stackPtr;
+    std::uint8_t delayTimer;
+    std::uint8_t soundTimer;
+    // At most INPUT_QUEUE_SIZE, all one frame can apply.
+    std::uint8_t eventCount;
+    std::uint8_t reg[16];
+};
+
+struct CheckpointKey {
+    std::uint8_t key;
+    std::uint8_t pressed;
+};
+
+static_assert(sizeof(CheckpointHeader) == 24, "CheckpointHeader is part of the file format");
+static_assert(sizeof(FrameCheckpoint) == 40, "FrameCheckpoint is part of the file format");
+
+// Every plane and the resolution, a word at a time. The one framebuffer
+// hash: chip8_batch and chip8_jobd report it too, so golden values from
+// any of them compare.
+std::uint64_t hashDisplay(const Display &display);
+
+// Appends frames to a checkpoint log through a large stdio buffer; the
+// machine calls keyEvent as it applies input and frame once per frame.
+class CheckpointWriter {
+    public:
+        CheckpointWriter(const std::string &path, const CheckpointHeader &header);
+        CheckpointWriter(const CheckpointWriter &) = delete;
+        CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+        ~CheckpointWriter();
+        // False if the file could not be opened or written.
+        bool good() const;
+        void keyEvent(unsigned char key, bool pressed);
+        // Writes checkpoint with the key events since the last frame.
+        void frame(FrameCheckpoint &checkpoint);
+        // Flushes the log. Returns good().
+        bool close();
+        unsigned long framesWritten() const;
+    private:
+        std::FILE *file = nullptr;
+        bool failed = false;
+        CheckpointKey events[INPUT_QUEUE_SIZE];
+        unsigned int eventCount = 0;
+        unsigned long frames = 0;
+};
+
+class CheckpointReader {
+    public:
+        explicit CheckpointReader(const std::string &path);
+        CheckpointReader(const CheckpointReader &) = delete;
+        CheckpointReader &operator=(const CheckpointReader &) = delete;
+        ~CheckpointReader();
+        // False, with error() saying why, if the file is missing or not a
+        // checkpoint log.
+        bool good() const;
+        const std::string &error() const;
+        const CheckpointHeader &header() const;
+        // The next frame and its key events, keys holding at least
+        // INPUT_QUEUE_SIZE. False at the end of the log, or with error()
+        // set if the last record is cut short.
+        bool next(FrameCheckpoint &checkpoint, CheckpointKey *keys);
+    private:
+        std::FILE *file = nullptr;
+        CheckpointHeader fileHeader{};
+        std::string message;
+};
+
+// One "name: expected X, got Y" line per field that differs, empty when
+// the frames match. cycles and eventCount are inputs, not compared.
+std::string describeCheckpointDifference(const FrameCheckpoint &expected, const FrameCheckpoint &actual);
+
+#endif //NESEMULATOR_CHECKPOINT_HPP
@@ -3,100 +3,1049 @@
 //
 
 #include <functional>
+#include <array>
 #include <fstream>
 #include <cstring>
-#include <unistd.h>
 #include <iostream>
 #include "Chip8.hpp"
+#include "NullFrontend.hpp"
+#include "Scheduler.hpp"
 
-Chip8::Chip8(const std::string &filePath) : window(sf::VideoMode(800, 600, 32), sf::String("chip8"))
+static NullFrontend defaultFrontend;
+
+Chip8::Chip8(const std::string &filePath) : frontend(&defaultFrontend)
 {
-    texture.create(64, 32);
-    graphicsPixels = new sf::Uint8[64 * 32 * 4];
-    sprite.setTexture(texture);
-    sprite.setScale({10.0, 10.0});
-    sprite.setPosition({0.0, 0.0});
     resetMemory();
-    mapPixels();
     loadFile(filePath);
 }
 
-void Chip8::loadFile(const std::string &filePath)
+void Chip8::setFrontend(Frontend &newFrontend)
+{
+    frontend = &newFrontend;
+}
+
+// Reads a ROM file to 0x200. Reports and fails on unreadable files and on
+// ROMs that do not fit, leaving the machine untouched.
+bool Chip8::loadFile(const std::string &filePath)
 {
-    std::ifstream inFile(filePath);
-    std::streampos fileSize;
+    std::ifstream inFile(filePath, std::ios::binary);
+    unsigned char rom[MEMORY_SIZE - 0x200];
+    std::streamsize fileSize;
 
+    if (!inFile.is_open()) {
+        fprintf (stderr, "Cannot open ROM %s\n", filePath.c_str());
+        return false;
+    }
     inFile.seekg(0, std::ios::end);
     fileSize = inFile.tellg();
     inFile.seekg(0, std::ios::beg);
-    inFile.read(reinterpret_cast<char *>(memory) + 0x200, fileSize);
+    if (fileSize <= 0 || fileSize > static_cast<std::streamsize>(sizeof(rom))) {
+        fprintf (stderr, "ROM %s is %ld bytes, expected 1 to %zu\n", filePath.c_str(),
+                static_cast<long>(fileSize), sizeof(rom));
+        return false;
+    }
+    if (!inFile.read(reinterpret_cast<char *>(rom), fileSize)) {
+        fprintf (stderr, "Cannot read ROM %s\n", filePath.c_str());
+        return false;
+    }
+    return loadRom(rom, fileSize);
+}
+
+// Copies a ROM image already in memory to 0x200. Fails without touching
+// the machine if it does not fit.
+bool Chip8::loadRom(const unsigned char *data, std::size_t size)
+{
+    if (size > MEMORY_SIZE - 0x200)
+        return false;
+    QuirkProfile profile = QUIRKS_DEFAULT;
+    findQuirkProfile(data, size, profile);
+    setQuirks(profile);
+    memory.write(0x200, data, size);
+    recompiled.attach(findRecompiledProgram(data, size));
+    memoryWritten(0x200, size);
+    return true;
+}
+
+void Chip8::setRecompiled(const RecompiledProgram *program)
+{
+    recompiled.attach(program);
+    if (program != nullptr)
+        memoryWritten(0x200, program->romSize);
+}
+
+bool Chip8::isRecompiled() const
+{
+    return recompiled.attached() && quirkProfile == QUIRKS_DEFAULT;
+}
+
+// The JIT compiles the profile's quirks into its blocks, which go with
+// it.
+void Chip8::setQuirks(QuirkProfile profile)
+{
+    if (profile == quirkProfile)
+        return;
+    quirkProfile = profile;
+#ifdef CHIP8_JIT
+    jit.flush();
+#endif
+}
+
+QuirkProfile Chip8::getQuirks() const
+{
+    return quirkProfile;
 }
 
 void Chip8::resetMemory()
 {
     opcode = 0x00;
-    std::memset(memory, 0x00, sizeof(memory));
+    memory.clear();
     std::memset(reg, 0x00, sizeof(reg));
     indexRegister = 0x00;
     programCounter = 0x200;
-    std::memset(pixels, 0x00, sizeof(pixels));
+    display = Display();
+    planeMask = 1;
+    std::memset(flags, 0x00, sizeof(flags));
+    // Make every row differ from the blank screen so the first present
+    // uploads the whole texture.
+    std::memset(presentedDisplay.planes, 0xFF, sizeof(presentedDisplay.planes));
+    dirtyRows = ~0ull;
     delayTimer = 0x00;
     soundTimer = 0x00;
     std::memset(stack, 0x00, sizeof(stack));
     stackPtr = 0x00;
     std::memset(key, 0x00, sizeof(key));
-    for (int i = 0; i < 80; ++i)
-        memory[i] = fontset[i];
+    std::memset(keyPressed, 0x00, sizeof(keyPressed));
+    // Events polled for the previous program are dropped.
+    KeyEvent event{};
+    while (input.pop(event))
+        continue;
+    waitingForKey = false;
+    isGameStarted = true;
+    skippedCycles = 0;
+    notIdleLoop = MEMORY_SIZE;
+    memory.write(0, fontset, FONTSET_SIZE);
+    memory.write(BIG_FONTSET_ADDRESS, bigFontset, BIG_FONTSET_SIZE);
+    recompiled.attach(nullptr);
+#ifdef CHIP8_DISPATCH_PREDECODED
+    blockCache.flush();
+#endif
+#ifdef CHIP8_JIT
+    jit.flush();
+#endif
 }
 
-Chip8::Chip8()
+Chip8::Chip8() : frontend(&defaultFrontend)
 {
     resetMemory();
 }
 
+// The child shares every memory page, the block cache and the JIT code
+// with this machine, each copied on the first write to it, and copies the
+// rest of the state. It starts headless, untraced and without a
+// checkpoint writer.
+std::unique_ptr<Chip8> Chip8::fork() const
+{
+    std::unique_ptr<Chip8> child(new Chip8(*this));
+
+    child->frontend = &defaultFrontend;
+    child->checkpointWriter = nullptr;
+#ifdef CHIP8_TRACE
+    child->tracer = nullptr;
+#endif
+#ifdef CHIP8_PROFILE
+    child->profiler = nullptr;
+#endif
+    return child;
+}
+
 void Chip8::runGame()
 {
+    Scheduler scheduler(*this);
+
     isGameStarted = true;
+    scheduler.run();
+}
+
+// One 60 Hz frame: apply the key events since the last one, run the
+// frame's instructions, tick the timers once and show the result. While
+// FX0A waits no instruction runs, the timers still count down.
+unsigned long Chip8::runFrame(unsigned long cycles)
+{
+    frontend->pollInput(input);
+    applyInput();
+    unsigned long run = runCycles(cycles);
+    tickTimers();
+    presentFrame();
+    if (checkpointWriter != nullptr) {
+        FrameCheckpoint checkpoint;
+        saveCheckpoint(checkpoint);
+        checkpoint.cycles = cycles;
+        checkpointWriter->frame(checkpoint);
+    }
+    return run;
+}
+
+// The keypad only changes here. A press and release within one frame still
+// reaches a pending FX0A.
+void Chip8::applyInput()
+{
+    KeyEvent event{};
+
+    while (input.pop(event)) {
+        keyPressed[event.key & 0xF] = event.pressed;
+        if (checkpointWriter != nullptr)
+            checkpointWriter->keyEvent(event.key & 0xF, event.pressed);
+        if (event.pressed && waitingForKey) {
+            reg[keyRegister] = event.key & 0xF;
+            waitingForKey = false;
+        }
+    }
+}
+
+bool Chip8::isWaitingForKey() const
+{
+    return waitingForKey;
+}
+
+std::uint64_t Chip8::idleCyclesSkipped() const
+{
+    return skippedCycles;
+}
+
+bool Chip8::isRunning() const
+{
+    return isGameStarted && frontend->isOpen();
+}
 
-    while (isGameStarted && window.isOpen()) {
-        if (drawFlag) {
-            this->draw();
-//            std::cout << graphicsPixels << std::endl;
-            drawFlag = false;
+void Chip8::stop()
+{
+    isGameStarted = false;
+}
+
+void Chip8::setSeed(std::uint32_t seed)
+{
+    // 0 and multiples of the modulus would lock the generator at 0.
+    randomState = seed % 0x7FFFFFFF;
+    if (randomState == 0)
+        randomState = 1;
+}
+
+void Chip8::presentFrame()
+{
+    if (dirtyRows == 0)
+        return;
+
+    std::uint64_t changedRows = takeChangedRows();
+    if (changedRows != 0)
+        frontend->present(display, changedRows);
+}
+
+void Chip8::tickTimers()
+{
+    if (delayTimer > 0)
+        delayTimer--;
+    if (soundTimer > 0) {
+        soundTimer--;
+        if (soundTimer == 0)
+            frontend->setBuzzer(false);
+    }
+}
+
+const Display &Chip8::getDisplay() const
+{
+    return display;
+}
+
+// Rows that really differ from the previous call, so a sprite drawn and
+// erased again in the same frame costs nothing to present. A resolution
+// switch changes every row.
+std::uint64_t Chip8::takeChangedRows()
+{
+    std::uint64_t changedRows = 0;
+
+    for (std::uint64_t rows = dirtyRows & display.allRows(); rows != 0; rows &= rows - 1) {
+        int y = __builtin_ctzll(rows);
+        if (!display.sameRow(presentedDisplay, y)) {
+            for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+                presentedDisplay.planes[p][y][0] = display.planes[p][y][0];
+                presentedDisplay.planes[p][y][1] = display.planes[p][y][1];
+            }
+            changedRows |= 1ull << y;
         }
-        updateKeyMap();
-        keyLol();
-        fetchOpCode();
-        getInstruction();
-        executeOpCode();
-        if (delayTimer > 0)
-            delayTimer--;
-        if (soundTimer > 0)
-            soundTimer--;
-        usleep(1666);
-        std::cout << opCodeNames[actualInstruction] << std::endl;
     }
+    presentedDisplay.width = display.width;
+    presentedDisplay.height = display.height;
+    dirtyRows = 0;
+    return changedRows;
 }
 
 void Chip8::fetchOpCode()
 {
-    opcode = memory[programCounter] << 8 | memory[programCounter + 1];
+    opcode = memory.readWord(programCounter);
+}
+
+#ifdef CHIP8_DISPATCH_LEGACY
+template<class Quirks>
+const std::map<OpCode, void(Chip8::*)(void)> Chip8::opCodeMap = {
+        {CLEAR_SCREEN, &Chip8::clearScreen},
+        {RETURN, &Chip8::subroutine_return},
+        {GOTO, &Chip8::jump},
+        {SUBR_CALL, &Chip8::subroutine_call},
+        {JMP_EQ, &Chip8::jump_eq},
+        {JMP_NEQ, &Chip8::jump_neq},
+        {JMP_EQ_REG, &Chip8::jump_eq_reg},
+        {SET_VAL, &Chip8::set_val},
+        {ADD_VAL, &Chip8::add_val},
+        {SET_REG, &Chip8::set_reg},
+        {OR, &Chip8::or_op<Quirks>},
+        {AND, &Chip8::and_op<Quirks>},
+        {XOR, &Chip8::xor_op<Quirks>},
+        {ADD_REG, &Chip8::add_reg<Quirks>},
+        {SUB_REG, &Chip8::sub_reg<Quirks>},
+        {RSHIFT_REG, &Chip8::rshift_reg<Quirks>},
+        {SUB_REG_BIS, &Chip8::sub_reg_bis<Quirks>},
+        {LSHIFT_REG, &Chip8::lshift_reg<Quirks>},
+        {JMP_NEQ_REG, &Chip8::jump_neq_reg},
+        {SET_I, &Chip8::set_i},
+        {JMP_TO, &Chip8::jump_to<Quirks>},
+        {SET_REG_RAND, &Chip8::set_reg_rand},
+        {DRAW_SPRITE, &Chip8::draw_sprite<Quirks>},
+        {JMP_KEY_PRESSED, &Chip8::jump_key_pressed},
+        {JMP_NKEY_PRESSED, &Chip8::jump_nkey_pressed},
+        {GET_DELAY, &Chip8::get_delay},
+        {GET_KEY, &Chip8::get_key},
+        {SET_DELAY_TMR, &Chip8::set_delay},
+        {SET_SOUND_TMR, &Chip8::set_sound},
+        {ADD_I, &Chip8::add_i},
+        {SET_I_CHAR, &Chip8::set_i_char},
+        {STORES_BINARY, &Chip8::store_binary},
+        {REG_DUMP, &Chip8::reg_dump<Quirks>},
+        {REG_LOAD, &Chip8::reg_load<Quirks>},
+        {SCROLL_DOWN, &Chip8::scroll_down},
+        {SCROLL_RIGHT, &Chip8::scroll_right},
+        {SCROLL_LEFT, &Chip8::scroll_left},
+        {EXIT, &Chip8::exit_interpreter},
+        {LORES, &Chip8::lores_mode},
+        {HIRES, &Chip8::hires_mode},
+        {SET_I_BIG_CHAR, &Chip8::set_i_big_char},
+        {SAVE_FLAGS, &Chip8::save_flags},
+        {LOAD_FLAGS, &Chip8::load_flags},
+        {SCROLL_UP, &Chip8::scroll_up},
+        {SAVE_RANGE, &Chip8::save_range},
+        {LOAD_RANGE, &Chip8::load_range},
+        {SET_I_LONG, &Chip8::set_i_long},
+        {SELECT_PLANES, &Chip8::select_planes},
+        {LOAD_AUDIO, &Chip8::load_audio},
+        {SET_PITCH, &Chip8::set_pitch},
+        {UNKNOWN, &Chip8::unknown_opcode}
+};
+
+void Chip8::getInstruction()
+{
+    actualInstruction = decode(opcode);
+}
+
+template<class Quirks>
+void Chip8::execute()
+{
+    std::invoke(opCodeMap<Quirks>.at(actualInstruction), *this);
+}
+#else
+
+// Every 16-bit word decoded once up front, so a cycle costs one byte load
+// instead of the nested switch in decode().
+static const std::array<unsigned char, 0x10000> decodeTable = [] {
+    std::array<unsigned char, 0x10000> table{};
+
+    for (unsigned int i = 0; i < table.size(); ++i)
+        table[i] = Chip8::decode(static_cast<unsigned short>(i));
+    return table;
+}();
+
+void Chip8::getInstruction()
+{
+    actualInstruction = static_cast<OpCode>(decodeTable[opcode]);
 }
 
+// A switch rather than a table of member function pointers: the compiler
+// turns it into one jump table and inlines the handlers into it, where a
+// pointer-to-member call cannot be inlined and has to test for a virtual
+// target first. CALL (0NNN) is never decoded.
+template<class Quirks>
+void Chip8::execute()
+{
+    switch (actualInstruction) {
+        case CLEAR_SCREEN:
+            clearScreen();
+            break;
+        case RETURN:
+            subroutine_return();
+            break;
+        case GOTO:
+            jump();
+            break;
+        case SUBR_CALL:
+            subroutine_call();
+            break;
+        case JMP_EQ:
+            jump_eq();
+            break;
+        case JMP_NEQ:
+            jump_neq();
+            break;
+        case JMP_EQ_REG:
+            jump_eq_reg();
+            break;
+        case SET_VAL:
+            set_val();
+            break;
+        case ADD_VAL:
+            add_val();
+            break;
+        case SET_REG:
+            set_reg();
+            break;
+        case OR:
+            or_op<Quirks>();
+            break;
+        case AND:
+            and_op<Quirks>();
+            break;
+        case XOR:
+            xor_op<Quirks>();
+            break;
+        case ADD_REG:
+            add_reg<Quirks>();
+            break;
+        case SUB_REG:
+            sub_reg<Quirks>();
+            break;
+        case RSHIFT_REG:
+            rshift_reg<Quirks>();
+            break;
+        case SUB_REG_BIS:
+            sub_reg_bis<Quirks>();
+            break;
+        case LSHIFT_REG:
+            lshift_reg<Quirks>();
+            break;
+        case JMP_NEQ_REG:
+            jump_neq_reg();
+            break;
+        case SET_I:
+            set_i();
+            break;
+        case JMP_TO:
+            jump_to<Quirks>();
+            break;
+        case SET_REG_RAND:
+            set_reg_rand();
+            break;
+        case DRAW_SPRITE:
+            draw_sprite<Quirks>();
+            break;
+        case JMP_KEY_PRESSED:
+            jump_key_pressed();
+            break;
+        case JMP_NKEY_PRESSED:
+            jump_nkey_pressed();
+            break;
+        case GET_DELAY:
+            get_delay();
+            break;
+        case GET_KEY:
+            get_key();
+            break;
+        case SET_DELAY_TMR:
+            set_delay();
+            break;
+        case SET_SOUND_TMR:
+            set_sound();
+            break;
+        case ADD_I:
+            add_i();
+            break;
+        case SET_I_CHAR:
+            set_i_char();
+            break;
+        case STORES_BINARY:
+            store_binary();
+            break;
+        case REG_DUMP:
+            reg_dump<Quirks>();
+            break;
+        case REG_LOAD:
+            reg_load<Quirks>();
+            break;
+        case SCROLL_DOWN:
+            scroll_down();
+            break;
+        case SCROLL_RIGHT:
+            scroll_right();
+            break;
+        case SCROLL_LEFT:
+            scroll_left();
+            break;
+        case EXIT:
+            exit_interpreter();
+            break;
+        case LORES:
+            lores_mode();
+            break;
+        case HIRES:
+            hires_mode();
+            break;
+        case SET_I_BIG_CHAR:
+            set_i_big_char();
+            break;
+        case SAVE_FLAGS:
+            save_flags();
+            break;
+        case LOAD_FLAGS:
+            load_flags();
+            break;
+        case SCROLL_UP:
+            scroll_up();
+            break;
+        case SAVE_RANGE:
+            save_range();
+            break;
+        case LOAD_RANGE:
+            load_range();
+            break;
+        case SET_I_LONG:
+            set_i_long();
+            break;
+        case SELECT_PLANES:
+            select_planes();
+            break;
+        case LOAD_AUDIO:
+            load_audio();
+            break;
+        case SET_PITCH:
+            set_pitch();
+            break;
+        case CALL:
+        case UNKNOWN:
+            unknown_opcode();
+            break;
+    }
+}
+#endif
+
 void Chip8::executeOpCode()
 {
-    std::invoke(this->opCodeMap[actualInstruction], *this);
+    withQuirks(quirkProfile, [this](auto quirks) {
+        execute<decltype(quirks)>();
+    });
+}
+
+void Chip8::unknown_opcode()
+{
+    fprintf (stderr, "Unknown opcode [0x0000]: 0x%X\n", opcode);
+    programCounter += 2;
+}
+
+#ifdef CHIP8_TRACE
+#define CHIP8_TRACE_INSTRUCTION() \
+    if (tracer != nullptr) \
+        tracer->record(programCounter, opcode, actualInstruction, reg)
+#else
+#define CHIP8_TRACE_INSTRUCTION()
+#endif
+#ifdef CHIP8_PROFILE
+#define CHIP8_PROFILE_INSTRUCTION() \
+    if (profiler != nullptr) \
+        profiler->record(programCounter, opcode, actualInstruction)
+#else
+#define CHIP8_PROFILE_INSTRUCTION()
+#endif
+
+void Chip8::step()
+{
+    withQuirks(quirkProfile, [this](auto quirks) {
+        stepAs<decltype(quirks)>();
+    });
+}
+
+template<class Quirks>
+void Chip8::stepAs()
+{
+    fetchOpCode();
+    getInstruction();
+    CHIP8_TRACE_INSTRUCTION();
+    CHIP8_PROFILE_INSTRUCTION();
+    execute<Quirks>();
+}
+
+// Every quirk profile has its own instance of the interpreter, this is
+// the one place that looks at the profile.
+unsigned long Chip8::interpret(unsigned long cycles)
+{
+    unsigned long left = 0;
+
+    withQuirks(quirkProfile, [this, cycles, &left](auto quirks) {
+        left = interpretAs<decltype(quirks)>(cycles);
+    });
+    return left;
+}
+
+#ifdef CHIP8_DISPATCH_THREADED
+#define CHIP8_DISPATCH() \
+    fetchOpCode(); \
+    actualInstruction = static_cast<OpCode>(decodeTable[opcode]); \
+    CHIP8_TRACE_INSTRUCTION(); \
+    CHIP8_PROFILE_INSTRUCTION(); \
+    goto *labels[actualInstruction]
+#define CHIP8_NEXT() \
+    if (--cycles == 0) \
+        return 0; \
+    CHIP8_DISPATCH()
+
+template<class Quirks>
+unsigned long Chip8::interpretAs(unsigned long cycles)
+{
+    // Same order as the OpCode enum. Each handler gets its own indirect
+    // jump back into the table, which the branch predictor tracks
+    // separately instead of funnelling everything through one call site.
+    // The SUPER-CHIP and XO-CHIP opcodes are rare enough to share one
+    // call through the handler table, which keeps this function small
+    // enough for the compiler to inline every hot handler.
+    static void *const labels[UNKNOWN + 1] = {
+            &&clearScreen, &&subroutine_return, &&jump, &&subroutine_call,
+            &&jump_eq, &&jump_neq, &&jump_eq_reg, &&set_val, &&add_val,
+            &&set_reg, &&or_op, &&and_op, &&xor_op, &&add_reg, &&sub_reg,
+            &&rshift_reg, &&sub_reg_bis, &&lshift_reg, &&jump_neq_reg,
+            &&set_i, &&jump_to, &&set_reg_rand, &&draw_sprite,
+            &&jump_key_pressed, &&jump_nkey_pressed, &&get_delay, &&get_key,
+            &&set_delay, &&set_sound, &&add_i, &&set_i_char, &&store_binary,
+            &&reg_dump, &&reg_load, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&unknown_opcode,
+            &&unknown_opcode
+    };
+
+    if (cycles == 0)
+        return 0;
+    CHIP8_DISPATCH();
+    clearScreen: clearScreen(); CHIP8_NEXT();
+    subroutine_return: subroutine_return(); CHIP8_NEXT();
+    jump: {
+        unsigned short from = programCounter;
+        jump();
+        // This jump is counted by CHIP8_NEXT, the idle loop gets the rest.
+        if (programCounter <= from && cycles > 1)
+            cycles = skipIdleLoop(cycles - 1) + 1;
+        CHIP8_NEXT();
+    }
+    subroutine_call: subroutine_call(); CHIP8_NEXT();
+    jump_eq: jump_eq(); CHIP8_NEXT();
+    jump_neq: jump_neq(); CHIP8_NEXT();
+    jump_eq_reg: jump_eq_reg(); CHIP8_NEXT();
+    set_val: set_val(); CHIP8_NEXT();
+    add_val: add_val(); CHIP8_NEXT();
+    set_reg: set_reg(); CHIP8_NEXT();
+    or_op: or_op<Quirks>(); CHIP8_NEXT();
+    and_op: and_op<Quirks>(); CHIP8_NEXT();
+    xor_op: xor_op<Quirks>(); CHIP8_NEXT();
+    add_reg: add_reg<Quirks>(); CHIP8_NEXT();
+    sub_reg: sub_reg<Quirks>(); CHIP8_NEXT();
+    rshift_reg: rshift_reg<Quirks>(); CHIP8_NEXT();
+    sub_reg_bis: sub_reg_bis<Quirks>(); CHIP8_NEXT();
+    lshift_reg: lshift_reg<Quirks>(); CHIP8_NEXT();
+    jump_neq_reg: jump_neq_reg(); CHIP8_NEXT();
+    set_i: set_i(); CHIP8_NEXT();
+    jump_to: jump_to<Quirks>(); CHIP8_NEXT();
+    set_reg_rand: set_reg_rand(); CHIP8_NEXT();
+    draw_sprite: draw_sprite<Quirks>(); CHIP8_NEXT();
+    jump_key_pressed: jump_key_pressed(); CHIP8_NEXT();
+    jump_nkey_pressed: jump_nkey_pressed(); CHIP8_NEXT();
+    get_delay: get_delay(); CHIP8_NEXT();
+    get_key: get_key(); return cycles - 1; // Halted until a key goes down.
+    set_delay: set_delay(); CHIP8_NEXT();
+    set_sound: set_sound(); CHIP8_NEXT();
+    add_i: add_i(); CHIP8_NEXT();
+    set_i_char: set_i_char(); CHIP8_NEXT();
+    store_binary: store_binary(); CHIP8_NEXT();
+    reg_dump: reg_dump<Quirks>(); CHIP8_NEXT();
+    reg_load: reg_load<Quirks>(); CHIP8_NEXT();
+    extended: execute<Quirks>(); CHIP8_NEXT();
+    unknown_opcode: unknown_opcode(); CHIP8_NEXT();
+}
+
+#undef CHIP8_NEXT
+#undef CHIP8_DISPATCH
+#elif defined(CHIP8_DISPATCH_PREDECODED)
+// Runs the next entry of the block, or goes back to the block lookup at
+// its end or when it does not fit in the cycles left.
+#define CHIP8_DISPATCH() \
+    if (entry == end || entry->instructions > cycles) \
+        continue; \
+    opcode = entry->opcodes[0]; \
+    goto *labels[entry->kind]
+#define CHIP8_NEXT(instructions) \
+    cycles -= instructions; \
+    ++entry; \
+    CHIP8_DISPATCH()
+
+template<class Quirks>
+unsigned long Chip8::interpretAs(unsigned long cycles)
+{
+    // Same order as the OpCode enum, then the Superinstruction one.
+    static void *const labels[SUPERINSTRUCTION_END] = {
+            &&clearScreen, &&subroutine_return, &&jump, &&subroutine_call,
+            &&jump_eq, &&jump_neq, &&jump_eq_reg, &&set_val, &&add_val,
+            &&set_reg, &&or_op, &&and_op, &&xor_op, &&add_reg, &&sub_reg,
+            &&rshift_reg, &&sub_reg_bis, &&lshift_reg, &&jump_neq_reg,
+            &&set_i, &&jump_to, &&set_reg_rand, &&draw_sprite,
+            &&jump_key_pressed, &&jump_nkey_pressed, &&get_delay, &&get_key,
+            &&set_delay, &&set_sound, &&add_i, &&set_i_char, &&store_binary,
+            &&reg_dump, &&reg_load, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&extended, &&extended,
+            &&extended, &&extended, &&extended, &&unknown_opcode,
+            &&unknown_opcode, &&set_val_set_i, &&set_val_set_i_draw,
+            &&set_i_draw, &&set_val_set_val, &&set_i_reg_load,
+            &&add_i_reg_load, &&add_val_jump_eq_goto, &&add_val_jump_neq_goto
+    };
+    // Traced and profiled runs see every instruction on its own.
+    bool stepping = false;
+#ifdef CHIP8_TRACE
+    stepping = stepping || tracer != nullptr;
+#endif
+#ifdef CHIP8_PROFILE
+    stepping = stepping || profiler != nullptr;
+#endif
+
+    while (cycles > 0 && !waitingForKey) {
+        unsigned short count;
+        const BlockCache::Entry *entry = blockCache.find(memory, programCounter, count);
+        const BlockCache::Entry *end = entry + count;
+
+        // So does a fused entry that does not fit in the cycles left.
+        if (stepping || count == 0 || entry->instructions > cycles) {
+            unsigned short from = programCounter;
+
+            stepAs<Quirks>();
+            --cycles;
+            if (programCounter <= from && cycles > 0)
+                cycles = skipIdleLoop(cycles);
+            continue;
+        }
+        CHIP8_DISPATCH();
+        clearScreen: clearScreen(); CHIP8_NEXT(1);
+        subroutine_return: subroutine_return(); CHIP8_NEXT(1);
+        jump: {
+            unsigned short from = programCounter;
+            jump();
+            if (programCounter <= from && cycles > 1)
+                cycles = skipIdleLoop(cycles - 1) + 1;
+            CHIP8_NEXT(1);
+        }
+        subroutine_call: subroutine_call(); CHIP8_NEXT(1);
+        jump_eq: jump_eq(); CHIP8_NEXT(1);
+        jump_neq: jump_neq(); CHIP8_NEXT(1);
+        jump_eq_reg: jump_eq_reg(); CHIP8_NEXT(1);
+        set_val: set_val(); CHIP8_NEXT(1);
+        add_val: add_val(); CHIP8_NEXT(1);
+        set_reg: set_reg(); CHIP8_NEXT(1);
+        or_op: or_op<Quirks>(); CHIP8_NEXT(1);
+        and_op: and_op<Quirks>(); CHIP8_NEXT(1);
+        xor_op: xor_op<Quirks>(); CHIP8_NEXT(1);
+        add_reg: add_reg<Quirks>(); CHIP8_NEXT(1);
+        sub_reg: sub_reg<Quirks>(); CHIP8_NEXT(1);
+        rshift_reg: rshift_reg<Quirks>(); CHIP8_NEXT(1);
+        sub_reg_bis: sub_reg_bis<Quirks>(); CHIP8_NEXT(1);
+        lshift_reg: lshift_reg<Quirks>(); CHIP8_NEXT(1);
+        jump_neq_reg: jump_neq_reg(); CHIP8_NEXT(1);
+        set_i: set_i(); CHIP8_NEXT(1);
+        jump_to: jump_to<Quirks>(); CHIP8_NEXT(1);
+        set_reg_rand: set_reg_rand(); CHIP8_NEXT(1);
+        draw_sprite: draw_sprite<Quirks>(); CHIP8_NEXT(1);
+        jump_key_pressed: jump_key_pressed(); CHIP8_NEXT(1);
+        jump_nkey_pressed: jump_nkey_pressed(); CHIP8_NEXT(1);
+        get_delay: get_delay(); CHIP8_NEXT(1);
+        get_key: get_key(); CHIP8_NEXT(1);
+        set_delay: set_delay(); CHIP8_NEXT(1);
+        set_sound: set_sound(); CHIP8_NEXT(1);
+        add_i: add_i(); CHIP8_NEXT(1);
+        set_i_char: set_i_char(); CHIP8_NEXT(1);
+        store_binary: store_binary(); CHIP8_NEXT(1);
+        reg_dump: reg_dump<Quirks>(); CHIP8_NEXT(1);
+        reg_load: reg_load<Quirks>(); CHIP8_NEXT(1);
+        extended:
+            actualInstruction = static_cast<OpCode>(entry->kind);
+            execute<Quirks>();
+            CHIP8_NEXT(1);
+        unknown_opcode: unknown_opcode(); CHIP8_NEXT(1);
+        set_val_set_i:
+            set_val();
+            opcode = entry->opcodes[1];
+            set_i();
+            CHIP8_NEXT(2);
+        set_val_set_i_draw:
+            set_val();
+            opcode = entry->opcodes[1];
+            set_i();
+            opcode = entry->opcodes[2];
+            draw_sprite<Quirks>();
+            CHIP8_NEXT(3);
+        set_i_draw:
+            set_i();
+            opcode = entry->opcodes[1];
+            draw_sprite<Quirks>();
+            CHIP8_NEXT(2);
+        set_val_set_val:
+            set_val();
+            opcode = entry->opcodes[1];
+            set_val();
+            CHIP8_NEXT(2);
+        set_i_reg_load:
+            set_i();
+            opcode = entry->opcodes[1];
+            reg_load<Quirks>();
+            CHIP8_NEXT(2);
+        add_i_reg_load:
+            add_i();
+            opcode = entry->opcodes[1];
+            reg_load<Quirks>();
+            CHIP8_NEXT(2);
+        add_val_jump_eq_goto:
+            add_val();
+            opcode = entry->opcodes[1];
+            jump_eq();
+            goto fused_goto;
+        add_val_jump_neq_goto:
+            add_val();
+            opcode = entry->opcodes[1];
+            jump_neq();
+        fused_goto:
+            // Taken, the skip stepped over the jump.
+            if (programCounter != static_cast<unsigned short>(entry->address + 4)) {
+                CHIP8_NEXT(2);
+            }
+            opcode = entry->opcodes[2];
+            jump();
+            CHIP8_NEXT(3);
+    }
+    return cycles;
+}
+
+#undef CHIP8_NEXT
+#undef CHIP8_DISPATCH
+#else
+template<class Quirks>
+unsigned long Chip8::interpretAs(unsigned long cycles)
+{
+    while (cycles > 0 && !waitingForKey) {
+        unsigned short from = programCounter;
+
+        stepAs<Quirks>();
+        --cycles;
+        if (programCounter <= from && cycles > 0)
+            cycles = skipIdleLoop(cycles);
+    }
+    return cycles;
+}
+#endif
+
+// With the PC just moved back to what may be the head of a loop: runs
+// the loop once on a copy of V and I, and returns how many instructions
+// it took to come back with both unchanged, or 0. Only instructions that
+// read the delay timer and the keys and write nothing but V and I are
+// followed, as FX07 / 3X00 / 1NNN polling the timer or EX9E / 1NNN
+// waiting on a key do. Both only change between frames, so a loop that
+// comes back to the same state keeps doing so until the frame ends.
+unsigned int Chip8::idleLoopLength()
+{
+    unsigned char v[16];
+    unsigned short i = indexRegister;
+    unsigned short pc = programCounter;
+    bool branched = false;
+
+    std::memcpy(v, reg, sizeof(v));
+    for (unsigned int length = 1; length <= IDLE_LOOP_MAX_INSTRUCTIONS; ++length) {
+        unsigned short word = memory.readWord(pc);
+        unsigned char x = (word & 0x0F00) >> 8;
+        unsigned char y = (word & 0x00F0) >> 4;
+        unsigned char nn = word & 0x00FF;
+        bool skip = false;
+
+        switch (decode(word)) {
+            case GET_DELAY:
+                v[x] = delayTimer;
+                break;
+            case SET_VAL:
+                v[x] = nn;
+                break;
+            case SET_REG:
+                v[x] = v[y];
+                break;
+            case SET_I:
+                i = word & 0x0FFF;
+                break;
+            case JMP_EQ:
+                skip = v[x] == nn;
+                branched = true;
+                break;
+            case JMP_NEQ:
+                skip = v[x] != nn;
+                branched = true;
+                break;
+            case JMP_EQ_REG:
+                skip = v[x] == v[y];
+                branched = true;
+                break;
+            case JMP_NEQ_REG:
+                skip = v[x] != v[y];
+                branched = true;
+                break;
+            case JMP_KEY_PRESSED:
+                skip = keyPressed[v[x] & 0xF];
+                branched = true;
+                break;
+            case JMP_NKEY_PRESSED:
+                skip = !keyPressed[v[x] & 0xF];
+                branched = true;
+                break;
+            case GOTO:
+                pc = (word & 0x0FFF) - 2;
+                break;
+            default:
+                if (!branched)
+                    notIdleLoop = programCounter;
+                return 0;
+        }
+        pc += 2;
+        // Same as skipNext.
+        if (skip) {
+            pc += 2;
+            if (memory.readWord(pc) == 0xF000)
+                pc += 2;
+        }
+        if (pc == programCounter)
+            return std::memcmp(v, reg, sizeof(v)) == 0 && i == indexRegister ? length : 0;
+    }
+    return 0;
+}
+
+// Called with cycles still to run and the PC just moved back. When it is
+// at the head of an idle loop, every whole iteration left in the frame
+// would only bring the machine back where it is: they are counted as run
+// and skipped, and the rest of the cycles is returned. Traced and
+// profiled runs see every iteration.
+unsigned long Chip8::skipIdleLoop(unsigned long cycles)
+{
+#ifdef CHIP8_TRACE
+    if (tracer != nullptr)
+        return cycles;
+#endif
+#ifdef CHIP8_PROFILE
+    if (profiler != nullptr)
+        return cycles;
+#endif
+    if (programCounter == notIdleLoop)
+        return cycles;
+
+    unsigned int length = idleLoopLength();
+    if (length == 0)
+        return cycles;
+
+    unsigned long skipped = cycles / length * length;
+    skippedCycles += skipped;
+    return cycles - skipped;
+}
+
+// Stops early once FX0A halts the machine, the rest of the cycles are lost.
+unsigned long Chip8::runCycles(unsigned long cycles)
+{
+    if (waitingForKey)
+        return 0;
+#ifdef CHIP8_PROFILE
+    // Interpreted only, so every instruction is counted.
+    if (profiler != nullptr) {
+        Profiler::Clock::time_point start = Profiler::Clock::now();
+        unsigned long left = interpret(cycles);
+        profiler->addRunTime(Profiler::Clock::now() - start);
+        return cycles - left;
+    }
+#endif
+#ifdef CHIP8_TRACE
+    // Blocks run as a whole, the tracer needs to see every instruction.
+    if (tracer != nullptr)
+        return cycles - interpret(cycles);
+#endif
+    // A recompiled ROM takes over from the JIT, which would only cover
+    // what it left to the interpreter with shorter blocks.
+    if (isRecompiled())
+        return cycles - recompiled.run(*this, cycles);
+#ifdef CHIP8_JIT
+    unsigned long left = cycles;
+
+    while (left > 0 && !waitingForKey) {
+        unsigned short from = programCounter;
+        unsigned long done = jit.execute(*this, left);
+        if (done == 0) {
+            interpret(1);
+            done = 1;
+        }
+        left -= done;
+        if (programCounter <= from && left > 0)
+            left = skipIdleLoop(left);
+    }
+    return cycles - left;
+#else
+    return cycles - interpret(cycles);
+#endif
+}
+
+void Chip8::setCheckpointWriter(CheckpointWriter *writer)
+{
+    checkpointWriter = writer;
+}
+
+#ifdef CHIP8_TRACE
+void Chip8::setTracer(Tracer *newTracer)
+{
+    tracer = newTracer;
+}
+#endif
+
+#ifdef CHIP8_PROFILE
+void Chip8::setProfiler(Profiler *newProfiler)
+{
+    profiler = newProfiler;
+}
+#endif
+
+void Chip8::memoryWritten(unsigned int address, unsigned int length)
+{
+    notIdleLoop = MEMORY_SIZE;
+    // Writes wrap at 64 KB like the memory itself.
+    address %= MEMORY_SIZE;
+    if (address + length > MEMORY_SIZE) {
+        memoryWritten(0, address + length - MEMORY_SIZE);
+        length = MEMORY_SIZE - address;
+    }
+    if (recompiled.attached())
+        recompiled.invalidate(*this, address, length);
+#ifdef CHIP8_DISPATCH_PREDECODED
+    blockCache.invalidate(address, length);
+#endif
+#ifdef CHIP8_JIT
+    jit.invalidate(address, length);
+#endif
 }
 
 void Chip8::clearScreen() {
-    std::memset(pixels, 0x00, sizeof(pixels));
-    drawFlag = true;
+    dirtyRows |= display.clear(planeMask);
     programCounter += 2;
 }
 
 void Chip8::subroutine_return() {
     --stackPtr;
-    programCounter = this->stack[stackPtr] + 2;
+    programCounter = this->stack[stackPtr & 0xF] + 2;
 }
 
 void Chip8::jump()
@@ -106,7 +1055,7 @@ void Chip8::jump()
 
 void Chip8::subroutine_call()
 {
-    stack[stackPtr] = programCounter;
+    stack[stackPtr & 0xF] = programCounter;
     stackPtr++;
     programCounter = opcode & 0x0FFF;
 }
@@ -117,7 +1066,7 @@ void Chip8::jump_eq()
     unsigned char n = opcode & 0x00FF;
 
     if (reg[x] == n)
-        programCounter += 2;
+        skipNext();
     programCounter += 2;
 }
 
@@ -127,7 +1076,7 @@ void Chip8::jump_neq()
     unsigned char n = opcode & 0x00FF;
 
     if (reg[x] != n)
-        programCounter += 2;
+        skipNext();
     programCounter += 2;
 }
 
@@ -137,8 +1086,18 @@ void Chip8::jump_eq_reg()
     short y = (opcode & 0x00F0) >> 4;
 
     if (reg[x] == reg[y])
-        programCounter += 2;
+        skipNext();
+    programCounter += 2;
+}
+
+// A taken skip steps over the next instruction, both words of F000 NNNN.
+// Tested a byte at a time so it compiles to a branch: that is almost never
+// taken and, unlike a conditional move, keeps the PC off the load.
+void Chip8::skipNext()
+{
     programCounter += 2;
+    if (memory[programCounter] == 0xF0 && memory[programCounter + 1] == 0x00)
+        programCounter += 2;
 }
 
 void Chip8::set_val()
@@ -168,87 +1127,135 @@ void Chip8::set_reg()
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::or_op()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
     reg[x] |= reg[y];
+    if constexpr (Quirks::logicResetsVF)
+        reg[0xF] = 0;
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::and_op()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
     reg[x] &= reg[y];
+    if constexpr (Quirks::logicResetsVF)
+        reg[0xF] = 0;
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::xor_op()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
     reg[x] ^= reg[y];
+    if constexpr (Quirks::logicResetsVF)
+        reg[0xF] = 0;
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::add_reg()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
-    if (reg[y] > 0xFF + reg[x])
-        reg[0xF] = 1;
-    else
-        reg[0xF] = 0;
-    reg[x] += reg[y];
+    if constexpr (Quirks::baselineFlags) {
+        if (reg[y] > 0xFF + reg[x])
+            reg[0xF] = 1;
+        else
+            reg[0xF] = 0;
+        reg[x] += reg[y];
+    } else {
+        unsigned int sum = reg[x] + reg[y];
+        reg[x] = sum;
+        reg[0xF] = sum >> 8;
+    }
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::sub_reg()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
-    if (reg[y] > reg[x])
-        reg[0xF] = 0;
-    else
-        reg[0xF] = 1;
-    reg[x] -= reg[y];
+    if constexpr (Quirks::baselineFlags) {
+        if (reg[y] > reg[x])
+            reg[0xF] = 0;
+        else
+            reg[0xF] = 1;
+        reg[x] -= reg[y];
+    } else {
+        unsigned char vx = reg[x];
+        unsigned char vy = reg[y];
+        reg[x] = vx - vy;
+        reg[0xF] = vx >= vy;
+    }
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::rshift_reg()
 {
     short x = (opcode & 0x0F00) >> 8;
-
-    reg[0xF] = reg[x] & 1;
-    reg[x] >>= 1;
+    short source = Quirks::shiftReadsVY ? (opcode & 0x00F0) >> 4 : x;
+
+    if constexpr (Quirks::baselineFlags) {
+        reg[0xF] = reg[source] & 1;
+        reg[x] = reg[source] >> 1;
+    } else {
+        unsigned char value = reg[source];
+        reg[x] = value >> 1;
+        reg[0xF] = value & 1;
+    }
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::sub_reg_bis()
 {
     short x = (opcode & 0x0F00) >> 8;
     short y = (opcode & 0x00F0) >> 4;
 
-    if (reg[x] > reg[y])
-        reg[0xF] = 0;
-    else
-        reg[0xF] = 1;
-    reg[x] = reg[y] - reg[x];
+    if constexpr (Quirks::baselineFlags) {
+        if (reg[x] > reg[y])
+            reg[0xF] = 0;
+        else
+            reg[0xF] = 1;
+        reg[x] = reg[y] - reg[x];
+    } else {
+        unsigned char vx = reg[x];
+        unsigned char vy = reg[y];
+        reg[x] = vy - vx;
+        reg[0xF] = vy >= vx;
+    }
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::lshift_reg()
 {
     short x = (opcode & 0x0F00) >> 8;
-
-    reg[0xF] = getMSB(reg[x]);
-    reg[x] <<= 1;
+    short source = Quirks::shiftReadsVY ? (opcode & 0x00F0) >> 4 : x;
+
+    if constexpr (Quirks::baselineFlags) {
+        reg[0xF] = getMSB(reg[source]);
+        reg[x] = reg[source] << 1;
+    } else {
+        unsigned char value = reg[source];
+        reg[x] = value << 1;
+        reg[0xF] = value >> 7;
+    }
     programCounter += 2;
 }
 
@@ -272,7 +1279,7 @@ void Chip8::jump_neq_reg()
     short y = (opcode & 0x00F0) >> 4;
 
     if (reg[x] != reg[y])
-        programCounter += 2;
+        skipNext();
     programCounter += 2;
 }
 
@@ -282,15 +1289,19 @@ void Chip8::set_i()
     programCounter += 2;
 }
 
+// BNNN, or CHIP-48's BXNN: X is also the top digit of the address.
+template<class Quirks>
 void Chip8::jump_to()
 {
-    programCounter = reg[0] + (opcode & 0x0FFF);
+    programCounter = reg[Quirks::jumpReadsVX ? (opcode & 0x0F00) >> 8 : 0] + (opcode & 0x0FFF);
 }
 
 void Chip8::set_reg_rand()
 {
-    //Have not energy to use c++11 random library ....
-    unsigned char val = std::rand() % 0xFF;
+    // Park-Miller "minimal standard" generator, per instance so runs are
+    // reproducible from their seed whatever else the process is doing.
+    randomState = static_cast<std::uint32_t>(static_cast<std::uint64_t>(randomState) * 48271 % 0x7FFFFFFF);
+    unsigned char val = randomState % 0xFF;
     unsigned char n = (opcode & 0x00FF);
     short x = (opcode & 0x0F00) >> 8;
 
@@ -298,30 +1309,29 @@ void Chip8::set_reg_rand()
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::draw_sprite()
 {
+#ifdef CHIP8_PROFILE
+    Profiler::DrawScope drawScope(profiler);
+#endif
     unsigned short vx = reg[(opcode & 0x0F00) >> 8];
     unsigned short vy = reg[(opcode & 0x00F0) >> 4];
     unsigned short height = opcode & 0x000F;
-    unsigned short pixel;
-    reg[0xF] = 0;
-
-    for (int yLine = 0; yLine < height; yLine++)
-    {
-        pixel = memory[indexRegister + yLine];
-        for(int xLine = 0; xLine < 8; xLine++)
-        {
-            if((pixel & (0x80 >> xLine)) != 0)
-            {
-                if(pixels[(vx + xLine + ((vy + yLine) * 64))] == 1)
-                    reg[0xF] = 1;
-                pixels[vx + xLine + ((vy + yLine) * 64)] ^= 1;
-                if (pixels[vx + xLine + ((vy + yLine) * 64)] != 0)
-                    std::cout << "la bite" << std::endl;
-            }
-        }
-    }
-    drawFlag = true;
+    // DXY0 is a 16x16 sprite, two bytes a row.
+    bool wide = height == 0;
+    unsigned char sprite[DISPLAY_PLANES * 32];
+    unsigned int bytes;
+
+    if (wide)
+        height = 16;
+    bytes = height * (wide ? 2 : 1) * __builtin_popcount(planeMask);
+    for (unsigned int i = 0; i < bytes; i++)
+        sprite[i] = memory[indexRegister + i];
+    // The start position wraps. Unless the profile wraps sprites too, the
+    // sprite itself is clipped: bits shifted past the right edge fall off
+    // and rows past the bottom are skipped.
+    reg[0xF] = display.draw<Quirks::spritesWrap>(planeMask, vx, vy, sprite, height, wide, dirtyRows);
     programCounter += 2;
 }
 
@@ -329,8 +1339,8 @@ void Chip8::jump_key_pressed()
 {
     short x = (opcode & 0x0F00) >> 8;
 
-    if (keyPressed[reg[x]])
-        programCounter += 2;
+    if (keyPressed[reg[x] & 0xF])
+        skipNext();
     programCounter += 2;
 }
 
@@ -338,8 +1348,8 @@ void Chip8::jump_nkey_pressed()
 {
     short x = (opcode & 0x0F00) >> 8;
 
-    if (!keyPressed[reg[x]])
-        programCounter += 2;
+    if (!keyPressed[reg[x] & 0xF])
+        skipNext();
     programCounter += 2;
 }
 
@@ -351,12 +1361,12 @@ void Chip8::get_delay()
     programCounter += 2;
 }
 
+// Moves on right away and halts until applyInput sees a key go down, so
+// a waiting machine runs nothing at all.
 void Chip8::get_key()
 {
-    short x = (opcode & 0x0F00) >> 8;
-
-    //TODO: THIS
-    //REG[X] = BLOCKING_GET_KEY();
+    keyRegister = (opcode & 0x0F00) >> 8;
+    waitingForKey = true;
     programCounter += 2;
 }
 
@@ -373,6 +1383,7 @@ void Chip8::set_sound()
     short x = (opcode & 0x0F00) >> 8;
 
     soundTimer = reg[x];
+    frontend->setBuzzer(soundTimer > 0);
     programCounter += 2;
 }
 
@@ -396,223 +1407,328 @@ void Chip8::store_binary()
 {
     short x = (opcode & 0x0F00) >> 8;
 
-    memory[indexRegister]     = reg[x] / 100;
-    memory[indexRegister + 1] = (reg[x] / 10) % 10;
-    memory[indexRegister + 2] = (reg[x] % 100) % 10;
+    memory.write(indexRegister,     reg[x] / 100);
+    memory.write(indexRegister + 1, (reg[x] / 10) % 10);
+    memory.write(indexRegister + 2, (reg[x] % 100) % 10);
+    memoryWritten(indexRegister, 3);
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::reg_dump()
 {
     short x = (opcode & 0x0F00) >> 8;
 
-    for (int i = 0; i <= x; i++)
-        memory[indexRegister + i] = reg[i];
+    memory.write(indexRegister, reg, x + 1);
+    memoryWritten(indexRegister, x + 1);
+    if constexpr (Quirks::index != INDEX_UNCHANGED)
+        indexRegister += Quirks::index == INDEX_PLUS_X ? x : x + 1;
     programCounter += 2;
 }
 
+template<class Quirks>
 void Chip8::reg_load()
 {
     short x = (opcode & 0x0F00) >> 8;
 
     for (int i = 0; i <= x; i++)
         reg[i] = memory[indexRegister + i];
+    if constexpr (Quirks::index != INDEX_UNCHANGED)
+        indexRegister += Quirks::index == INDEX_PLUS_X ? x : x + 1;
     programCounter += 2;
 }
 
-void Chip8::getInstruction()
+// 00CN: scrolls the selected planes down N rows.
+void Chip8::scroll_down()
+{
+    dirtyRows |= display.scrollDown(planeMask, opcode & 0x000F);
+    programCounter += 2;
+}
+
+// 00DN: XO-CHIP's scroll up.
+void Chip8::scroll_up()
+{
+    dirtyRows |= display.scrollUp(planeMask, opcode & 0x000F);
+    programCounter += 2;
+}
+
+void Chip8::scroll_right()
+{
+    dirtyRows |= display.scrollRight(planeMask);
+    programCounter += 2;
+}
+
+void Chip8::scroll_left()
+{
+    dirtyRows |= display.scrollLeft(planeMask);
+    programCounter += 2;
+}
+
+// 00FD: the program is done. The PC stays put, so a caller that keeps
+// running it just spins here.
+void Chip8::exit_interpreter()
+{
+    stop();
+}
+
+void Chip8::lores_mode()
+{
+    dirtyRows |= display.setHires(false);
+    programCounter += 2;
+}
+
+void Chip8::hires_mode()
+{
+    dirtyRows |= display.setHires(true);
+    programCounter += 2;
+}
+
+void Chip8::set_i_big_char()
+{
+    short x = (opcode & 0x0F00) >> 8;
+
+    indexRegister = BIG_FONTSET_ADDRESS + (reg[x] & 0xF) * 10;
+    programCounter += 2;
+}
+
+// FX75 / FX85: V0 to VX to and from the flags.
+void Chip8::save_flags()
+{
+    short x = (opcode & 0x0F00) >> 8;
+
+    std::memcpy(flags, reg, x + 1);
+    programCounter += 2;
+}
+
+void Chip8::load_flags()
+{
+    short x = (opcode & 0x0F00) >> 8;
+
+    std::memcpy(reg, flags, x + 1);
+    programCounter += 2;
+}
+
+// 5XY2 / 5XY3: VX to VY to and from memory at I, in reverse when X > Y.
+// I does not move.
+void Chip8::save_range()
+{
+    short x = (opcode & 0x0F00) >> 8;
+    short y = (opcode & 0x00F0) >> 4;
+    short step = x <= y ? 1 : -1;
+    unsigned short count = (x <= y ? y - x : x - y) + 1;
+    unsigned char values[16]{};
+
+    for (unsigned short i = 0; i < count; ++i)
+        values[i] = reg[x + i * step];
+    memory.write(indexRegister, values, count);
+    memoryWritten(indexRegister, count);
+    programCounter += 2;
+}
+
+void Chip8::load_range()
+{
+    short x = (opcode & 0x0F00) >> 8;
+    short y = (opcode & 0x00F0) >> 4;
+    short step = x <= y ? 1 : -1;
+    unsigned short count = (x <= y ? y - x : x - y) + 1;
+    unsigned char values[16];
+
+    memory.read(indexRegister, values, count);
+    for (unsigned short i = 0; i < count; ++i)
+        reg[x + i * step] = values[i];
+    programCounter += 2;
+}
+
+// F000 NNNN: the address is the next word.
+void Chip8::set_i_long()
+{
+    indexRegister = memory.readWord(programCounter + 2);
+    programCounter += 4;
+}
+
+void Chip8::select_planes()
+{
+    planeMask = ((opcode & 0x0F00) >> 8) & ALL_PLANES;
+    programCounter += 2;
+}
+
+// F002 / FX3A: XO-CHIP's audio pattern and pitch. Accepted so programs
+// using them run, the buzzer stays a plain tone.
+void Chip8::load_audio()
+{
+    programCounter += 2;
+}
+
+void Chip8::set_pitch()
+{
+    programCounter += 2;
+}
+
+OpCode Chip8::decode(unsigned short opcode)
 {
     switch (opcode & 0xF000) {
         case 0x0000:
+            switch (opcode & 0x0FF0) {
+                case 0x00C0:
+                    return SCROLL_DOWN;
+                case 0x00D0:
+                    return SCROLL_UP;
+                default:
+                    break;
+            }
+            switch (opcode & 0x0FFF) {
+                case 0x00FB:
+                    return SCROLL_RIGHT;
+                case 0x00FC:
+                    return SCROLL_LEFT;
+                case 0x00FD:
+                    return EXIT;
+                case 0x00FE:
+                    return LORES;
+                case 0x00FF:
+                    return HIRES;
+                default:
+                    break;
+            }
             switch (opcode & 0x000F) {
                 case 0x0000:
-                    actualInstruction = CLEAR_SCREEN;
-                    break;
+                    return CLEAR_SCREEN;
                 case 0x000E:
-                    actualInstruction = RETURN;
-                    break;
+                    return RETURN;
                 default:
-                    printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+                    return UNKNOWN;
             }
-            break;
         case 0x1000:
-            actualInstruction = GOTO;
-            break;
+            return GOTO;
         case 0x2000:
-            actualInstruction = SUBR_CALL;
-            break;
+            return SUBR_CALL;
         case 0x3000:
-            actualInstruction = JMP_EQ;
-            break;
+            return JMP_EQ;
         case 0x4000:
-            actualInstruction = JMP_NEQ;
-            break;
+            return JMP_NEQ;
         case 0x5000:
-            actualInstruction = JMP_EQ_REG;
-            break;
+            switch (opcode & 0x000F) {
+                case 0x0002:
+                    return SAVE_RANGE;
+                case 0x0003:
+                    return LOAD_RANGE;
+                default:
+                    return JMP_EQ_REG;
+            }
         case 0x6000:
-            actualInstruction = SET_VAL;
-            break;
+            return SET_VAL;
         case 0x7000:
-            actualInstruction = ADD_VAL;
-            break;
+            return ADD_VAL;
         case 0x8000:
             switch (opcode & 0x000F) {
                 case 0x0000:
-                    actualInstruction = SET_REG;
-                    break;
+                    return SET_REG;
                 case 0x0001:
-                    actualInstruction = OR;
-                    break;
+                    return OR;
                 case 0x0002:
-                    actualInstruction = AND;
-                    break;
+                    return AND;
                 case 0x0003:
-                    actualInstruction = XOR;
-                    break;
+                    return XOR;
                 case 0x0004:
-                    actualInstruction = ADD_REG;
-                    break;
+                    return ADD_REG;
                 case 0x0005:
-                    actualInstruction = SUB_REG;
-                    break;
+                    return SUB_REG;
                 case 0x0006:
-                    actualInstruction = RSHIFT_REG;
-                    break;
+                    return RSHIFT_REG;
                 case 0x0007:
-                    actualInstruction = SUB_REG_BIS;
-                    break;
+                    return SUB_REG_BIS;
                 case 0x000E:
-                    actualInstruction = LSHIFT_REG;
-                    break;
+                    return LSHIFT_REG;
                 default:
-                    printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+                    return UNKNOWN;
             }
-            break;
         case 0x9000:
-            actualInstruction = JMP_NEQ_REG;
-            break;
+            return JMP_NEQ_REG;
         case 0xA000:
-            actualInstruction = SET_I;
-            break;
+            return SET_I;
         case 0xB000:
-            actualInstruction = JMP_TO;
-            break;
+            return JMP_TO;
         case 0xC000:
-            actualInstruction = SET_REG_RAND;
-            break;
+            return SET_REG_RAND;
         case 0xD000:
-            actualInstruction = DRAW_SPRITE;
-            break;
+            return DRAW_SPRITE;
         case 0xE000:
             switch (opcode & 0x000F) {
                 case 0x000E:
-                    actualInstruction = JMP_KEY_PRESSED;
-                    break;
+                    return JMP_KEY_PRESSED;
                 case 0x0001:
-                    actualInstruction = JMP_NKEY_PRESSED;
-                    break;
+                    return JMP_NKEY_PRESSED;
                 default:
-                    printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+                    return UNKNOWN;
             }
-            break;
         case 0xF000:
+            switch (opcode & 0x0FFF) {
+                case 0x0000:
+                    return SET_I_LONG;
+                case 0x0002:
+                    return LOAD_AUDIO;
+                default:
+                    break;
+            }
+            switch (opcode & 0x00FF) {
+                case 0x0001:
+                    return SELECT_PLANES;
+                case 0x0030:
+                    return SET_I_BIG_CHAR;
+                case 0x003A:
+                    return SET_PITCH;
+                case 0x0075:
+                    return SAVE_FLAGS;
+                case 0x0085:
+                    return LOAD_FLAGS;
+                default:
+                    break;
+            }
             switch (opcode & 0x000F) {
                 case 0x0007:
-                    actualInstruction = GET_DELAY;
-                    break;
+                    return GET_DELAY;
                 case 0x000A:
-                    actualInstruction = GET_KEY;
-                    break;
+                    return GET_KEY;
                 case 0x0005:
                     switch (opcode & 0x00F0) {
                         case 0x0010:
-                            actualInstruction = SET_DELAY_TMR;
-                            break;
+                            return SET_DELAY_TMR;
                         case 0x0050:
-                            actualInstruction = REG_DUMP;
-                            break;
+                            return REG_DUMP;
                         case 0x0060:
-                            actualInstruction = REG_LOAD;
-                            break;
+                            return REG_LOAD;
                         default:
-                            printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+                            return UNKNOWN;
                     }
-                    break;
                 case 0x0008:
-                    actualInstruction = SET_SOUND_TMR;
-                    break;
+                    return SET_SOUND_TMR;
                 case 0x000E:
-                    actualInstruction = ADD_I;
-                    break;
+                    return ADD_I;
                 case 0x0009:
-                    actualInstruction = SET_I_CHAR;
-                    break;
+                    return SET_I_CHAR;
                 case 0x0003:
-                    actualInstruction = STORES_BINARY;
-                    break;
+                    return STORES_BINARY;
                 default:
-                    printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+                    return UNKNOWN;
             }
-            break;
         default:
-            printf ("Unknown opcode [0x0000]: 0x%X\n", opcode);
+            return UNKNOWN;
     }
-}
-
-void Chip8::draw()
-{
-    mapPixels();
-    window.clear(sf::Color::Black);
-    window.draw(sprite);
-    window.display();
-}
-
-void Chip8::mapPixels()
-{
-    for (int i = 0; i < 64 * 32; i++)
-    {
-        graphicsPixels[i*4] = pixels[i] == 0 ? 0 : 255;
-        graphicsPixels[i*4 + 1] = pixels[i] == 0 ? 0 : 255;
-        graphicsPixels[i*4 + 2] = pixels[i] == 0 ? 0 : 255;
-        graphicsPixels[i*4 + 3] = 255; //no opacity
-    }
-    texture.update(graphicsPixels);
-//    sprite.setTexture(texture);
+    return UNKNOWN;
 }
 
 void Chip8::pixelsLol()
 {
-    for (int i = 0; i < 64; i++)
+    for (unsigned int y = 0; y < display.height; y++)
     {
-        for (int j = 0; j < 32; j++)
+        for (unsigned int x = 0; x < display.width; x++)
         {
-            std::cout << (int)pixels[i*32 +j]<< " ";
+            std::cout << ((display.planes[0][y][x / 64] >> (63 - x % 64)) & 1) << " ";
         }
         std::cout << std::endl;
     }
 }
 
-void Chip8::updateKeyMap()
-{
-    keyPressed[0x0] = sf::Keyboard::isKeyPressed(sf::Keyboard::X);
-    keyPressed[0x1] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num1);
-    keyPressed[0x2] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num2);
-    keyPressed[0x3] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num3);
-    keyPressed[0x4] = sf::Keyboard::isKeyPressed(sf::Keyboard::A);
-    keyPressed[0x5] = sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
-    keyPressed[0x6] = sf::Keyboard::isKeyPressed(sf::Keyboard::E);
-    keyPressed[0x7] = sf::Keyboard::isKeyPressed(sf::Keyboard::Q);
-    keyPressed[0x8] = sf::Keyboard::isKeyPressed(sf::Keyboard::S);
-    keyPressed[0x9] = sf::Keyboard::isKeyPressed(sf::Keyboard::D);
-    keyPressed[0xA] = sf::Keyboard::isKeyPressed(sf::Keyboard::W);
-    keyPressed[0xB] = sf::Keyboard::isKeyPressed(sf::Keyboard::C);
-    keyPressed[0xC] = sf::Keyboard::isKeyPressed(sf::Keyboard::Num4);
-    keyPressed[0xD] = sf::Keyboard::isKeyPressed(sf::Keyboard::R);
-    keyPressed[0xE] = sf::Keyboard::isKeyPressed(sf::Keyboard::F);
-    keyPressed[0xF] = sf::Keyboard::isKeyPressed(sf::Keyboard::V);
-}
-
 void Chip8::keyLol()
 {
     for (int i = 0; i <= 0xF; ++i)
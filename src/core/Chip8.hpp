@@ -5,11 +5,45 @@
 #ifndef NESEMULATOR_CHIP8_HPP
 #define NESEMULATOR_CHIP8_HPP
 
-#include <SFML/Graphics.hpp>
+#include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
+#include "Checkpoint.hpp"
+#include "Display.hpp"
+#include "Frontend.hpp"
+#include "PagedMemory.hpp"
+#include "Quirks.hpp"
+#include "Recompiled.hpp"
+#include "SaveState.hpp"
+#ifdef CHIP8_JIT
+#include "Jit.hpp"
+#endif
+#ifdef CHIP8_DISPATCH_PREDECODED
+#include "BlockCache.hpp"
+#endif
+#ifdef CHIP8_TRACE
+#include "Tracer.hpp"
+#endif
+#ifdef CHIP8_PROFILE
+#include "Profiler.hpp"
+#endif
+
+// Opcode dispatch strategy, picked with
+// -DCHIP8_DISPATCH=legacy|table|threaded|predecoded.
+#if !defined(CHIP8_DISPATCH_LEGACY) && !defined(CHIP8_DISPATCH_TABLE) && !defined(CHIP8_DISPATCH_THREADED) && \
+    !defined(CHIP8_DISPATCH_PREDECODED)
+#define CHIP8_DISPATCH_TABLE
+#endif
+
+// Longest loop body checked for an idle loop.
+#define IDLE_LOOP_MAX_INSTRUCTIONS 8
 
 #define FONTSET_SIZE 80
+// SUPER-CHIP's 8x10 digits, with XO-CHIP's A to F, right after the small
+// ones.
+#define BIG_FONTSET_ADDRESS FONTSET_SIZE
+#define BIG_FONTSET_SIZE 160
 
 const unsigned char fontset[FONTSET_SIZE] = {
         0xF0, 0x90, 0x90, 0x90, 0xF0,		// 0
@@ -30,6 +64,25 @@ const unsigned char fontset[FONTSET_SIZE] = {
         0xF0, 0x80, 0xF0, 0x80, 0x80		// F
 };
 
+const unsigned char bigFontset[BIG_FONTSET_SIZE] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF,		// 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF,		// 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF,		// 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF,		// 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03,		// 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF,		// 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF,		// 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18,		// 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF,		// 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF,		// 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3,		// A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC,		// B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C,		// C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC,		// D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF,		// E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0		// F
+};
+
 
 enum OpCode {
     CLEAR_SCREEN,
@@ -66,43 +119,187 @@ enum OpCode {
     STORES_BINARY,
     REG_DUMP,
     REG_LOAD,
-    CALL
+    // SUPER-CHIP
+    SCROLL_DOWN,
+    SCROLL_RIGHT,
+    SCROLL_LEFT,
+    EXIT,
+    LORES,
+    HIRES,
+    SET_I_BIG_CHAR,
+    SAVE_FLAGS,
+    LOAD_FLAGS,
+    // XO-CHIP
+    SCROLL_UP,
+    SAVE_RANGE,
+    LOAD_RANGE,
+    SET_I_LONG,
+    SELECT_PLANES,
+    LOAD_AUDIO,
+    SET_PITCH,
+    CALL,
+    UNKNOWN
+};
+
+#ifdef CHIP8_DISPATCH_PREDECODED
+// Runs the block cache fuses into one entry, numbered on from the opcodes.
+enum Superinstruction {
+    SET_VAL_SET_I = UNKNOWN + 1,    // 6XNN ANNN
+    SET_VAL_SET_I_DRAW,             // 6XNN ANNN DXYN
+    SET_I_DRAW,                     // ANNN DXYN
+    SET_VAL_SET_VAL,                // 6XNN 6YNN
+    SET_I_REG_LOAD,                 // ANNN FX65
+    ADD_I_REG_LOAD,                 // FX1E FX65
+    ADD_VAL_JMP_EQ_GOTO,            // 7XNN 3XNN 1NNN
+    ADD_VAL_JMP_NEQ_GOTO,           // 7XNN 4XNN 1NNN
+    SUPERINSTRUCTION_END
+};
+#endif
+
+const char *const opCodeNames[UNKNOWN + 1] = {
+        "clearScreen",
+        "return",
+        "goto",
+        "subr_call",
+        "jmp_eq",
+        "jmp_neq",
+        "jmp_eq_reg",
+        "set_val",
+        "add_val",
+        "set_reg",
+        "or",
+        "and",
+        "xor",
+        "add_reg",
+        "sub_reg",
+        "rshift_reg",
+        "sub_reg_bis",
+        "lshift_reg",
+        "jmp_neq_reg",
+        "set_i",
+        "jmp_to",
+        "set_reg_rand",
+        "draw_sprite",
+        "jmp_key_press",
+        "jmp_nkey_press",
+        "get_delay",
+        "get_key",
+        "set_delay_tmr",
+        "set_snd_tmr",
+        "add_i",
+        "set_i_char",
+        "store_binary",
+        "reg_dump",
+        "reg_load",
+        "scroll_down",
+        "scroll_right",
+        "scroll_left",
+        "exit",
+        "lores",
+        "hires",
+        "set_i_bigchar",
+        "save_flags",
+        "load_flags",
+        "scroll_up",
+        "save_range",
+        "load_range",
+        "set_i_long",
+        "select_planes",
+        "load_audio",
+        "set_pitch",
+        "call",
+        "unknown",
 };
 
 class Chip8 {
+    friend class Jit;
+    friend class JobServer;
+    friend class Lockstep;
+    friend class Recompiled;
+    friend class RecompiledMachine;
     public:
         Chip8();
         explicit Chip8(const std::string &filePath);
+        Chip8 &operator=(const Chip8 &) = delete;
+        std::unique_ptr<Chip8> fork() const;
+        void setFrontend(Frontend &newFrontend);
+#ifdef CHIP8_TRACE
+        void setTracer(Tracer *newTracer);
+#endif
+#ifdef CHIP8_PROFILE
+        void setProfiler(Profiler *newProfiler);
+#endif
+        // Each frame's key events and end state go to writer, nullptr for
+        // none.
+        void setCheckpointWriter(CheckpointWriter *writer);
+        // Back to a freshly constructed machine but for the frontend,
+        // tracer, profiler, checkpoint writer, seed and quirks, so one
+        // machine can run many programs.
         void resetMemory();
+        bool loadFile(const std::string &filePath);
+        bool loadRom(const unsigned char *data, std::size_t size);
+        // loadRom attaches the program recompiled from the ROM when one is
+        // linked in; nullptr goes back to interpreting everything.
+        void setRecompiled(const RecompiledProgram *program);
+        // Recompiled programs are built with the default quirks and only
+        // run under them.
+        bool isRecompiled() const;
+        // loadRom picks the quirk database's profile for the ROM, the
+        // default one when it has none; set it after loading to override.
+        void setQuirks(QuirkProfile profile);
+        QuirkProfile getQuirks() const;
         void runGame();
+        // Both return the instructions run, fewer than cycles when FX0A
+        // halts the machine. Skipped idle loop iterations count as run.
+        unsigned long runFrame(unsigned long cycles);
+        bool isRunning() const;
+        void stop();
+        void setSeed(std::uint32_t seed);
+        void step();
+        unsigned long runCycles(unsigned long cycles);
+        void tickTimers();
+        void presentFrame();
+        // Halted in FX0A until a key goes down.
+        bool isWaitingForKey() const;
+        // Instructions counted as run without running them, see
+        // skipIdleLoop.
+        std::uint64_t idleCyclesSkipped() const;
         void executeOpCode();
+        const Display &getDisplay() const;
+        std::uint64_t takeChangedRows();
+        void saveState(SaveState &state) const;
+        // All but cycles and eventCount, which only the frame knows.
+        void saveCheckpoint(FrameCheckpoint &checkpoint) const;
+        bool loadState(const SaveState &state);
+        static OpCode decode(unsigned short opcode);
     private:
         static int getMSB(int nb);
         void jump();
         void clearScreen();
         void subroutine_return();
         void subroutine_call();
-        void loadFile(const std::string &filePath);
         void fetchOpCode();
+        template<class Quirks> void stepAs();
+        template<class Quirks> void execute();
         void jump_eq();
         void jump_neq();
         void jump_eq_reg();
         void set_val();
         void add_val();
         void set_reg();
-        void or_op();
-        void and_op();
-        void xor_op();
-        void add_reg();
-        void sub_reg();
-        void rshift_reg();
-        void sub_reg_bis();
-        void lshift_reg();
+        template<class Quirks> void or_op();
+        template<class Quirks> void and_op();
+        template<class Quirks> void xor_op();
+        template<class Quirks> void add_reg();
+        template<class Quirks> void sub_reg();
+        template<class Quirks> void rshift_reg();
+        template<class Quirks> void sub_reg_bis();
+        template<class Quirks> void lshift_reg();
         void jump_neq_reg();
         void set_i();
-        void jump_to();
+        template<class Quirks> void jump_to();
         void set_reg_rand();
-        void draw_sprite();
+        template<class Quirks> void draw_sprite();
         void jump_key_pressed();
         void jump_nkey_pressed();
         void get_delay();
@@ -113,107 +310,88 @@ class Chip8 {
         void add_i();
         void set_i_char();
         void store_binary();
-        void reg_dump();
-        void reg_load();
-        void draw();
-        void mapPixels();
+        template<class Quirks> void reg_dump();
+        template<class Quirks> void reg_load();
+        void scroll_down();
+        void scroll_right();
+        void scroll_left();
+        void exit_interpreter();
+        void lores_mode();
+        void hires_mode();
+        void set_i_big_char();
+        void save_flags();
+        void load_flags();
+        void scroll_up();
+        void save_range();
+        void load_range();
+        void set_i_long();
+        void select_planes();
+        void load_audio();
+        void set_pitch();
+        void skipNext();
+        void unknown_opcode();
+        Chip8(const Chip8 &parent) = default;
+        // Both return the cycles left, nonzero once FX0A halts the machine.
+        unsigned long interpret(unsigned long cycles);
+        template<class Quirks> unsigned long interpretAs(unsigned long cycles);
+        unsigned int idleLoopLength();
+        unsigned long skipIdleLoop(unsigned long cycles);
+        void applyInput();
+        void memoryWritten(unsigned int address, unsigned int length);
         void pixelsLol();
-        void updateKeyMap();
         void keyLol();
         unsigned short opcode{};
-        unsigned char memory[4096]{};
+        PagedMemory memory;
         unsigned char reg[16]{};
         unsigned short indexRegister{};
         unsigned short programCounter{};
-        unsigned char pixels[64 * 32]{};
+        Display display;
+        // FN01: planes drawn, cleared and scrolled.
+        unsigned char planeMask = 1;
+        // FX75 / FX85 user flags, the HP48's RPL registers.
+        unsigned char flags[16]{};
         unsigned char delayTimer{};
         unsigned char soundTimer{};
         unsigned short stack[16]{};
         unsigned short stackPtr{};
         unsigned char key[16]{};
-        bool isGameStarted = false;
-        bool drawFlag = false;
+        std::uint32_t randomState = 1;
+        bool isGameStarted = true;
+        // Rows written since the last present, and what was presented then.
+        std::uint64_t dirtyRows = 0;
+        Display presentedDisplay;
         bool keyPressed[16] = {false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false};
+        // Key events polled from the frontend, applied at the start of each
+        // frame. FX0A stops the machine until one of them presses a key,
+        // which goes to V[keyRegister].
+        InputQueue input;
+        bool waitingForKey = false;
+        unsigned char keyRegister = 0;
+        std::uint64_t skippedCycles = 0;
+        // A loop head that reaches a non-idle instruction without a skip,
+        // so whatever the state it is not worth following again until
+        // memory changes. MEMORY_SIZE when there is none.
+        unsigned int notIdleLoop = MEMORY_SIZE;
         OpCode actualInstruction = CLEAR_SCREEN;
-        sf::RenderWindow window;
-        sf::Texture texture;
-        sf::Sprite sprite;
-        sf::Uint8 *graphicsPixels = nullptr;
-        std::map<OpCode, void(Chip8::*)(void)> opCodeMap = {
-                {CLEAR_SCREEN, &Chip8::clearScreen},
-                {RETURN, &Chip8::subroutine_return},
-                {GOTO, &Chip8::jump},
-                {SUBR_CALL, &Chip8::subroutine_call},
-                {JMP_EQ, &Chip8::jump_eq},
-                {JMP_NEQ, &Chip8::jump_neq},
-                {JMP_EQ_REG, &Chip8::jump_eq_reg},
-                {SET_VAL, &Chip8::set_val},
-                {ADD_VAL, &Chip8::add_val},
-                {SET_REG, &Chip8::set_reg},
-                {OR, &Chip8::or_op},
-                {AND, &Chip8::and_op},
-                {XOR, &Chip8::xor_op},
-                {ADD_REG, &Chip8::add_reg},
-                {SUB_REG, &Chip8::sub_reg},
-                {RSHIFT_REG, &Chip8::rshift_reg},
-                {SUB_REG_BIS, &Chip8::sub_reg_bis},
-                {LSHIFT_REG, &Chip8::lshift_reg},
-                {JMP_NEQ_REG, &Chip8::jump_neq_reg},
-                {SET_I, &Chip8::set_i},
-                {JMP_TO, &Chip8::jump_to},
-                {SET_REG_RAND, &Chip8::set_reg_rand},
-                {DRAW_SPRITE, &Chip8::draw_sprite},
-                {JMP_KEY_PRESSED, &Chip8::jump_key_pressed},
-                {JMP_NKEY_PRESSED, &Chip8::jump_nkey_pressed},
-                {GET_DELAY, &Chip8::get_delay},
-                {GET_KEY, &Chip8::get_key},
-                {SET_DELAY_TMR, &Chip8::set_delay},
-                {SET_SOUND_TMR, &Chip8::set_sound},
-                {ADD_I, &Chip8::add_i},
-                {SET_I_CHAR, &Chip8::set_i_char},
-                {STORES_BINARY, &Chip8::store_binary},
-                {REG_DUMP, &Chip8::reg_dump},
-                {REG_LOAD, &Chip8::reg_load}
-
-        };
-    std::string opCodeNames[CALL + 1] =
-            {
-                    "clearScreen",
-                    "return",
-                    "goto",
-                    "subr_call",
-                    "jmp_eq",
-                    "jmp_neq",
-                    "jmp_eq_reg",
-                    "set_val",
-                    "add_val",
-                    "set_reg",
-                    "or",
-                    "and",
-                    "xor",
-                    "add_reg",
-                    "sub_reg",
-                    "rshift_reg",
-                    "sub_reg_bis",
-                    "lshift_reg",
-                    "jmp_neq_reg",
-                    "set_i",
-                    "jmp_to",
-                    "set_reg_rand",
-                    "draw_sprite",
-                    "jmp_key_press",
-                    "jmp_nkey_press",
-                    "get_delay",
-                    "get_key",
-                    "set_delay_tmr",
-                    "set_snd_tmr",
-                    "add_i",
-                    "set_i_char",
-                    "store_binary",
-                    "reg_dump",
-                    "reg_load",
-                    "call",
-            };
+        QuirkProfile quirkProfile = QUIRKS_DEFAULT;
+        Frontend *frontend;
+        CheckpointWriter *checkpointWriter = nullptr;
+        Recompiled recompiled;
+#ifdef CHIP8_DISPATCH_PREDECODED
+        BlockCache blockCache;
+#endif
+#ifdef CHIP8_JIT
+        Jit jit;
+#endif
+#ifdef CHIP8_TRACE
+        Tracer *tracer = nullptr;
+#endif
+#ifdef CHIP8_PROFILE
+        Profiler *profiler = nullptr;
+#endif
+#ifdef CHIP8_DISPATCH_LEGACY
+        template<class Quirks> static const std::map<OpCode, void(Chip8::*)(void)> opCodeMap;
+#endif
 };
 
 
@@ -0,0 +1,95 @@
+#include <cstring>
+#include "Display.hpp"
+
+Display::Display() : planes(), width(SCREEN_WIDTH), height(SCREEN_HEIGHT)
+{
+}
+
+bool Display::isHires() const
+{
+    return width == DISPLAY_WIDTH;
+}
+
+std::uint64_t Display::allRows() const
+{
+    return height == 64 ? ~0ull : (1ull << height) - 1;
+}
+
+std::uint64_t Display::setHires(bool hires)
+{
+    std::memset(planes, 0, sizeof(planes));
+    width = hires ? DISPLAY_WIDTH : SCREEN_WIDTH;
+    height = hires ? DISPLAY_HEIGHT : SCREEN_HEIGHT;
+    return ~0ull;
+}
+
+std::uint64_t Display::clear(unsigned int planeMask)
+{
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p)
+        if (planeMask & (1u << p))
+            std::memset(planes[p], 0, sizeof(planes[p]));
+    return allRows();
+}
+
+std::uint64_t Display::scrollDown(unsigned int planeMask, unsigned int rows)
+{
+    if (rows >= height)
+        return clear(planeMask);
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+        if (planeMask & (1u << p)) {
+            std::memmove(planes[p][rows], planes[p][0], (height - rows) * sizeof(planes[p][0]));
+            std::memset(planes[p][0], 0, rows * sizeof(planes[p][0]));
+        }
+    }
+    return allRows();
+}
+
+std::uint64_t Display::scrollUp(unsigned int planeMask, unsigned int rows)
+{
+    if (rows >= height)
+        return clear(planeMask);
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+        if (planeMask & (1u << p)) {
+            std::memmove(planes[p][0], planes[p][rows], (height - rows) * sizeof(planes[p][0]));
+            std::memset(planes[p][height - rows], 0, rows * sizeof(planes[p][0]));
+        }
+    }
+    return allRows();
+}
+
+// Low resolution rows only use word 0, and word 1 stays blank.
+std::uint64_t Display::scrollRight(unsigned int planeMask)
+{
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+        if (!(planeMask & (1u << p)))
+            continue;
+        for (unsigned int y = 0; y < height; ++y) {
+            std::uint64_t *row = planes[p][y];
+            row[1] = isHires() ? row[1] >> 4 | row[0] << 60 : 0;
+            row[0] >>= 4;
+        }
+    }
+    return allRows();
+}
+
+std::uint64_t Display::scrollLeft(unsigned int planeMask)
+{
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+        if (!(planeMask & (1u << p)))
+            continue;
+        for (unsigned int y = 0; y < height; ++y) {
+            std::uint64_t *row = planes[p][y];
+            row[0] = row[0] << 4 | row[1] >> 60;
+            row[1] <<= 4;
+        }
+    }
+    return allRows();
+}
+
+bool Display::sameRow(const Display &other, unsigned int y) const
+{
+    for (unsigned int p = 0; p < DISPLAY_PLANES; ++p)
+        if (planes[p][y][0] != other.planes[p][y][0] || planes[p][y][1] != other.planes[p][y][1])
+            return false;
+    return width == other.width;
+}
@@ -0,0 +1,94 @@
+#ifndef NESEMULATOR_DISPLAY_HPP
+#define NESEMULATOR_DISPLAY_HPP
+
+#include <cstdint>
+
+// CHIP-8 low resolution, and SUPER-CHIP / XO-CHIP high resolution.
+#define SCREEN_WIDTH 64
+#define SCREEN_HEIGHT 32
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+// XO-CHIP bitplanes, and the 64-bit words holding a high resolution row.
+#define DISPLAY_PLANES 2
+#define DISPLAY_ROW_WORDS 2
+#define ALL_PLANES ((1u << DISPLAY_PLANES) - 1)
+
+// A high resolution row as one integer, word 0 in the top half.
+typedef unsigned __int128 DisplayRow;
+
+// The framebuffer: one bit per pixel and plane, a pixel's colour is its
+// plane bits (plane 0 is bit 0). Row y of plane p is planes[p][y], words
+// left to right with bit 63 of each word the leftmost pixel. Only the top
+// left width x height corner is used; in low resolution that is word 0 of
+// the first 32 rows, laid out exactly like the plain CHIP-8 screen.
+//
+// Every operation works on whole 64-bit row words, never pixel by pixel,
+// and returns the rows it changed as a mask (bit y for row y).
+struct Display {
+    std::uint64_t planes[DISPLAY_PLANES][DISPLAY_HEIGHT][DISPLAY_ROW_WORDS];
+    std::uint32_t width;
+    std::uint32_t height;
+
+    Display();
+    bool isHires() const;
+    // 00FE / 00FF: switching resolution clears every plane.
+    std::uint64_t setHires(bool hires);
+    std::uint64_t clear(unsigned int planeMask);
+    // DXYN: XORs a sprite of rows rows at (x, y) into each plane of
+    // planeMask, the position wrapped to the screen and the sprite clipped
+    // at its edges, or wrapped around them too with wrap. A sprite row is
+    // one byte, or two for a 16 pixel wide sprite, and each selected plane
+    // takes the next rows in turn. Returns whether any set pixel was
+    // cleared. Hot path, kept inline.
+    template<bool wrap = false>
+    bool draw(unsigned int planeMask, unsigned int x, unsigned int y, const unsigned char *sprite,
+              unsigned int rows, bool wide, std::uint64_t &changedRows)
+    {
+        unsigned int spriteWidth = wide ? 16 : 8;
+        std::uint64_t collision = 0;
+
+        // Both sizes are powers of two, a mask instead of a division.
+        x &= width - 1;
+        y &= height - 1;
+        for (unsigned int p = 0; p < DISPLAY_PLANES; ++p) {
+            if (!(planeMask & (1u << p)))
+                continue;
+            for (unsigned int r = 0; r < rows && (wrap || y + r < height); ++r) {
+                unsigned int bits = wide ? sprite[2 * r] << 8 | sprite[2 * r + 1] : sprite[r];
+                unsigned int rowY = (y + r) & (height - 1);
+                std::uint64_t *row = planes[p][rowY];
+
+                if (bits == 0)
+                    continue;
+                // Wrapping rotates the row instead of shifting it.
+                if (width == SCREEN_WIDTH) {
+                    std::uint64_t word = static_cast<std::uint64_t>(bits) << (64 - spriteWidth);
+                    word = wrap ? word >> x | word << ((64 - x) & 63) : word >> x;
+                    collision |= row[0] & word;
+                    row[0] ^= word;
+                } else {
+                    DisplayRow wideRow = static_cast<DisplayRow>(bits) << (128 - spriteWidth);
+                    wideRow = wrap ? wideRow >> x | wideRow << ((128 - x) & 127) : wideRow >> x;
+                    std::uint64_t high = static_cast<std::uint64_t>(wideRow >> 64);
+                    std::uint64_t low = static_cast<std::uint64_t>(wideRow);
+                    collision |= (row[0] & high) | (row[1] & low);
+                    row[0] ^= high;
+                    row[1] ^= low;
+                }
+                changedRows |= 1ull << rowY;
+            }
+            sprite += rows * (wide ? 2 : 1);
+        }
+        return collision != 0;
+    }
+    // 00CN / 00DN: rows down or up, 00FB / 00FC: 4 pixels right or left.
+    // What moves off the screen is lost, what comes in is blank.
+    std::uint64_t scrollDown(unsigned int planeMask, unsigned int rows);
+    std::uint64_t scrollUp(unsigned int planeMask, unsigned int rows);
+    std::uint64_t scrollRight(unsigned int planeMask);
+    std::uint64_t scrollLeft(unsigned int planeMask);
+    bool sameRow(const Display &other, unsigned int y) const;
+    std::uint64_t allRows() const;
+};
+
+#endif //NESEMULATOR_DISPLAY_HPP
@@ -0,0 +1,29 @@
+#ifndef NESEMULATOR_FRONTEND_HPP
+#define NESEMULATOR_FRONTEND_HPP
+
+#include <cstdint>
+#include "Display.hpp"
+#include "InputQueue.hpp"
+
+// Everything the core needs from the outside world: somewhere to show the
+// framebuffer, key events and a buzzer to toggle.
+class Frontend {
+    public:
+        virtual ~Frontend() = default;
+        virtual bool isOpen() const = 0;
+        // Called once per frame: pushes the key presses and releases seen
+        // since the last call, oldest first.
+        virtual void pollInput(InputQueue &events) = 0;
+        // Only the rows set in changedRows differ from the last present,
+        // all of them after a resolution switch.
+        virtual void present(const Display &display, std::uint64_t changedRows) = 0;
+        virtual void setBuzzer(bool on) = 0;
+        // Presenting from another thread: the emulation thread lets go of
+        // whatever graphics context present() needs, then the render thread
+        // takes it before its first present, and the other way round when
+        // it stops.
+        virtual void releaseRenderContext() {}
+        virtual void acquireRenderContext() {}
+};
+
+#endif //NESEMULATOR_FRONTEND_HPP
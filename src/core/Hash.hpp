@@ -0,0 +1,34 @@
+#ifndef NESEMULATOR_HASH_HPP
+#define NESEMULATOR_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+// 64-bit FNV-1a, chainable through the seed argument.
+inline std::uint64_t fnv1a64(const void *data, std::size_t size, std::uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// A 64-bit word per multiply instead of a byte, for buffers hashed every
+// frame. The shift folds the high half of each product back into the low
+// one, which the next word's xor alone would never reach.
+inline std::uint64_t hashWords64(const std::uint64_t *words, std::size_t count, std::uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+#endif //NESEMULATOR_HASH_HPP
@@ -0,0 +1,68 @@
+#ifndef NESEMULATOR_INPUTQUEUE_HPP
+#define NESEMULATOR_INPUTQUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#define INPUT_QUEUE_SIZE 64
+
+struct KeyEvent {
+    // Microseconds on the frontend's clock, only ever compared with each
+    // other.
+    std::uint64_t timestamp;
+    unsigned char key;
+    bool pressed;
+};
+
+// Microseconds on the steady clock, for frontends reading live input.
+inline std::uint64_t inputTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Single producer, single consumer ring of key events: the frontend pushes
+// whatever happened since its last poll, the machine pops them in order
+// when it applies them. Neither side locks. A full queue drops the new
+// event, which at INPUT_QUEUE_SIZE per frame only a stuck consumer sees.
+class InputQueue {
+    public:
+        InputQueue() = default;
+        // Copies start empty: events belong to whoever polled them.
+        InputQueue(const InputQueue &) : InputQueue() {}
+
+        bool push(const KeyEvent &event)
+        {
+            unsigned int tail = writeIndex.load(std::memory_order_relaxed);
+
+            if (tail - readIndex.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+                return false;
+            events[tail % INPUT_QUEUE_SIZE] = event;
+            writeIndex.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(KeyEvent &event)
+        {
+            unsigned int head = readIndex.load(std::memory_order_relaxed);
+
+            if (head == writeIndex.load(std::memory_order_acquire))
+                return false;
+            event = events[head % INPUT_QUEUE_SIZE];
+            readIndex.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const
+        {
+            return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+        }
+    private:
+        KeyEvent events[INPUT_QUEUE_SIZE]{};
+        // Free running, the slot is the index modulo INPUT_QUEUE_SIZE.
+        alignas(64) std::atomic<unsigned int> writeIndex{0};
+        alignas(64) std::atomic<unsigned int> readIndex{0};
+};
+
+#endif //NESEMULATOR_INPUTQUEUE_HPP
@@ -0,0 +1,311 @@
+#ifdef CHIP8_JIT
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "Jit.hpp"
+#include "Chip8.hpp"
+
+// Register use inside a block (System V ABI):
+//   rdi = reg, rsi = &indexRegister, rdx = &delayTimer
+//   r8d = I, al/cl scratch, eax = next program counter on return.
+// V registers are addressed as [rdi + disp8] so the ModRM bytes below are
+// 0x47 (al, [rdi+d8]) and 0x4F (cl, [rdi+d8]).
+
+Jit::Cache::Cache() : blocks(MEMORY_SIZE)
+{
+}
+
+Jit::Cache::Cache(const Cache &other) : blocks(other.blocks), used(other.used)
+{
+    if (other.code == nullptr)
+        return;
+    void *mapping = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        std::fill(blocks.begin(), blocks.end(), Block());
+        used.clear();
+        return;
+    }
+    code = static_cast<unsigned char *>(mapping);
+    codeUsed = other.codeUsed;
+    std::memcpy(code, other.code, codeUsed);
+    // Blocks make no calls and jump nowhere outside themselves, so the
+    // copies run as they are at their new address.
+    for (Block &block : blocks) {
+        if (block.code != nullptr)
+            block.code = reinterpret_cast<BlockFn>(code + (reinterpret_cast<unsigned char *>(block.code) - other.code));
+    }
+}
+
+Jit::Cache::~Cache()
+{
+    if (code != nullptr)
+        munmap(code, CODE_SIZE);
+}
+
+Jit::Cache &Jit::own()
+{
+    if (cache.use_count() > 1) {
+        cache = std::make_shared<Cache>(*cache);
+        return *cache;
+    }
+    // Sole owner: the forks that let go released their counts, this puts
+    // their reads of the cache before the writes to come.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return *cache;
+}
+
+// A shared cache is let go rather than copied only to be emptied.
+void Jit::flush()
+{
+    if (cache == nullptr)
+        return;
+    if (cache.use_count() > 1) {
+        cache.reset();
+        return;
+    }
+    Cache &owned = own();
+    for (unsigned short address : owned.used)
+        owned.blocks[address] = Block();
+    owned.used.clear();
+    owned.codeUsed = 0;
+}
+
+void Jit::invalidate(unsigned int address, unsigned int length)
+{
+    if (cache == nullptr)
+        return;
+
+    unsigned int end = std::min<unsigned int>(address + length, MEMORY_SIZE);
+    unsigned int first = address >= MAX_BLOCK_LENGTH ? address - MAX_BLOCK_LENGTH + 1 : 0;
+
+    for (unsigned int start = first; start < end; ++start) {
+        const Block &block = cache->blocks[start];
+        if ((block.code != nullptr && start + block.length > address) ||
+            (block.untranslatable && start + 2 > address))
+            own().blocks[start] = Block();
+    }
+}
+
+unsigned long Jit::execute(Chip8 &chip8, unsigned long cycles)
+{
+    unsigned short pc = chip8.programCounter;
+
+    if (pc + 1 >= MEMORY_SIZE)
+        return 0;
+    if (cache == nullptr)
+        cache = std::make_shared<Cache>();
+
+    const Block *block = &cache->blocks[pc];
+    if (block->code == nullptr) {
+        if (block->untranslatable || !translate(chip8, own().blocks[pc], pc))
+            return 0;
+        block = &cache->blocks[pc];
+    }
+    if (block->instructions > cycles)
+        return 0;
+    chip8.programCounter = block->code(chip8.reg, &chip8.indexRegister, &chip8.delayTimer);
+    return block->instructions;
+}
+
+void Jit::emit(std::initializer_list<unsigned char> bytes)
+{
+    std::memcpy(cache->code + cache->codeUsed, bytes.begin(), bytes.size());
+    cache->codeUsed += bytes.size();
+}
+
+void Jit::emit32(unsigned int value)
+{
+    std::memcpy(cache->code + cache->codeUsed, &value, sizeof(value));
+    cache->codeUsed += sizeof(value);
+}
+
+// The cache is owned by the time this runs.
+bool Jit::translate(const Chip8 &chip8, Block &block, unsigned short address)
+{
+    // Full, or with so many retranslations the list outgrew the table.
+    if (cache->codeUsed + MAX_BLOCK_BYTES > CODE_SIZE || cache->used.size() >= MEMORY_SIZE)
+        flush();
+    cache->used.push_back(address);
+    if (cache->code == nullptr) {
+        void *mapping = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            block.untranslatable = true;
+            return false;
+        }
+        cache->code = static_cast<unsigned char *>(mapping);
+    }
+
+    std::size_t blockStart = cache->codeUsed;
+    // Wider than the PC so a block stops at the top of memory instead of
+    // running on from 0.
+    unsigned int pc = address;
+    unsigned short instructions = 0;
+    bool closed = false;
+    bool supported = true;
+    // 0x44 = cmove, 0x45 = cmovne for a conditional skip, 0 for a plain jump.
+    unsigned char skipCondition = 0;
+    unsigned short target = 0;
+    // Blocks follow the machine's quirks; what they change that is not
+    // compiled in is left to the interpreter.
+    QuirkSettings quirks = quirkSettings(chip8.quirkProfile);
+
+    // movzx r8d, word [rsi]
+    emit({0x44, 0x0F, 0xB7, 0x06});
+    while (supported && !closed && instructions < MAX_BLOCK_INSTRUCTIONS && pc + 1 < MEMORY_SIZE) {
+        unsigned short opcode = chip8.memory.readWord(pc);
+        unsigned char x = (opcode & 0x0F00) >> 8;
+        unsigned char y = (opcode & 0x00F0) >> 4;
+        unsigned char nn = opcode & 0x00FF;
+
+        switch (Chip8::decode(opcode)) {
+            case SET_VAL:
+                emit({0xC6, 0x47, x, nn});
+                break;
+            case ADD_VAL:
+                emit({0x80, 0x47, x, nn});
+                break;
+            case SET_REG:
+                emit({0x8A, 0x47, y, 0x88, 0x47, x});
+                break;
+            case OR:
+                if (quirks.logicResetsVF) {
+                    supported = false;
+                    continue;
+                }
+                emit({0x8A, 0x47, y, 0x08, 0x47, x});
+                break;
+            case AND:
+                if (quirks.logicResetsVF) {
+                    supported = false;
+                    continue;
+                }
+                emit({0x8A, 0x47, y, 0x20, 0x47, x});
+                break;
+            case XOR:
+                if (quirks.logicResetsVF) {
+                    supported = false;
+                    continue;
+                }
+                emit({0x8A, 0x47, y, 0x30, 0x47, x});
+                break;
+            case ADD_REG:
+                if (quirks.baselineFlags) {
+                    // add_reg's carry test can never be true, VF always ends up 0.
+                    emit({0xC6, 0x47, 0x0F, 0x00, 0x8A, 0x47, y, 0x00, 0x47, x});
+                    break;
+                }
+                // mov al, VX; add al, VY; setc cl; VX = al; VF = cl
+                emit({0x8A, 0x47, x, 0x02, 0x47, y, 0x0F, 0x92, 0xC1, 0x88, 0x47, x, 0x88, 0x4F, 0x0F});
+                break;
+            case SUB_REG:
+                if (quirks.baselineFlags) {
+                    // VF = VX >= VY (setae), then VX -= VY re-read after VF.
+                    emit({0x8A, 0x47, x, 0x3A, 0x47, y, 0x0F, 0x93, 0xC1, 0x88, 0x4F, 0x0F,
+                          0x8A, 0x47, y, 0x28, 0x47, x});
+                    break;
+                }
+                // mov al, VX; sub al, VY; setae cl; VX = al; VF = cl
+                emit({0x8A, 0x47, x, 0x2A, 0x47, y, 0x0F, 0x93, 0xC1, 0x88, 0x47, x, 0x88, 0x4F, 0x0F});
+                break;
+            case SUB_REG_BIS:
+                if (quirks.baselineFlags) {
+                    emit({0x8A, 0x47, y, 0x3A, 0x47, x, 0x0F, 0x93, 0xC1, 0x88, 0x4F, 0x0F,
+                          0x8A, 0x47, y, 0x2A, 0x47, x, 0x88, 0x47, x});
+                    break;
+                }
+                // mov al, VY; sub al, VX; setae cl; VX = al; VF = cl
+                emit({0x8A, 0x47, y, 0x2A, 0x47, x, 0x0F, 0x93, 0xC1, 0x88, 0x47, x, 0x88, 0x4F, 0x0F});
+                break;
+            case RSHIFT_REG:
+                if (quirks.baselineFlags) {
+                    if (quirks.shiftReadsVY) {
+                        supported = false;
+                        continue;
+                    }
+                    emit({0x8A, 0x47, x, 0x24, 0x01, 0x88, 0x47, 0x0F, 0xD0, 0x6F, x});
+                    break;
+                }
+                // mov al, source; mov cl, al; and cl, 1; shr al, 1; VX = al; VF = cl
+                emit({0x8A, 0x47, quirks.shiftReadsVY ? y : x, 0x88, 0xC1, 0x80, 0xE1, 0x01, 0xD0, 0xE8,
+                      0x88, 0x47, x, 0x88, 0x4F, 0x0F});
+                break;
+            case LSHIFT_REG:
+                // getMSB's flag is left to the interpreter.
+                if (quirks.baselineFlags) {
+                    supported = false;
+                    continue;
+                }
+                // mov al, source; mov cl, al; shr cl, 7; add al, al; VX = al; VF = cl
+                emit({0x8A, 0x47, quirks.shiftReadsVY ? y : x, 0x88, 0xC1, 0xC0, 0xE9, 0x07, 0x00, 0xC0,
+                      0x88, 0x47, x, 0x88, 0x4F, 0x0F});
+                break;
+            case SET_I:
+                emit({0x41, 0xB8});
+                emit32(opcode & 0x0FFF);
+                break;
+            case ADD_I:
+                // movzx eax, byte [rdi+x]; add r8d, eax
+                emit({0x0F, 0xB6, 0x47, x, 0x41, 0x01, 0xC0});
+                break;
+            case GET_DELAY:
+                emit({0x8A, 0x02, 0x88, 0x47, x});
+                break;
+            case SET_DELAY_TMR:
+                emit({0x8A, 0x47, x, 0x88, 0x02});
+                break;
+            case GOTO:
+                target = opcode & 0x0FFF;
+                closed = true;
+                break;
+            case JMP_EQ:
+            case JMP_NEQ:
+                emit({0x80, 0x7F, x, nn});
+                skipCondition = Chip8::decode(opcode) == JMP_EQ ? 0x44 : 0x45;
+                closed = true;
+                break;
+            case JMP_EQ_REG:
+            case JMP_NEQ_REG:
+                emit({0x8A, 0x47, x, 0x3A, 0x47, y});
+                skipCondition = Chip8::decode(opcode) == JMP_EQ_REG ? 0x44 : 0x45;
+                closed = true;
+                break;
+            default:
+                // Left to the interpreter, the block ends right before it.
+                supported = false;
+                continue;
+        }
+        ++instructions;
+        pc += 2;
+    }
+    if (instructions == 0) {
+        cache->codeUsed = blockStart;
+        block.untranslatable = true;
+        return false;
+    }
+    // mov [rsi], r8w
+    emit({0x66, 0x44, 0x89, 0x06});
+    if (skipCondition != 0) {
+        // A taken skip over F000 NNNN jumps both its words.
+        unsigned short skipped = chip8.memory.readWord(pc) == 0xF000 ? 4 : 2;
+
+        // mov eax, pc; mov ecx, pc + skipped; cmovcc eax, ecx
+        emit({0xB8});
+        emit32(static_cast<unsigned short>(pc));
+        emit({0xB9});
+        emit32(static_cast<unsigned short>(pc + skipped));
+        emit({0x0F, skipCondition, 0xC1});
+    } else {
+        emit({0xB8});
+        emit32(closed ? target : static_cast<unsigned short>(pc));
+    }
+    emit({0xC3});
+
+    block.code = reinterpret_cast<BlockFn>(cache->code + blockStart);
+    block.length = pc - address + (skipCondition != 0 ? 2 : 0);
+    block.instructions = instructions;
+    return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef NESEMULATOR_JIT_HPP
+#define NESEMULATOR_JIT_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+class Chip8;
+
+// Basic-block recompiler to x86-64. A block is a straight run of ALU,
+// I and delay timer instructions closed by a jump or a conditional skip;
+// anything else ends the block early and is left to the interpreter.
+// V0-VF stay in Chip8::reg (addressed off rdi) and I is held in r8 for
+// the whole block.
+class Jit {
+    public:
+        Jit() = default;
+        // Copies share the code cache until either side changes it.
+        Jit(const Jit &) = default;
+        Jit &operator=(const Jit &) = delete;
+        unsigned long execute(Chip8 &chip8, unsigned long cycles);
+        void invalidate(unsigned int address, unsigned int length);
+        void flush();
+    private:
+        typedef unsigned short (*BlockFn)(unsigned char *reg, unsigned short *indexRegister, unsigned char *delayTimer);
+        struct Block {
+            BlockFn code = nullptr;
+            unsigned short length = 0;
+            unsigned short instructions = 0;
+            // The first instruction is not handled, don't retry until the
+            // bytes under it change.
+            bool untranslatable = false;
+        };
+        static const unsigned short MAX_BLOCK_INSTRUCTIONS = 32;
+        // The longest block: its instructions and, after a closing skip,
+        // the word it reads to size the skip.
+        static const unsigned short MAX_BLOCK_LENGTH = MAX_BLOCK_INSTRUCTIONS * 2 + 2;
+        static const std::size_t MAX_BLOCK_BYTES = 1024;
+        static const std::size_t CODE_SIZE = 1 << 20;
+        struct Cache {
+            Cache();
+            // Copies the code into an arena of its own.
+            Cache(const Cache &other);
+            Cache &operator=(const Cache &) = delete;
+            ~Cache();
+            unsigned char *code = nullptr;
+            std::size_t codeUsed = 0;
+            // One entry per start address.
+            std::vector<Block> blocks;
+            // Start addresses given an entry since the last flush, so a
+            // flush resets those instead of the whole table.
+            std::vector<unsigned short> used;
+        };
+        // The cache, copied first if a fork still shares it.
+        Cache &own();
+        bool translate(const Chip8 &chip8, Block &block, unsigned short address);
+        void emit(std::initializer_list<unsigned char> bytes);
+        void emit32(unsigned int value);
+        std::shared_ptr<Cache> cache;
+};
+
+#endif //NESEMULATOR_JIT_HPP
@@ -0,0 +1,569 @@
+#include <climits>
+#include <cstring>
+#include <type_traits>
+#include "Lockstep.hpp"
+
+// Rows of the same register file may be the same row (8XX1), but a lane
+// only ever reads its own column, so no iteration depends on another.
+#if defined(__clang__)
+#define LANES_INDEPENDENT _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define LANES_INDEPENDENT _Pragma("GCC ivdep")
+#else
+#define LANES_INDEPENDENT
+#endif
+
+// Applies one assignment to every lane of the group and leaves the others
+// alone. Written as a bitwise blend over all lanes rather than a branch so
+// the loop vectorises; "i" is the lane inside value.
+#define LANES(target, value) \
+    LANES_INDEPENDENT \
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) { \
+        typedef std::remove_reference<decltype(target[i])>::type Lane; \
+        Lane select = static_cast<Lane>(static_cast<signed char>(mask[i])); \
+        target[i] = static_cast<Lane>((static_cast<Lane>(value) & select) | (target[i] & ~select)); \
+    }
+
+// The conditional skips, as the next PC of every lane of the group. Where
+// a taken skip lands only varies by lane once memory was written.
+#define LANES_SKIP(condition) \
+    if (memoryWritten) { \
+        findSkipTargets(); \
+        LANES(programCounter, (condition) ? skipTargets[i] : groupProgramCounter + 2); \
+    } else { \
+        unsigned short target = skipTarget(leader); \
+        LANES(programCounter, (condition) ? target : groupProgramCounter + 2); \
+    }
+
+static const std::array<unsigned char, 0x10000> decodeTable = [] {
+    std::array<unsigned char, 0x10000> table{};
+
+    for (unsigned int i = 0; i < table.size(); ++i)
+        table[i] = Chip8::decode(static_cast<unsigned short>(i));
+    return table;
+}();
+
+// 8XYE's VF under baselineFlags: getMSB, truncated to a byte like the
+// scalar store.
+const std::array<unsigned char, 256> Lockstep::lshiftFlag = [] {
+    std::array<unsigned char, 256> table{};
+
+    for (unsigned int i = 0; i < table.size(); ++i)
+        table[i] = Chip8::getMSB(i);
+    return table;
+}();
+
+Lockstep::Lockstep(const Chip8 &prototype, unsigned int laneCount)
+        : laneCount(laneCount < LOCKSTEP_LANES ? laneCount : LOCKSTEP_LANES), quirkProfile(prototype.quirkProfile),
+          quirks(quirkSettings(prototype.quirkProfile))
+{
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+        for (unsigned int r = 0; r < 16; ++r) {
+            reg[r][i] = prototype.reg[r];
+            stack[r][i] = prototype.stack[r];
+            keyPressed[i][r] = prototype.keyPressed[r];
+        }
+        indexRegister[i] = prototype.indexRegister;
+        programCounter[i] = prototype.programCounter;
+        delayTimer[i] = prototype.delayTimer;
+        soundTimer[i] = prototype.soundTimer;
+        stackPtr[i] = prototype.stackPtr;
+        randomState[i] = prototype.randomState;
+        waitingForKey[i] = prototype.waitingForKey ? 0xFF : 0x00;
+        keyRegister[i] = prototype.keyRegister;
+        remaining[i] = 0;
+        mask[i] = 0;
+        planeMask[i] = prototype.planeMask;
+        std::memcpy(flags[i], prototype.flags, sizeof(flags[i]));
+        displays[i].display = prototype.display;
+        memory[i] = prototype.memory;
+    }
+}
+
+unsigned int Lockstep::lanes() const
+{
+    return laneCount;
+}
+
+void Lockstep::setSeed(unsigned int lane, std::uint32_t seed)
+{
+    randomState[lane] = seed % 0x7FFFFFFF;
+    if (randomState[lane] == 0)
+        randomState[lane] = 1;
+}
+
+void Lockstep::setKey(unsigned int lane, unsigned char key, bool pressed)
+{
+    keyPressed[lane][key & 0xF] = pressed;
+    if (pressed && waitingForKey[lane]) {
+        reg[keyRegister[lane]][lane] = key & 0xF;
+        waitingForKey[lane] = 0x00;
+    }
+}
+
+const Display &Lockstep::getDisplay(unsigned int lane) const
+{
+    return displays[lane].display;
+}
+
+unsigned long Lockstep::groupCount() const
+{
+    return groups;
+}
+
+void Lockstep::extract(unsigned int lane, Chip8 &chip8) const
+{
+    for (unsigned int r = 0; r < 16; ++r) {
+        chip8.reg[r] = reg[r][lane];
+        chip8.stack[r] = stack[r][lane];
+        chip8.keyPressed[r] = keyPressed[lane][r];
+    }
+    chip8.indexRegister = indexRegister[lane];
+    chip8.programCounter = programCounter[lane];
+    chip8.delayTimer = delayTimer[lane];
+    chip8.soundTimer = soundTimer[lane];
+    chip8.stackPtr = stackPtr[lane];
+    chip8.randomState = randomState[lane];
+    chip8.waitingForKey = waitingForKey[lane] != 0;
+    chip8.keyRegister = keyRegister[lane];
+    chip8.planeMask = planeMask[lane];
+    std::memcpy(chip8.flags, flags[lane], sizeof(chip8.flags));
+    chip8.display = displays[lane].display;
+    chip8.dirtyRows = ~0ull;
+    chip8.memory = memory[lane];
+    chip8.setQuirks(quirkProfile);
+    chip8.memoryWritten(0, MEMORY_SIZE);
+    chip8.frontend->setBuzzer(chip8.soundTimer > 0);
+}
+
+void Lockstep::tickTimers()
+{
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+        delayTimer[i] -= delayTimer[i] > 0;
+        soundTimer[i] -= soundTimer[i] > 0;
+    }
+}
+
+void Lockstep::runFrame(unsigned long cycles)
+{
+    runCycles(cycles);
+    tickTimers();
+}
+
+void Lockstep::runCycles(unsigned long cycles)
+{
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+        remaining[i] = i < laneCount && !waitingForKey[i] ? cycles : 0;
+    while (selectGroup())
+        runGroup();
+}
+
+// The lowest PC among lanes with cycles left, and every lane sitting on it.
+bool Lockstep::selectGroup()
+{
+    unsigned int lowest = UINT_MAX;
+
+    for (unsigned int i = 0; i < laneCount; ++i) {
+        if (remaining[i] != 0 && programCounter[i] < lowest) {
+            lowest = programCounter[i];
+            leader = i;
+        }
+    }
+    if (lowest == UINT_MAX)
+        return false;
+
+    groupProgramCounter = lowest;
+    groupBudget = ULONG_MAX;
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+        mask[i] = remaining[i] != 0 && programCounter[i] == lowest ? 0xFF : 0x00;
+        if (mask[i] && remaining[i] < groupBudget)
+            groupBudget = remaining[i];
+    }
+    ++groups;
+    return true;
+}
+
+void Lockstep::runGroup()
+{
+    unsigned long executed = 0;
+    bool diverged = false;
+
+    while (executed < groupBudget && !diverged) {
+        unsigned short opcode = memory[leader].readWord(groupProgramCounter);
+
+        if (memoryWritten)
+            dropMismatched(opcode, executed);
+        diverged = execute(opcode);
+        ++executed;
+    }
+    // A diverging instruction already left each lane's own PC behind.
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+        if (mask[i]) {
+            remaining[i] = waitingForKey[i] ? 0 : remaining[i] - executed;
+            if (!diverged)
+                programCounter[i] = groupProgramCounter;
+        }
+    }
+}
+
+// Lanes whose own code at the group PC differs from the leader's leave the
+// group before running it. Lanes still sharing the leader's code pages
+// cannot differ.
+void Lockstep::dropMismatched(unsigned short opcode, unsigned long executed)
+{
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+        if (!mask[i] || (memory[i].sharesPage(memory[leader], groupProgramCounter)
+                         && memory[i].sharesPage(memory[leader], groupProgramCounter + 1)))
+            continue;
+        if (memory[i].readWord(groupProgramCounter) != opcode) {
+            mask[i] = 0x00;
+            remaining[i] -= executed;
+            programCounter[i] = groupProgramCounter;
+        }
+    }
+}
+
+// After an instruction that wrote programCounter per lane: carries on as a
+// group if every lane went to the same place.
+bool Lockstep::uniformProgramCounter()
+{
+    unsigned short next = programCounter[leader];
+    bool uniform = true;
+
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+        uniform &= !mask[i] || programCounter[i] == next;
+    if (uniform)
+        groupProgramCounter = next;
+    return !uniform;
+}
+
+// A taken skip lands past the next instruction, four bytes on if that is
+// F000 NNNN.
+unsigned short Lockstep::skipTarget(unsigned int lane) const
+{
+    unsigned short next = groupProgramCounter + 2;
+
+    return next + (memory[lane].readWord(next) == 0xF000 ? 4 : 2);
+}
+
+void Lockstep::findSkipTargets()
+{
+    for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+        skipTargets[i] = mask[i] ? skipTarget(i) : 0;
+}
+
+// Runs opcode on the group, mirroring the scalar handler statement by
+// statement. Returns true when the lanes no longer share a PC.
+bool Lockstep::execute(unsigned short opcode)
+{
+    unsigned int x = (opcode & 0x0F00) >> 8;
+    unsigned int y = (opcode & 0x00F0) >> 4;
+    unsigned char n = opcode & 0x00FF;
+    unsigned short address = opcode & 0x0FFF;
+    unsigned int source = quirks.shiftReadsVY ? y : x;
+    unsigned int indexStep = quirks.index == INDEX_PLUS_X ? x : x + 1;
+
+    switch (decodeTable[opcode]) {
+        case CLEAR_SCREEN:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                if (mask[i])
+                    displays[i].display.clear(planeMask[i]);
+            break;
+        case RETURN:
+            LANES(stackPtr, stackPtr[i] - 1);
+            LANES(programCounter, stack[stackPtr[i] & 0xF][i] + 2);
+            return uniformProgramCounter();
+        case GOTO:
+            groupProgramCounter = address;
+            return false;
+        case SUBR_CALL:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                if (mask[i])
+                    stack[stackPtr[i] & 0xF][i] = groupProgramCounter;
+            LANES(stackPtr, stackPtr[i] + 1);
+            groupProgramCounter = address;
+            return false;
+        case JMP_EQ:
+            LANES_SKIP(reg[x][i] == n);
+            return uniformProgramCounter();
+        case JMP_NEQ:
+            LANES_SKIP(reg[x][i] != n);
+            return uniformProgramCounter();
+        case JMP_EQ_REG:
+            LANES_SKIP(reg[x][i] == reg[y][i]);
+            return uniformProgramCounter();
+        case JMP_NEQ_REG:
+            LANES_SKIP(reg[x][i] != reg[y][i]);
+            return uniformProgramCounter();
+        case SET_VAL:
+            LANES(reg[x], n);
+            break;
+        case ADD_VAL:
+            LANES(reg[x], reg[x][i] + n);
+            break;
+        case SET_REG:
+            LANES(reg[x], reg[y][i]);
+            break;
+        case OR:
+            LANES(reg[x], reg[x][i] | reg[y][i]);
+            if (quirks.logicResetsVF)
+                LANES(reg[0xF], 0);
+            break;
+        case AND:
+            LANES(reg[x], reg[x][i] & reg[y][i]);
+            if (quirks.logicResetsVF)
+                LANES(reg[0xF], 0);
+            break;
+        case XOR:
+            LANES(reg[x], reg[x][i] ^ reg[y][i]);
+            if (quirks.logicResetsVF)
+                LANES(reg[0xF], 0);
+            break;
+        case ADD_REG:
+            if (quirks.baselineFlags) {
+                LANES(reg[0xF], reg[y][i] > 0xFF + reg[x][i] ? 1 : 0);
+                LANES(reg[x], reg[x][i] + reg[y][i]);
+            } else {
+                unsigned int sum[LOCKSTEP_LANES];
+                for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                    sum[i] = reg[x][i] + reg[y][i];
+                LANES(reg[x], sum[i]);
+                LANES(reg[0xF], sum[i] >> 8);
+            }
+            break;
+        case SUB_REG:
+            if (quirks.baselineFlags) {
+                LANES(reg[0xF], reg[y][i] > reg[x][i] ? 0 : 1);
+                LANES(reg[x], reg[x][i] - reg[y][i]);
+            } else {
+                unsigned char flag[LOCKSTEP_LANES];
+                for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                    flag[i] = reg[x][i] >= reg[y][i];
+                LANES(reg[x], reg[x][i] - reg[y][i]);
+                LANES(reg[0xF], flag[i]);
+            }
+            break;
+        case RSHIFT_REG:
+            if (quirks.baselineFlags) {
+                LANES(reg[0xF], reg[source][i] & 1);
+                LANES(reg[x], reg[source][i] >> 1);
+            } else {
+                unsigned char value[LOCKSTEP_LANES];
+                for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                    value[i] = reg[source][i];
+                LANES(reg[x], value[i] >> 1);
+                LANES(reg[0xF], value[i] & 1);
+            }
+            break;
+        case SUB_REG_BIS:
+            if (quirks.baselineFlags) {
+                LANES(reg[0xF], reg[x][i] > reg[y][i] ? 0 : 1);
+                LANES(reg[x], reg[y][i] - reg[x][i]);
+            } else {
+                unsigned char flag[LOCKSTEP_LANES];
+                for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                    flag[i] = reg[y][i] >= reg[x][i];
+                LANES(reg[x], reg[y][i] - reg[x][i]);
+                LANES(reg[0xF], flag[i]);
+            }
+            break;
+        case LSHIFT_REG:
+            if (quirks.baselineFlags) {
+                LANES(reg[0xF], lshiftFlag[reg[source][i]]);
+                LANES(reg[x], reg[source][i] << 1);
+            } else {
+                unsigned char value[LOCKSTEP_LANES];
+                for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                    value[i] = reg[source][i];
+                LANES(reg[x], value[i] << 1);
+                LANES(reg[0xF], value[i] >> 7);
+            }
+            break;
+        case SET_I:
+            LANES(indexRegister, address);
+            break;
+        case JMP_TO:
+            LANES(programCounter, reg[quirks.jumpReadsVX ? x : 0][i] + address);
+            return uniformProgramCounter();
+        case SET_REG_RAND:
+            // Park-Miller as in set_reg_rand, the modulo folded (2^31 is 1
+            // modulo 2^31 - 1) so it vectorises.
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                std::uint64_t product = static_cast<std::uint64_t>(randomState[i]) * 48271;
+                std::uint64_t folded = (product & 0x7FFFFFFF) + (product >> 31);
+                std::uint32_t next = folded >= 0x7FFFFFFF ? folded - 0x7FFFFFFF : folded;
+                randomState[i] = mask[i] ? next : randomState[i];
+            }
+            LANES(reg[x], static_cast<unsigned char>(randomState[i] % 0xFF) & n);
+            break;
+        case DRAW_SPRITE:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (!mask[i])
+                    continue;
+                unsigned short height = opcode & 0x000F;
+                bool wide = height == 0;
+                unsigned char sprite[DISPLAY_PLANES * 32];
+                unsigned int bytes;
+                std::uint64_t changedRows = 0;
+
+                if (wide)
+                    height = 16;
+                bytes = height * (wide ? 2 : 1) * __builtin_popcount(planeMask[i]);
+                for (unsigned int b = 0; b < bytes; ++b)
+                    sprite[b] = memory[i][indexRegister[i] + b];
+                if (quirks.spritesWrap)
+                    reg[0xF][i] = displays[i].display.draw<true>(planeMask[i], reg[x][i], reg[y][i], sprite, height, wide, changedRows);
+                else
+                    reg[0xF][i] = displays[i].display.draw(planeMask[i], reg[x][i], reg[y][i], sprite, height, wide, changedRows);
+            }
+            break;
+        case JMP_KEY_PRESSED:
+            LANES_SKIP(keyPressed[i][reg[x][i] & 0xF]);
+            return uniformProgramCounter();
+        case JMP_NKEY_PRESSED:
+            LANES_SKIP(!keyPressed[i][reg[x][i] & 0xF]);
+            return uniformProgramCounter();
+        case GET_DELAY:
+            LANES(reg[x], delayTimer[i]);
+            break;
+        case SET_DELAY_TMR:
+            LANES(delayTimer, reg[x][i]);
+            break;
+        case SET_SOUND_TMR:
+            LANES(soundTimer, reg[x][i]);
+            break;
+        case ADD_I:
+            LANES(indexRegister, indexRegister[i] + reg[x][i]);
+            break;
+        case SET_I_CHAR:
+            LANES(indexRegister, reg[x][i] * 5);
+            break;
+        case STORES_BINARY:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (mask[i]) {
+                    unsigned char digits[3] = {
+                            static_cast<unsigned char>(reg[x][i] / 100),
+                            static_cast<unsigned char>((reg[x][i] / 10) % 10),
+                            static_cast<unsigned char>((reg[x][i] % 100) % 10)
+                    };
+                    memory[i].write(indexRegister[i], digits, sizeof(digits));
+                }
+            }
+            memoryWritten = true;
+            break;
+        case REG_DUMP:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (mask[i]) {
+                    unsigned char registers[16];
+                    for (unsigned int r = 0; r <= x; ++r)
+                        registers[r] = reg[r][i];
+                    memory[i].write(indexRegister[i], registers, x + 1);
+                }
+            }
+            memoryWritten = true;
+            if (quirks.index != INDEX_UNCHANGED)
+                LANES(indexRegister, indexRegister[i] + indexStep);
+            break;
+        case REG_LOAD:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (mask[i]) {
+                    unsigned char registers[16];
+                    memory[i].read(indexRegister[i], registers, x + 1);
+                    for (unsigned int r = 0; r <= x; ++r)
+                        reg[r][i] = registers[r];
+                }
+            }
+            if (quirks.index != INDEX_UNCHANGED)
+                LANES(indexRegister, indexRegister[i] + indexStep);
+            break;
+        case SCROLL_DOWN:
+        case SCROLL_UP:
+        case SCROLL_RIGHT:
+        case SCROLL_LEFT:
+        case LORES:
+        case HIRES:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (!mask[i])
+                    continue;
+                switch (decodeTable[opcode]) {
+                    case SCROLL_DOWN:
+                        displays[i].display.scrollDown(planeMask[i], opcode & 0x000F);
+                        break;
+                    case SCROLL_UP:
+                        displays[i].display.scrollUp(planeMask[i], opcode & 0x000F);
+                        break;
+                    case SCROLL_RIGHT:
+                        displays[i].display.scrollRight(planeMask[i]);
+                        break;
+                    case SCROLL_LEFT:
+                        displays[i].display.scrollLeft(planeMask[i]);
+                        break;
+                    default:
+                        displays[i].display.setHires(decodeTable[opcode] == HIRES);
+                        break;
+                }
+            }
+            break;
+        case EXIT:
+            // Stops the scalar machine with its PC on the 00FD, the lanes
+            // just spin on it.
+            return false;
+        case SET_I_BIG_CHAR:
+            LANES(indexRegister, BIG_FONTSET_ADDRESS + (reg[x][i] & 0xF) * 10);
+            break;
+        case SAVE_FLAGS:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                if (mask[i])
+                    for (unsigned int r = 0; r <= x; ++r)
+                        flags[i][r] = reg[r][i];
+            break;
+        case LOAD_FLAGS:
+            for (unsigned int r = 0; r <= x; ++r)
+                LANES(reg[r], flags[i][r]);
+            break;
+        case SAVE_RANGE:
+        case LOAD_RANGE: {
+            int step = x <= y ? 1 : -1;
+            unsigned int count = (x <= y ? y - x : x - y) + 1;
+
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i) {
+                if (!mask[i])
+                    continue;
+                unsigned char values[16];
+                if (decodeTable[opcode] == SAVE_RANGE) {
+                    for (unsigned int r = 0; r < count; ++r)
+                        values[r] = reg[x + r * step][i];
+                    memory[i].write(indexRegister[i], values, count);
+                } else {
+                    memory[i].read(indexRegister[i], values, count);
+                    for (unsigned int r = 0; r < count; ++r)
+                        reg[x + r * step][i] = values[r];
+                }
+            }
+            if (decodeTable[opcode] == SAVE_RANGE)
+                memoryWritten = true;
+            break;
+        }
+        case SET_I_LONG:
+            for (unsigned int i = 0; i < LOCKSTEP_LANES; ++i)
+                if (mask[i])
+                    indexRegister[i] = memory[i].readWord(groupProgramCounter + 2);
+            groupProgramCounter += 4;
+            return false;
+        case SELECT_PLANES:
+            LANES(planeMask, x & ALL_PLANES);
+            break;
+        case GET_KEY:
+            // The whole group halts until setKey presses a key.
+            LANES(keyRegister, x);
+            LANES(waitingForKey, 0xFF);
+            LANES(programCounter, groupProgramCounter + 2);
+            return true;
+        default:
+            // UNKNOWN and the XO-CHIP audio opcodes only move on, like
+            // their scalar handlers.
+            break;
+    }
+    groupProgramCounter += 2;
+    return false;
+}
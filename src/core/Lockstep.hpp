@@ -0,0 +1,93 @@
+#ifndef NESEMULATOR_LOCKSTEP_HPP
+#define NESEMULATOR_LOCKSTEP_HPP
+
+#include <array>
+#include <cstdint>
+#include "Chip8.hpp"
+
+#define LOCKSTEP_LANES 64
+
+// Up to LOCKSTEP_LANES copies of one machine run side by side, for Monte
+// Carlo runs of a ROM over different seeds and inputs. State is laid out
+// as one array per register, indexed by lane. Lanes that share a PC form a
+// group and each instruction is applied to the whole group with masked
+// loops the compiler vectorises. A group lasts until a skip, return or
+// BNNN sends its lanes to different places; the lanes are then regrouped
+// starting from the lowest PC so they reconverge.
+//
+// Every lane ends bit-identical to a scalar Chip8 running the same number
+// of cycles. Memory is one PagedMemory per lane, so lanes share the ROM
+// until one of them writes to it.
+class Lockstep {
+    public:
+        // All lanes start as copies of prototype. About 270 KB, keep it on
+        // the heap.
+        explicit Lockstep(const Chip8 &prototype, unsigned int laneCount = LOCKSTEP_LANES);
+        unsigned int lanes() const;
+        void setSeed(unsigned int lane, std::uint32_t seed);
+        // A key event, applied between frames like Chip8 applies its
+        // input. A press resumes a lane halted in FX0A.
+        void setKey(unsigned int lane, unsigned char key, bool pressed);
+        // cycles instructions on every lane.
+        void runCycles(unsigned long cycles);
+        void tickTimers();
+        void runFrame(unsigned long cycles);
+        const Display &getDisplay(unsigned int lane) const;
+        // Copies a lane into a scalar machine, to save it or carry on alone.
+        void extract(unsigned int lane, Chip8 &chip8) const;
+        // Groups formed so far: the instructions per group give the
+        // average SIMD run length.
+        unsigned long groupCount() const;
+    private:
+        bool selectGroup();
+        void runGroup();
+        void dropMismatched(unsigned short opcode, unsigned long executed);
+        bool execute(unsigned short opcode);
+        bool uniformProgramCounter();
+        unsigned short skipTarget(unsigned int lane) const;
+        void findSkipTargets();
+        static const std::array<unsigned char, 256> lshiftFlag;
+        unsigned int laneCount;
+        // The prototype's, tested per group instruction rather than
+        // instantiated: one branch is shared by every lane.
+        QuirkProfile quirkProfile;
+        QuirkSettings quirks;
+        // Current group: lanes in it (0xFF) or not (0x00), the lane whose
+        // memory is fetched from, their shared PC and how many instructions
+        // every lane of the group still has to run.
+        alignas(32) unsigned char mask[LOCKSTEP_LANES];
+        unsigned int leader = 0;
+        unsigned short groupProgramCounter = 0;
+        unsigned long groupBudget = 0;
+        unsigned long groups = 0;
+        // Set once a lane writes memory: lanes at the same PC may then
+        // hold different code.
+        bool memoryWritten = false;
+        alignas(32) unsigned char reg[16][LOCKSTEP_LANES];
+        alignas(32) unsigned short indexRegister[LOCKSTEP_LANES];
+        alignas(32) unsigned short programCounter[LOCKSTEP_LANES];
+        alignas(32) unsigned char delayTimer[LOCKSTEP_LANES];
+        alignas(32) unsigned char soundTimer[LOCKSTEP_LANES];
+        alignas(32) unsigned short stack[16][LOCKSTEP_LANES];
+        alignas(32) unsigned short stackPtr[LOCKSTEP_LANES];
+        alignas(32) std::uint32_t randomState[LOCKSTEP_LANES];
+        alignas(32) unsigned long remaining[LOCKSTEP_LANES];
+        // 0xFF while halted in FX0A, and the register the key goes to.
+        alignas(32) unsigned char waitingForKey[LOCKSTEP_LANES];
+        alignas(32) unsigned char keyRegister[LOCKSTEP_LANES];
+        // Where a taken skip at the group PC lands in each lane.
+        alignas(32) unsigned short skipTargets[LOCKSTEP_LANES];
+        alignas(32) unsigned char planeMask[LOCKSTEP_LANES];
+        unsigned char flags[LOCKSTEP_LANES][16];
+        bool keyPressed[LOCKSTEP_LANES][16];
+        // A Display is just over 2 KB: padded to 33 cache lines so the same
+        // row of every lane does not land in the same few cache sets.
+        struct LaneDisplay {
+            Display display;
+            unsigned char padding[56];
+        };
+        LaneDisplay displays[LOCKSTEP_LANES];
+        PagedMemory memory[LOCKSTEP_LANES];
+};
+
+#endif //NESEMULATOR_LOCKSTEP_HPP
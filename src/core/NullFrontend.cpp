@@ -0,0 +1,18 @@
+#include "NullFrontend.hpp"
+
+bool NullFrontend::isOpen() const
+{
+    return true;
+}
+
+void NullFrontend::pollInput(InputQueue &)
+{
+}
+
+void NullFrontend::present(const Display &, std::uint64_t)
+{
+}
+
+void NullFrontend::setBuzzer(bool)
+{
+}
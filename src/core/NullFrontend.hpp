@@ -0,0 +1,16 @@
+#ifndef NESEMULATOR_NULLFRONTEND_HPP
+#define NESEMULATOR_NULLFRONTEND_HPP
+
+#include "Frontend.hpp"
+
+// Headless frontend: never closes, no key is ever pressed, frames and
+// sound are dropped.
+class NullFrontend : public Frontend {
+    public:
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+};
+
+#endif //NESEMULATOR_NULLFRONTEND_HPP
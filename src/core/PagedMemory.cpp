@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cstring>
+#include "PagedMemory.hpp"
+
+PagedMemory::PagedMemory()
+{
+    for (Page *&page : pages)
+        page = acquire(zeroPage());
+}
+
+PagedMemory::PagedMemory(const PagedMemory &other)
+{
+    for (unsigned int i = 0; i < MEMORY_PAGE_COUNT; ++i)
+        pages[i] = acquire(other.pages[i]);
+}
+
+PagedMemory &PagedMemory::operator=(const PagedMemory &other)
+{
+    for (unsigned int i = 0; i < MEMORY_PAGE_COUNT; ++i) {
+        Page *page = acquire(other.pages[i]);
+        release(pages[i]);
+        pages[i] = page;
+    }
+    return *this;
+}
+
+PagedMemory::~PagedMemory()
+{
+    for (Page *page : pages)
+        release(page);
+}
+
+// Never freed: the static reference keeps the count above zero.
+PagedMemory::Page *PagedMemory::zeroPage()
+{
+    static Page page;
+
+    return &page;
+}
+
+PagedMemory::Page *PagedMemory::acquire(Page *page)
+{
+    page->references.fetch_add(1, std::memory_order_relaxed);
+    return page;
+}
+
+void PagedMemory::release(Page *page)
+{
+    if (page->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete page;
+}
+
+// Makes pages[index] private to this copy before a write.
+PagedMemory::Page *PagedMemory::own(unsigned int index)
+{
+    Page *page = pages[index];
+
+    if (page->references.load(std::memory_order_acquire) != 1) {
+        Page *copy = new Page;
+        std::memcpy(copy->bytes, page->bytes, MEMORY_PAGE_SIZE);
+        release(page);
+        pages[index] = copy;
+        page = copy;
+    }
+    return page;
+}
+
+void PagedMemory::write(unsigned int address, unsigned char value)
+{
+    address %= MEMORY_SIZE;
+    own(address / MEMORY_PAGE_SIZE)->bytes[address % MEMORY_PAGE_SIZE] = value;
+}
+
+void PagedMemory::read(unsigned int address, void *data, std::size_t length) const
+{
+    unsigned char *out = static_cast<unsigned char *>(data);
+
+    while (length > 0) {
+        address %= MEMORY_SIZE;
+        std::size_t offset = address % MEMORY_PAGE_SIZE;
+        std::size_t chunk = std::min(length, MEMORY_PAGE_SIZE - offset);
+        std::memcpy(out, pages[address / MEMORY_PAGE_SIZE]->bytes + offset, chunk);
+        out += chunk;
+        address += chunk;
+        length -= chunk;
+    }
+}
+
+void PagedMemory::write(unsigned int address, const void *data, std::size_t length)
+{
+    const unsigned char *in = static_cast<const unsigned char *>(data);
+
+    while (length > 0) {
+        address %= MEMORY_SIZE;
+        unsigned int index = address / MEMORY_PAGE_SIZE;
+        std::size_t offset = address % MEMORY_PAGE_SIZE;
+        std::size_t chunk = std::min(length, MEMORY_PAGE_SIZE - offset);
+        // Rewriting a shared page with what it already holds (state loads
+        // of a sibling) keeps it shared.
+        if (pages[index]->references.load(std::memory_order_acquire) == 1
+            || std::memcmp(pages[index]->bytes + offset, in, chunk) != 0)
+            std::memcpy(own(index)->bytes + offset, in, chunk);
+        in += chunk;
+        address += chunk;
+        length -= chunk;
+    }
+}
+
+void PagedMemory::clear()
+{
+    for (Page *&page : pages) {
+        release(page);
+        page = acquire(zeroPage());
+    }
+}
+
+void PagedMemory::clearPage(unsigned int index)
+{
+    if (pages[index] != zeroPage()) {
+        release(pages[index]);
+        pages[index] = acquire(zeroPage());
+    }
+}
+
+bool PagedMemory::isZeroPage(unsigned int index) const
+{
+    return pages[index] == zeroPage() || std::memcmp(pages[index]->bytes, zeroPage()->bytes, MEMORY_PAGE_SIZE) == 0;
+}
+
+std::size_t PagedMemory::sharedPages() const
+{
+    return std::count_if(pages, pages + MEMORY_PAGE_COUNT, [](const Page *page) {
+        return page->references.load(std::memory_order_relaxed) > 1;
+    });
+}
@@ -0,0 +1,63 @@
+#ifndef NESEMULATOR_PAGEDMEMORY_HPP
+#define NESEMULATOR_PAGEDMEMORY_HPP
+
+#include <atomic>
+#include <cstddef>
+
+#define MEMORY_SIZE 65536
+#define MEMORY_PAGE_SIZE 256
+#define MEMORY_PAGE_COUNT (MEMORY_SIZE / MEMORY_PAGE_SIZE)
+
+// The 64 KB XO-CHIP address space as refcounted copy-on-write pages.
+// Copies share every page and a page is duplicated on the first write
+// through a copy that does not own it alone. Addresses wrap at 64 KB.
+class PagedMemory {
+    public:
+        PagedMemory();
+        PagedMemory(const PagedMemory &other);
+        PagedMemory &operator=(const PagedMemory &other);
+        ~PagedMemory();
+        // Hot path, kept inline: one extra load over a flat array.
+        unsigned char operator[](unsigned int address) const
+        {
+            return pages[(address / MEMORY_PAGE_SIZE) % MEMORY_PAGE_COUNT]->bytes[address % MEMORY_PAGE_SIZE];
+        }
+        // Big-endian opcode fetch, one page lookup unless it straddles two.
+        unsigned short readWord(unsigned int address) const
+        {
+            const unsigned char *bytes = pages[(address / MEMORY_PAGE_SIZE) % MEMORY_PAGE_COUNT]->bytes;
+
+            if (address % MEMORY_PAGE_SIZE != MEMORY_PAGE_SIZE - 1)
+                return bytes[address % MEMORY_PAGE_SIZE] << 8 | bytes[address % MEMORY_PAGE_SIZE + 1];
+            return bytes[MEMORY_PAGE_SIZE - 1] << 8 | (*this)[address + 1];
+        }
+        void write(unsigned int address, unsigned char value);
+        void read(unsigned int address, void *data, std::size_t length) const;
+        void write(unsigned int address, const void *data, std::size_t length);
+        // Back to all zeroes, sharing the process-wide zero page.
+        void clear();
+        // Page index alone back to the zero page.
+        void clearPage(unsigned int index);
+        // Whether page index reads as all zeroes, without looking at it
+        // when it is the zero page. Save states leave those out.
+        bool isZeroPage(unsigned int index) const;
+        // Whether address reads from the same page in both copies.
+        bool sharesPage(const PagedMemory &other, unsigned int address) const
+        {
+            return pages[(address / MEMORY_PAGE_SIZE) % MEMORY_PAGE_COUNT] == other.pages[(address / MEMORY_PAGE_SIZE) % MEMORY_PAGE_COUNT];
+        }
+        // Pages currently shared with another copy.
+        std::size_t sharedPages() const;
+    private:
+        struct Page {
+            std::atomic<unsigned int> references{1};
+            unsigned char bytes[MEMORY_PAGE_SIZE]{};
+        };
+        static Page *zeroPage();
+        static Page *acquire(Page *page);
+        static void release(Page *page);
+        Page *own(unsigned int index);
+        Page *pages[MEMORY_PAGE_COUNT];
+};
+
+#endif //NESEMULATOR_PAGEDMEMORY_HPP
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <numeric>
+#include "Profiler.hpp"
+#include "Chip8.hpp"
+
+Profiler::DrawScope::DrawScope(Profiler *profiler) : profiler(profiler)
+{
+    if (profiler != nullptr)
+        start = Clock::now();
+}
+
+Profiler::DrawScope::~DrawScope()
+{
+    if (profiler != nullptr)
+        profiler->drawTime += Clock::now() - start;
+}
+
+Profiler::Profiler()
+{
+    clear();
+}
+
+void Profiler::clear()
+{
+    opcodeCounts.assign(UNKNOWN + 1, 0);
+    programCounterCounts.assign(0x10000, 0);
+    instructions = 0;
+    drawTime = Clock::duration::zero();
+    runTime = Clock::duration::zero();
+    frames.assign(1, Frame{0x200, -1, 0, {}});
+    current = 0;
+    depth = 0;
+    overflowDepth = 0;
+}
+
+void Profiler::record(unsigned short programCounter, unsigned short opcode, unsigned char instruction)
+{
+    ++instructions;
+    ++opcodeCounts[instruction];
+    ++programCounterCounts[programCounter];
+    ++frames[current].samples;
+    if (instruction == SUBR_CALL)
+        enter(opcode & 0x0FFF);
+    else if (instruction == RETURN)
+        leave();
+}
+
+void Profiler::enter(unsigned short address)
+{
+    // Runaway recursion is folded into the deepest frame.
+    if (depth >= MAX_DEPTH) {
+        ++overflowDepth;
+        return;
+    }
+    ++depth;
+    for (int child : frames[current].children) {
+        if (frames[child].address == address) {
+            current = child;
+            return;
+        }
+    }
+    frames.push_back(Frame{address, current, 0, {}});
+    frames[current].children.push_back(frames.size() - 1);
+    current = frames.size() - 1;
+}
+
+void Profiler::leave()
+{
+    if (overflowDepth > 0) {
+        --overflowDepth;
+        return;
+    }
+    // A return without a matching call (we started mid-program) stays at
+    // the root.
+    if (frames[current].parent >= 0) {
+        current = frames[current].parent;
+        --depth;
+    }
+}
+
+void Profiler::addRunTime(Clock::duration duration)
+{
+    runTime += duration;
+}
+
+std::uint64_t Profiler::instructionCount() const
+{
+    return instructions;
+}
+
+std::uint64_t Profiler::opcodeCount(unsigned char instruction) const
+{
+    return instruction <= UNKNOWN ? opcodeCounts[instruction] : 0;
+}
+
+std::uint64_t Profiler::programCounterCount(unsigned short programCounter) const
+{
+    return programCounterCounts[programCounter];
+}
+
+std::uint64_t Profiler::drawNanoseconds() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(drawTime).count();
+}
+
+std::uint64_t Profiler::runNanoseconds() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(runTime).count();
+}
+
+void Profiler::dumpFlat(std::FILE *file, std::size_t topAddresses) const
+{
+    double total = instructions > 0 ? instructions : 1;
+    std::vector<unsigned int> order(opcodeCounts.size());
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) {
+        return opcodeCounts[a] > opcodeCounts[b];
+    });
+    std::fprintf(file, "instructions %llu\n", static_cast<unsigned long long>(instructions));
+    std::fprintf(file, "run_ns %llu draw_sprite_ns %llu other_ns %llu\n\n",
+                 static_cast<unsigned long long>(runNanoseconds()),
+                 static_cast<unsigned long long>(drawNanoseconds()),
+                 static_cast<unsigned long long>(runNanoseconds() - std::min(runNanoseconds(), drawNanoseconds())));
+    std::fprintf(file, "%-16s %12s %7s\n", "opcode", "count", "%");
+    for (unsigned int instruction : order) {
+        if (opcodeCounts[instruction] == 0)
+            break;
+        std::fprintf(file, "%-16s %12llu %6.2f%%\n", opCodeNames[instruction],
+                     static_cast<unsigned long long>(opcodeCounts[instruction]),
+                     100.0 * opcodeCounts[instruction] / total);
+    }
+
+    std::vector<unsigned int> addresses;
+    for (unsigned int address = 0; address < programCounterCounts.size(); ++address)
+        if (programCounterCounts[address] != 0)
+            addresses.push_back(address);
+    std::sort(addresses.begin(), addresses.end(), [this](unsigned int a, unsigned int b) {
+        return programCounterCounts[a] > programCounterCounts[b];
+    });
+    if (addresses.size() > topAddresses)
+        addresses.resize(topAddresses);
+    std::fprintf(file, "\n%-16s %12s %7s\n", "pc", "count", "%");
+    for (unsigned int address : addresses)
+        std::fprintf(file, "0x%03X            %12llu %6.2f%%\n", address,
+                     static_cast<unsigned long long>(programCounterCounts[address]),
+                     100.0 * programCounterCounts[address] / total);
+}
+
+// One "0x200;0x2A4;0x31C <samples>" line per call stack, the format
+// flamegraph.pl and speedscope read.
+void Profiler::dumpCollapsed(std::FILE *file) const
+{
+    for (std::size_t frame = 0; frame < frames.size(); ++frame) {
+        if (frames[frame].samples == 0)
+            continue;
+        writeStack(file, frame);
+        std::fprintf(file, " %llu\n", static_cast<unsigned long long>(frames[frame].samples));
+    }
+}
+
+void Profiler::writeStack(std::FILE *file, int frame) const
+{
+    if (frames[frame].parent >= 0) {
+        writeStack(file, frames[frame].parent);
+        std::fputc(';', file);
+    }
+    std::fprintf(file, "0x%03X", frames[frame].address);
+}
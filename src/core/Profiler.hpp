@@ -0,0 +1,60 @@
+#ifndef NESEMULATOR_PROFILER_HPP
+#define NESEMULATOR_PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Execution counts per OpCode and per program counter, host time spent in
+// draw_sprite against the whole run, and samples per CHIP-8 call stack
+// (followed through 2NNN / 00EE).
+class Profiler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        // Adds the lifetime of the scope to the draw time, if profiling.
+        class DrawScope {
+            public:
+                explicit DrawScope(Profiler *profiler);
+                ~DrawScope();
+            private:
+                Profiler *profiler;
+                Clock::time_point start;
+        };
+
+        Profiler();
+        void record(unsigned short programCounter, unsigned short opcode, unsigned char instruction);
+        void addRunTime(Clock::duration duration);
+        void clear();
+        std::uint64_t instructionCount() const;
+        std::uint64_t opcodeCount(unsigned char instruction) const;
+        std::uint64_t programCounterCount(unsigned short programCounter) const;
+        std::uint64_t drawNanoseconds() const;
+        std::uint64_t runNanoseconds() const;
+        void dumpFlat(std::FILE *file, std::size_t topAddresses = 32) const;
+        void dumpCollapsed(std::FILE *file) const;
+    private:
+        struct Frame {
+            unsigned short address;
+            int parent;
+            std::uint64_t samples;
+            std::vector<int> children;
+        };
+        static const std::size_t MAX_DEPTH = 64;
+        void enter(unsigned short address);
+        void leave();
+        void writeStack(std::FILE *file, int frame) const;
+        std::vector<std::uint64_t> opcodeCounts;
+        std::vector<std::uint64_t> programCounterCounts;
+        std::uint64_t instructions = 0;
+        Clock::duration drawTime{};
+        Clock::duration runTime{};
+        // frames[0] is the program entry, current is the innermost call.
+        std::vector<Frame> frames;
+        int current = 0;
+        std::size_t depth = 0;
+        std::size_t overflowDepth = 0;
+};
+
+#endif //NESEMULATOR_PROFILER_HPP
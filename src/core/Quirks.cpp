@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "Quirks.hpp"
+#include "Hash.hpp"
+
+QuirkSettings quirkSettings(QuirkProfile profile)
+{
+    QuirkSettings settings{};
+
+    withQuirks(profile, [&settings](auto quirks) {
+        typedef decltype(quirks) Quirks;
+        settings = {Quirks::shiftReadsVY, Quirks::index, Quirks::jumpReadsVX, Quirks::logicResetsVF, Quirks::spritesWrap,
+                    Quirks::baselineFlags};
+    });
+    return settings;
+}
+
+bool parseQuirkProfile(const char *name, QuirkProfile &profile)
+{
+    for (int i = 0; i < QUIRK_PROFILE_COUNT; ++i) {
+        if (std::strcmp(name, quirkProfileNames[i]) == 0) {
+            profile = static_cast<QuirkProfile>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function local like the recompiled programs' registry.
+static std::map<std::uint64_t, QuirkProfile> &quirkDatabase()
+{
+    static std::map<std::uint64_t, QuirkProfile> database;
+    return database;
+}
+
+bool loadQuirkDatabase(const std::string &filePath, std::string &error)
+{
+    std::ifstream inFile(filePath);
+    std::string line;
+    unsigned long lineNumber = 0;
+    std::map<std::uint64_t, QuirkProfile> entries;
+
+    if (!inFile) {
+        error = "cannot open " + filePath;
+        return false;
+    }
+    while (std::getline(inFile, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string hash;
+        std::string name;
+        char *end;
+        QuirkProfile profile;
+
+        if (!(fields >> hash))
+            continue;
+        std::uint64_t value = std::strtoull(hash.c_str(), &end, 16);
+        if (*end != '\0' || !(fields >> name) || !parseQuirkProfile(name.c_str(), profile)) {
+            error = filePath + ":" + std::to_string(lineNumber) + ": expected <hash> <profile>";
+            return false;
+        }
+        entries[value] = profile;
+    }
+    // All or nothing, a bad line leaves the database as it was.
+    for (const std::pair<const std::uint64_t, QuirkProfile> &entry : entries)
+        quirkDatabase()[entry.first] = entry.second;
+    return true;
+}
+
+bool findQuirkProfile(const unsigned char *rom, std::size_t size, QuirkProfile &profile)
+{
+    const std::map<std::uint64_t, QuirkProfile> &database = quirkDatabase();
+
+    if (database.empty())
+        return false;
+
+    std::map<std::uint64_t, QuirkProfile>::const_iterator entry = database.find(fnv1a64(rom, size));
+    if (entry == database.end())
+        return false;
+    profile = entry->second;
+    return true;
+}
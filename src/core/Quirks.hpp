@@ -0,0 +1,142 @@
+#ifndef NESEMULATOR_QUIRKS_HPP
+#define NESEMULATOR_QUIRKS_HPP
+
+#include <cstddef>
+#include <string>
+
+// The behaviours CHIP-8 variants disagree on, one policy type per profile.
+// The interpreter handlers that depend on them are templates over the
+// policy, so every profile gets its own interpreter with the quirks folded
+// in at compile time, and only picking the interpreter looks at the
+// profile.
+enum QuirkProfile {
+    // What this interpreter has always done: a mix of the others.
+    QUIRKS_DEFAULT,
+    QUIRKS_COSMAC_VIP,
+    QUIRKS_CHIP48,
+    QUIRKS_SCHIP,
+    QUIRKS_XO_CHIP,
+    QUIRK_PROFILE_COUNT
+};
+
+const char *const quirkProfileNames[QUIRK_PROFILE_COUNT] = {
+        "default",
+        "vip",
+        "chip48",
+        "schip",
+        "xochip",
+};
+
+// What FX55 / FX65 leave in I.
+enum IndexQuirk {
+    INDEX_UNCHANGED,
+    INDEX_PLUS_X,
+    INDEX_PLUS_X_PLUS_1
+};
+
+// shiftReadsVY: 8XY6 / 8XYE shift VY into VX rather than VX in place.
+// index: I after FX55 / FX65.
+// jumpReadsVX: BXNN jumps to XNN + VX rather than BNNN to NNN + V0.
+// logicResetsVF: 8XY1 / 8XY2 / 8XY3 clear VF.
+// spritesWrap: DXYN wraps sprites around the screen edges instead of
+// clipping them. The start position wraps either way.
+// baselineFlags: 8XY4 / 8XY5 / 8XY6 / 8XY7 / 8XYE set VF the way this
+// interpreter always has: before VX, with the operands read again after
+// it, 8XY4 never carrying and 8XYE's flag being getMSB's byte. Otherwise
+// VF is written last and is the carry, no-borrow or shifted out bit of the
+// original operands, 0 or 1.
+struct DefaultQuirks {
+    static constexpr bool shiftReadsVY = false;
+    static constexpr IndexQuirk index = INDEX_UNCHANGED;
+    static constexpr bool jumpReadsVX = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool spritesWrap = false;
+    static constexpr bool baselineFlags = true;
+};
+
+struct CosmacVipQuirks {
+    static constexpr bool shiftReadsVY = true;
+    static constexpr IndexQuirk index = INDEX_PLUS_X_PLUS_1;
+    static constexpr bool jumpReadsVX = false;
+    static constexpr bool logicResetsVF = true;
+    static constexpr bool spritesWrap = false;
+    static constexpr bool baselineFlags = false;
+};
+
+struct Chip48Quirks {
+    static constexpr bool shiftReadsVY = false;
+    static constexpr IndexQuirk index = INDEX_PLUS_X;
+    static constexpr bool jumpReadsVX = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool spritesWrap = false;
+    static constexpr bool baselineFlags = false;
+};
+
+struct SuperChipQuirks {
+    static constexpr bool shiftReadsVY = false;
+    static constexpr IndexQuirk index = INDEX_UNCHANGED;
+    static constexpr bool jumpReadsVX = true;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool spritesWrap = false;
+    static constexpr bool baselineFlags = false;
+};
+
+struct XoChipQuirks {
+    static constexpr bool shiftReadsVY = true;
+    static constexpr IndexQuirk index = INDEX_PLUS_X_PLUS_1;
+    static constexpr bool jumpReadsVX = false;
+    static constexpr bool logicResetsVF = false;
+    static constexpr bool spritesWrap = true;
+    static constexpr bool baselineFlags = false;
+};
+
+// Calls function with a value of profile's policy type, so a generic
+// lambda can instantiate what it calls for exactly that policy.
+template<class Function>
+void withQuirks(QuirkProfile profile, Function &&function)
+{
+    switch (profile) {
+        case QUIRKS_COSMAC_VIP:
+            function(CosmacVipQuirks());
+            break;
+        case QUIRKS_CHIP48:
+            function(Chip48Quirks());
+            break;
+        case QUIRKS_SCHIP:
+            function(SuperChipQuirks());
+            break;
+        case QUIRKS_XO_CHIP:
+            function(XoChipQuirks());
+            break;
+        default:
+            function(DefaultQuirks());
+            break;
+    }
+}
+
+// A policy as plain values, for the code that cannot be instantiated per
+// profile and tests them as it runs.
+struct QuirkSettings {
+    bool shiftReadsVY;
+    IndexQuirk index;
+    bool jumpReadsVX;
+    bool logicResetsVF;
+    bool spritesWrap;
+    bool baselineFlags;
+};
+
+QuirkSettings quirkSettings(QuirkProfile profile);
+
+// Accepts the quirkProfileNames.
+bool parseQuirkProfile(const char *name, QuirkProfile &profile);
+
+// The ROM database: lines of "<hash> <profile>", '#' comments, the hash
+// being the hex fnv1a64 of the ROM as chip8_rompack lists it. Loaded
+// entries add to and override the ones already there. Load it before any
+// machine loads a ROM, lookups are not synchronised with loading.
+bool loadQuirkDatabase(const std::string &filePath, std::string &error);
+
+// The database's profile for exactly this ROM, if it has one.
+bool findQuirkProfile(const unsigned char *rom, std::size_t size, QuirkProfile &profile);
+
+#endif //NESEMULATOR_QUIRKS_HPP
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstring>
+#include "Recompiled.hpp"
+#include "RecompiledMachine.hpp"
+#include "Hash.hpp"
+
+// Function local so registrations from other translation units' static
+// initialisers never run before it exists.
+static std::vector<const RecompiledProgram *> &registeredPrograms()
+{
+    static std::vector<const RecompiledProgram *> programs;
+    return programs;
+}
+
+RecompiledRegistration::RecompiledRegistration(const RecompiledProgram &program)
+{
+    registeredPrograms().push_back(&program);
+}
+
+const RecompiledProgram *findRecompiledProgram(const unsigned char *rom, std::size_t size)
+{
+    const std::vector<const RecompiledProgram *> &programs = registeredPrograms();
+
+    if (programs.empty())
+        return nullptr;
+
+    std::uint64_t hash = fnv1a64(rom, size);
+    for (const RecompiledProgram *program : programs)
+        if (program->romHash == hash && program->romSize == size && std::memcmp(program->rom, rom, size) == 0)
+            return program;
+    return nullptr;
+}
+
+void Recompiled::attach(const RecompiledProgram *newProgram)
+{
+    program = newProgram;
+    stale.assign(program != nullptr ? program->blockCount : 0, false);
+}
+
+// The whole loop lives here rather than in Chip8::runCycles so a block
+// costs a table lookup and a call, not an extra call into this file.
+unsigned long Recompiled::run(Chip8 &chip8, unsigned long cycles)
+{
+    RecompiledMachine machine(chip8);
+
+    while (cycles > 0 && !chip8.waitingForKey) {
+        unsigned short from = chip8.programCounter;
+        unsigned int offset = from - 0x200u;
+        std::int32_t index = offset < program->romSize ? program->blockAt[offset] : -1;
+
+        if (index >= 0 && !stale[index] && program->blocks[index].instructions <= cycles) {
+            const RecompiledBlock &block = program->blocks[index];
+            chip8.programCounter = block.run(machine);
+            cycles -= block.instructions;
+        } else {
+            chip8.interpret(1);
+            --cycles;
+        }
+        if (chip8.programCounter <= from && cycles > 0)
+            cycles = chip8.skipIdleLoop(cycles);
+    }
+    return cycles;
+}
+
+void Recompiled::invalidate(const Chip8 &chip8, unsigned int address, unsigned int length)
+{
+    unsigned int end = address + length;
+    // Block ends grow with their addresses, so the first one ending past
+    // address is the first that can overlap.
+    const RecompiledBlock *first = std::upper_bound(
+            program->blocks, program->blocks + program->blockCount, address,
+            [](unsigned int value, const RecompiledBlock &block) {
+                return value < static_cast<unsigned int>(block.address + block.length);
+            });
+    unsigned char bytes[RECOMPILED_MAX_BLOCK_LENGTH];
+
+    for (const RecompiledBlock *block = first; block != program->blocks + program->blockCount && block->address < end; ++block) {
+        chip8.memory.read(block->address, bytes, block->length);
+        stale[block - program->blocks] = std::memcmp(bytes, program->rom + (block->address - 0x200), block->length) != 0;
+    }
+}
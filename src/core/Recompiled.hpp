@@ -0,0 +1,74 @@
+#ifndef NESEMULATOR_RECOMPILED_HPP
+#define NESEMULATOR_RECOMPILED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Chip8;
+class RecompiledMachine;
+
+// Blocks are capped like the JIT's. F000 NNNN is the one four byte
+// instruction and a closing skip adds the word after it.
+#define RECOMPILED_MAX_BLOCK_INSTRUCTIONS 32
+#define RECOMPILED_MAX_BLOCK_LENGTH (RECOMPILED_MAX_BLOCK_INSTRUCTIONS * 4 + 2)
+
+// A ROM translated ahead of time to C++ by chip8_recompile, one function
+// per basic block reachable from 0x200. Generated sources register their
+// program at startup and Chip8::loadRom attaches it to any machine that
+// loads exactly that ROM.
+struct RecompiledBlock {
+    unsigned short address;
+    // ROM bytes the block was compiled from, including the word after a
+    // closing skip that sizes it.
+    unsigned short length;
+    unsigned short instructions;
+    // Runs the whole block and returns the next program counter.
+    unsigned short (*run)(RecompiledMachine &machine);
+};
+
+struct RecompiledProgram {
+    const char *name;
+    std::uint64_t romHash;
+    const unsigned char *rom;
+    std::size_t romSize;
+    // Sorted by address, none overlapping but for a skip's sizing word.
+    const RecompiledBlock *blocks;
+    std::size_t blockCount;
+    // Index into blocks for every ROM byte a block starts at, -1 elsewhere.
+    const std::int32_t *blockAt;
+};
+
+// Generated sources hold one of these at namespace scope.
+struct RecompiledRegistration {
+    explicit RecompiledRegistration(const RecompiledProgram &program);
+};
+
+// The registered program compiled from exactly this ROM, if any.
+const RecompiledProgram *findRecompiledProgram(const unsigned char *rom, std::size_t size);
+
+// A machine's view of its recompiled program. Blocks only run while the
+// bytes they were compiled from are still in memory: writes over them
+// mark them stale, and the PC goes through the interpreter there instead,
+// as it does everywhere no block starts (BNNN targets, code reached only
+// through a stale block).
+class Recompiled {
+    public:
+        void attach(const RecompiledProgram *newProgram);
+        bool attached() const
+        {
+            return program != nullptr;
+        }
+        // Runs cycles instructions, or until FX0A halts the machine: the
+        // block at the PC whenever there is one that fits in what is left,
+        // one interpreted instruction otherwise. Returns the cycles left.
+        unsigned long run(Chip8 &chip8, unsigned long cycles);
+        // Rechecks the blocks over [address, address + length) against
+        // memory, so a block written back with its own bytes runs again.
+        void invalidate(const Chip8 &chip8, unsigned int address, unsigned int length);
+    private:
+        const RecompiledProgram *program = nullptr;
+        std::vector<bool> stale;
+};
+
+#endif //NESEMULATOR_RECOMPILED_HPP
@@ -0,0 +1,116 @@
+#ifndef NESEMULATOR_RECOMPILEDMACHINE_HPP
+#define NESEMULATOR_RECOMPILEDMACHINE_HPP
+
+#include <cstdint>
+#include "Chip8.hpp"
+#include "Recompiled.hpp"
+
+// What a recompiled block sees of the machine: the registers it works on
+// directly, and the interpreter for every instruction it leaves to it.
+// Everything here does exactly what the Chip8 handler of the same
+// instruction does, quirks included.
+class RecompiledMachine {
+    public:
+        explicit RecompiledMachine(Chip8 &chip8)
+            : V(chip8.reg), I(chip8.indexRegister), PC(chip8.programCounter), stack(chip8.stack),
+              SP(chip8.stackPtr), DT(chip8.delayTimer), keyPressed(chip8.keyPressed), chip8(chip8)
+        {
+        }
+
+        // Runs the instruction at address through the interpreter, which
+        // leaves PC after it.
+        void interpret(unsigned short address)
+        {
+            PC = address;
+            chip8.step();
+        }
+
+        // CXNN before the mask.
+        unsigned char random()
+        {
+            chip8.randomState = static_cast<std::uint32_t>(static_cast<std::uint64_t>(chip8.randomState) * 48271 % 0x7FFFFFFF);
+            return chip8.randomState % 0xFF;
+        }
+
+        // 8XY4, 8XY5, 8XY6, 8XY7 and 8XYE under the default quirks, the
+        // only ones recompiled programs run under, flags as their handlers
+        // set them.
+        void addReg(unsigned int x, unsigned int y)
+        {
+            if constexpr (DefaultQuirks::baselineFlags) {
+                // add_reg's carry test can never be true.
+                V[0xF] = 0;
+                V[x] += V[y];
+            } else {
+                unsigned int sum = V[x] + V[y];
+                V[x] = sum;
+                V[0xF] = sum >> 8;
+            }
+        }
+
+        void subReg(unsigned int x, unsigned int y)
+        {
+            if constexpr (DefaultQuirks::baselineFlags) {
+                V[0xF] = V[y] > V[x] ? 0 : 1;
+                V[x] -= V[y];
+            } else {
+                unsigned char vx = V[x];
+                unsigned char vy = V[y];
+                V[x] = vx - vy;
+                V[0xF] = vx >= vy;
+            }
+        }
+
+        void subRegBis(unsigned int x, unsigned int y)
+        {
+            if constexpr (DefaultQuirks::baselineFlags) {
+                V[0xF] = V[x] > V[y] ? 0 : 1;
+                V[x] = V[y] - V[x];
+            } else {
+                unsigned char vx = V[x];
+                unsigned char vy = V[y];
+                V[x] = vy - vx;
+                V[0xF] = vy >= vx;
+            }
+        }
+
+        void rshiftReg(unsigned int x, unsigned int y)
+        {
+            unsigned int source = DefaultQuirks::shiftReadsVY ? y : x;
+
+            if constexpr (DefaultQuirks::baselineFlags) {
+                V[0xF] = V[source] & 1;
+                V[x] = V[source] >> 1;
+            } else {
+                unsigned char value = V[source];
+                V[x] = value >> 1;
+                V[0xF] = value & 1;
+            }
+        }
+
+        void lshiftReg(unsigned int x, unsigned int y)
+        {
+            unsigned int source = DefaultQuirks::shiftReadsVY ? y : x;
+
+            if constexpr (DefaultQuirks::baselineFlags) {
+                V[0xF] = Chip8::getMSB(V[source]);
+                V[x] = V[source] << 1;
+            } else {
+                unsigned char value = V[source];
+                V[x] = value << 1;
+                V[0xF] = value >> 7;
+            }
+        }
+
+        unsigned char *const V;
+        unsigned short &I;
+        unsigned short &PC;
+        unsigned short *const stack;
+        unsigned short &SP;
+        unsigned char &DT;
+        const bool *const keyPressed;
+    private:
+        Chip8 &chip8;
+};
+
+#endif //NESEMULATOR_RECOMPILEDMACHINE_HPP
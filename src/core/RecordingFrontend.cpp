@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <thread>
+#include "RecordingFrontend.hpp"
+
+RecordingFrontend::RecordingFrontend(std::chrono::microseconds presentDelay) : presentDelay(presentDelay)
+{
+}
+
+bool RecordingFrontend::isOpen() const
+{
+    return true;
+}
+
+void RecordingFrontend::pollInput(InputQueue &)
+{
+}
+
+void RecordingFrontend::present(const Display &display, std::uint64_t changedRows)
+{
+    recorded.push_back(RecordedFrame{display, changedRows});
+    if (presentDelay.count() > 0)
+        std::this_thread::sleep_for(presentDelay);
+}
+
+void RecordingFrontend::setBuzzer(bool)
+{
+}
+
+const std::vector<RecordedFrame> &RecordingFrontend::frames() const
+{
+    return recorded;
+}
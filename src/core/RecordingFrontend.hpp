@@ -0,0 +1,32 @@
+#ifndef NESEMULATOR_RECORDINGFRONTEND_HPP
+#define NESEMULATOR_RECORDINGFRONTEND_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+#include "Frontend.hpp"
+
+struct RecordedFrame {
+    Display display;
+    std::uint64_t changedRows;
+};
+
+// Headless presenter keeping every frame it is given, optionally taking
+// presentDelay per frame to stand in for a vsync'd display. Read frames()
+// once nothing presents any more.
+class RecordingFrontend : public Frontend {
+    public:
+        explicit RecordingFrontend(std::chrono::microseconds presentDelay = std::chrono::microseconds(0));
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+        const std::vector<RecordedFrame> &frames() const;
+    private:
+        std::chrono::microseconds presentDelay;
+        std::vector<RecordedFrame> recorded;
+};
+
+#endif //NESEMULATOR_RECORDINGFRONTEND_HPP
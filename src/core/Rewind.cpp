@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "Rewind.hpp"
+#include "Chip8.hpp"
+
+// Delta encoding: the state's size as a u32, then repeated [zero run u16]
+// [literal count u16][literal bytes], the literals being the non-zero bytes
+// of state XOR keyframe. Bytes past the end of the keyframe XOR against
+// zero, the state may have more memory pages than its keyframe.
+static const std::size_t DELTA_HEADER_SIZE = 4;
+static const std::size_t RUN_HEADER_SIZE = 4;
+static const std::size_t MAX_RUN = 0xFFFF;
+
+Rewind::Rewind(std::size_t budgetBytes, unsigned int keyframeInterval) :
+    buffer(std::max<std::size_t>(budgetBytes, 2 * STATE_FIXED_SIZE)),
+    keyframeInterval(std::max(keyframeInterval, 1u)), framesSinceKeyframe(keyframeInterval)
+{
+}
+
+void Rewind::push(const Chip8 &chip8)
+{
+    chip8.saveState(scratch);
+    std::size_t size = 0;
+    if (framesSinceKeyframe < keyframeInterval)
+        size = encodeDelta(scratch, deltaScratch);
+    // A delta as big as the state itself is better stored as a keyframe.
+    if (framesSinceKeyframe >= keyframeInterval || size >= scratch.size()) {
+        pushKeyframe();
+        return;
+    }
+
+    unsigned char *out = allocate(size);
+    // Making room dropped the keyframe this delta is against, and its
+    // deltas with it: the frame starts a new group instead.
+    if (entries.empty()) {
+        writeOffset = 0;
+        pushKeyframe();
+        return;
+    }
+    std::memcpy(out, deltaScratch.data(), size);
+    entries.push_back({static_cast<std::size_t>(out - buffer.data()), size, false});
+    ++framesSinceKeyframe;
+}
+
+void Rewind::pushKeyframe()
+{
+    if (scratch.size() > buffer.size()) {
+        clear();
+        return;
+    }
+    unsigned char *out = allocate(scratch.size());
+    std::memcpy(out, scratch.data(), scratch.size());
+    entries.push_back({static_cast<std::size_t>(out - buffer.data()), scratch.size(), true});
+    keyframe = scratch;
+    framesSinceKeyframe = 1;
+}
+
+// Restores the newest frame and forgets it, so calling this once per
+// displayed frame plays the history backwards.
+bool Rewind::rewind(Chip8 &chip8)
+{
+    if (entries.empty())
+        return false;
+
+    Entry entry = entries.back();
+    entries.pop_back();
+    if (entry.keyframe) {
+        scratch.assign(buffer.data() + entry.offset, buffer.data() + entry.offset + entry.size);
+    } else {
+        auto key = std::find_if(entries.rbegin(), entries.rend(), [](const Entry &e) { return e.keyframe; });
+        if (key == entries.rend()) {
+            clear();
+            return false;
+        }
+        scratch.assign(buffer.data() + key->offset, buffer.data() + key->offset + key->size);
+        decodeDelta(buffer.data() + entry.offset, entry.size, scratch);
+    }
+    writeOffset = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+    // The keyframe copy may be gone, start the next push with a fresh one.
+    framesSinceKeyframe = keyframeInterval;
+    return chip8.loadState(scratch);
+}
+
+std::size_t Rewind::frames() const
+{
+    return entries.size();
+}
+
+void Rewind::clear()
+{
+    entries.clear();
+    writeOffset = 0;
+    framesSinceKeyframe = keyframeInterval;
+}
+
+unsigned char *Rewind::allocate(std::size_t size)
+{
+    if (writeOffset + size > buffer.size()) {
+        // Entries past the write position are the oldest ones, they go first.
+        while (!entries.empty() && entries.front().offset >= writeOffset)
+            dropOldest();
+        writeOffset = 0;
+    }
+    while (!entries.empty() && entries.front().offset < writeOffset + size &&
+           entries.front().offset + entries.front().size > writeOffset)
+        dropOldest();
+
+    unsigned char *out = buffer.data() + writeOffset;
+    writeOffset += size;
+    return out;
+}
+
+void Rewind::dropOldest()
+{
+    entries.pop_front();
+    // Deltas are useless without the keyframe they were taken against.
+    while (!entries.empty() && !entries.front().keyframe)
+        entries.pop_front();
+}
+
+// Gives up, returning state.size(), once the delta would be that big.
+std::size_t Rewind::encodeDelta(const SaveState &state, std::vector<unsigned char> &delta) const
+{
+    std::size_t size = state.size();
+    std::size_t common = std::min(size, keyframe.size());
+    auto keyAt = [this, common](std::size_t i) -> unsigned char { return i < common ? keyframe[i] : 0; };
+    std::uint32_t stateSize = size;
+
+    delta.resize(size);
+    unsigned char *out = delta.data();
+    unsigned char *end = out + size;
+    std::memcpy(out, &stateSize, DELTA_HEADER_SIZE);
+    out += DELTA_HEADER_SIZE;
+
+    std::size_t i = 0;
+    while (i < size) {
+        std::size_t zeros = 0;
+        while (i + zeros < size && zeros < MAX_RUN && state[i + zeros] == keyAt(i + zeros))
+            ++zeros;
+        i += zeros;
+        std::size_t literals = 0;
+        while (i + literals < size && literals < MAX_RUN && state[i + literals] != keyAt(i + literals))
+            ++literals;
+        if (zeros == 0 && literals == 0)
+            break;
+        if (static_cast<std::size_t>(end - out) < RUN_HEADER_SIZE + literals)
+            return size;
+
+        unsigned short header[2] = {static_cast<unsigned short>(zeros), static_cast<unsigned short>(literals)};
+        std::memcpy(out, header, RUN_HEADER_SIZE);
+        out += RUN_HEADER_SIZE;
+        for (std::size_t j = 0; j < literals; ++j)
+            *out++ = state[i + j] ^ keyAt(i + j);
+        i += literals;
+    }
+    return out - delta.data();
+}
+
+// state holds the keyframe the delta was taken against.
+void Rewind::decodeDelta(const unsigned char *in, std::size_t size, SaveState &state)
+{
+    const unsigned char *end = in + size;
+    std::uint32_t stateSize;
+    std::size_t i = 0;
+
+    std::memcpy(&stateSize, in, DELTA_HEADER_SIZE);
+    in += DELTA_HEADER_SIZE;
+    state.resize(stateSize);
+    while (in < end) {
+        unsigned short header[2];
+        std::memcpy(header, in, RUN_HEADER_SIZE);
+        in += RUN_HEADER_SIZE;
+        i += header[0];
+        for (unsigned short j = 0; j < header[1]; ++j)
+            state[i++] ^= *in++;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef NESEMULATOR_REWIND_HPP
+#define NESEMULATOR_REWIND_HPP
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "SaveState.hpp"
+
+class Chip8;
+
+// Per-frame history in a fixed byte budget. Every keyframeInterval-th frame
+// is stored whole, the others as the run-length coded XOR against the
+// latest keyframe. When the budget is full the oldest keyframe and its
+// deltas are dropped together; a group that outgrows the budget on its own
+// starts over with a keyframe rather than keep deltas against nothing, and
+// a frame too big for the whole budget clears the history.
+class Rewind {
+    public:
+        explicit Rewind(std::size_t budgetBytes, unsigned int keyframeInterval = 60);
+        void push(const Chip8 &chip8);
+        bool rewind(Chip8 &chip8);
+        std::size_t frames() const;
+        void clear();
+    private:
+        struct Entry {
+            std::size_t offset;
+            std::size_t size;
+            bool keyframe;
+        };
+        // Stores scratch whole and starts a new group of deltas against it.
+        void pushKeyframe();
+        unsigned char *allocate(std::size_t size);
+        void dropOldest();
+        std::size_t encodeDelta(const SaveState &state, std::vector<unsigned char> &delta) const;
+        static void decodeDelta(const unsigned char *in, std::size_t size, SaveState &state);
+        std::vector<unsigned char> buffer;
+        std::deque<Entry> entries;
+        std::size_t writeOffset = 0;
+        unsigned int keyframeInterval;
+        unsigned int framesSinceKeyframe;
+        SaveState keyframe;
+        SaveState scratch;
+        std::vector<unsigned char> deltaScratch;
+};
+
+#endif //NESEMULATOR_REWIND_HPP
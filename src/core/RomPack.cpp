@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "RomPack.hpp"
+#include "Hash.hpp"
+
+RomPack::~RomPack()
+{
+    close();
+}
+
+bool RomPack::open(const std::string &filePath, std::string &error)
+{
+    struct stat status;
+    int fd;
+    void *address;
+
+    close();
+    fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + filePath;
+        return false;
+    }
+    if (fstat(fd, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(RomPackHeader)) {
+        ::close(fd);
+        error = filePath + ": truncated header";
+        return false;
+    }
+    address = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        error = "cannot map " + filePath;
+        return false;
+    }
+    mapping = static_cast<const unsigned char *>(address);
+    mappingSize = status.st_size;
+
+    const RomPackHeader *header = reinterpret_cast<const RomPackHeader *>(mapping);
+    if (std::memcmp(header->magic, ROMPACK_MAGIC, sizeof(header->magic)) != 0
+        || header->version != ROMPACK_VERSION) {
+        close();
+        error = filePath + ": not a version " + std::to_string(ROMPACK_VERSION) + " ROM pack";
+        return false;
+    }
+    if (header->count > (mappingSize - sizeof(RomPackHeader)) / sizeof(RomPackEntry)) {
+        close();
+        error = filePath + ": truncated index";
+        return false;
+    }
+    entries = reinterpret_cast<const RomPackEntry *>(mapping + sizeof(RomPackHeader));
+    count = header->count;
+    // Check every image once here so loads never have to.
+    for (std::size_t i = 0; i < count; ++i) {
+        if (entries[i].size > MAX_ROM_SIZE || entries[i].offset > mappingSize
+            || entries[i].size > mappingSize - entries[i].offset
+            || (i > 0 && entries[i].hash <= entries[i - 1].hash)) {
+            error = filePath + ": corrupt index entry " + std::to_string(i);
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RomPack::close()
+{
+    if (mapping != nullptr)
+        munmap(const_cast<unsigned char *>(mapping), mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+std::size_t RomPack::size() const
+{
+    return count;
+}
+
+const RomPackEntry &RomPack::entry(std::size_t index) const
+{
+    return entries[index];
+}
+
+const unsigned char *RomPack::data(const RomPackEntry &entry) const
+{
+    return mapping + entry.offset;
+}
+
+const RomPackEntry *RomPack::find(std::uint64_t hash) const
+{
+    const RomPackEntry *end = entries + count;
+    const RomPackEntry *found = std::lower_bound(entries, end, hash, [](const RomPackEntry &entry, std::uint64_t key) {
+        return entry.hash < key;
+    });
+
+    return found != end && found->hash == hash ? found : nullptr;
+}
+
+bool writeRomPack(const std::string &filePath, const std::vector<std::vector<unsigned char>> &roms, std::string &error)
+{
+    std::vector<std::pair<std::uint64_t, const std::vector<unsigned char> *>> sorted;
+    std::vector<RomPackEntry> index;
+    RomPackHeader header = {};
+
+    for (const std::vector<unsigned char> &rom : roms) {
+        if (rom.empty() || rom.size() > MAX_ROM_SIZE) {
+            error = "ROM of " + std::to_string(rom.size()) + " bytes does not fit in memory";
+            return false;
+        }
+        sorted.emplace_back(fnv1a64(rom.data(), rom.size()), &rom);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.first == b.first;
+    }), sorted.end());
+
+    std::uint64_t offset = sizeof(RomPackHeader) + sorted.size() * sizeof(RomPackEntry);
+    for (const auto &rom : sorted) {
+        index.push_back(RomPackEntry{rom.first, static_cast<std::uint32_t>(offset),
+                                     static_cast<std::uint32_t>(rom.second->size())});
+        offset += rom.second->size();
+    }
+    if (offset > 0xFFFFFFFFULL) {
+        error = "pack larger than 4 GiB";
+        return false;
+    }
+
+    std::ofstream outFile(filePath, std::ios::binary | std::ios::trunc);
+    std::memcpy(header.magic, ROMPACK_MAGIC, sizeof(header.magic));
+    header.version = ROMPACK_VERSION;
+    header.count = index.size();
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(RomPackEntry));
+    for (const auto &rom : sorted)
+        outFile.write(reinterpret_cast<const char *>(rom.second->data()), rom.second->size());
+    if (!outFile) {
+        error = "cannot write " + filePath;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef NESEMULATOR_ROMPACK_HPP
+#define NESEMULATOR_ROMPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PagedMemory.hpp"
+
+#define ROMPACK_MAGIC "C8PK"
+#define ROMPACK_VERSION 1
+// Everything from 0x200 to the top of memory.
+#define MAX_ROM_SIZE (MEMORY_SIZE - 0x200)
+
+// Fixed layout, host byte order:
+//   header:  magic[4] version[2] reserved[2] count[4] reserved[4]
+//   index:   count x { hash[8] offset[4] size[4] }, sorted by hash
+//   data:    the ROM images, offsets relative to the start of the file
+// The hash is fnv1a64 of the ROM contents, identical ROMs are stored once.
+struct RomPackHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint32_t count;
+    std::uint32_t reserved2;
+};
+
+struct RomPackEntry {
+    std::uint64_t hash;
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+// Read-only view of a pack, mapped once and shared by every thread that
+// loads from it.
+class RomPack {
+    public:
+        RomPack() = default;
+        RomPack(const RomPack &) = delete;
+        RomPack &operator=(const RomPack &) = delete;
+        ~RomPack();
+        bool open(const std::string &filePath, std::string &error);
+        void close();
+        std::size_t size() const;
+        const RomPackEntry &entry(std::size_t index) const;
+        const unsigned char *data(const RomPackEntry &entry) const;
+        // Binary search of the index, nullptr if the hash is not packed.
+        const RomPackEntry *find(std::uint64_t hash) const;
+    private:
+        const unsigned char *mapping = nullptr;
+        std::size_t mappingSize = 0;
+        const RomPackEntry *entries = nullptr;
+        std::size_t count = 0;
+};
+
+// Builds a pack from ROM images, skipping duplicates. Fails on images that
+// do not fit the CHIP-8 program space.
+bool writeRomPack(const std::string &filePath, const std::vector<std::vector<unsigned char>> &roms, std::string &error);
+
+#endif //NESEMULATOR_ROMPACK_HPP
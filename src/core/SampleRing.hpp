@@ -0,0 +1,91 @@
+#ifndef NESEMULATOR_SAMPLERING_HPP
+#define NESEMULATOR_SAMPLERING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Single producer, single consumer ring of 16-bit samples between the
+// emulation thread and an audio device thread. Both sides only ever move
+// what fits: a write to a full ring and a read from an empty one return
+// short instead of waiting.
+class SampleRing {
+    public:
+        // Capacity is rounded up to a power of two.
+        explicit SampleRing(std::size_t capacity)
+        {
+            std::size_t size = 1;
+
+            while (size < capacity)
+                size <<= 1;
+            samples.resize(size);
+            mask = size - 1;
+        }
+
+        SampleRing(const SampleRing &) = delete;
+        SampleRing &operator=(const SampleRing &) = delete;
+
+        // Returns how many of count were queued.
+        std::size_t write(const std::int16_t *data, std::size_t count)
+        {
+            std::size_t tail = writeIndex.load(std::memory_order_relaxed);
+            std::size_t space = samples.size() - (tail - readIndex.load(std::memory_order_acquire));
+
+            count = std::min(count, space);
+            store(data, tail, count);
+            writeIndex.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        // Returns how many samples were read into data.
+        std::size_t read(std::int16_t *data, std::size_t count)
+        {
+            std::size_t head = readIndex.load(std::memory_order_relaxed);
+            std::size_t queued = writeIndex.load(std::memory_order_acquire) - head;
+
+            count = std::min(count, queued);
+            load(data, head, count);
+            readIndex.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        std::size_t available() const
+        {
+            return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const
+        {
+            return samples.size();
+        }
+    private:
+        // Both copy count samples from index on, in two pieces when they
+        // wrap around the end of the ring.
+        void store(const std::int16_t *data, std::size_t index, std::size_t count)
+        {
+            std::size_t start = index & mask;
+            std::size_t first = std::min(count, samples.size() - start);
+
+            std::memcpy(&samples[start], data, first * sizeof(std::int16_t));
+            std::memcpy(&samples[0], data + first, (count - first) * sizeof(std::int16_t));
+        }
+
+        void load(std::int16_t *data, std::size_t index, std::size_t count) const
+        {
+            std::size_t start = index & mask;
+            std::size_t first = std::min(count, samples.size() - start);
+
+            std::memcpy(data, &samples[start], first * sizeof(std::int16_t));
+            std::memcpy(data + first, &samples[0], (count - first) * sizeof(std::int16_t));
+        }
+
+        std::vector<std::int16_t> samples;
+        std::size_t mask = 0;
+        // Free running, the slot is the index masked.
+        alignas(64) std::atomic<std::size_t> writeIndex{0};
+        alignas(64) std::atomic<std::size_t> readIndex{0};
+};
+
+#endif //NESEMULATOR_SAMPLERING_HPP
@@ -0,0 +1,114 @@
+#include <cstring>
+#include "Chip8.hpp"
+#include "SaveState.hpp"
+
+template <typename T>
+static unsigned char *put(unsigned char *out, const T &value)
+{
+    std::memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+template <typename T>
+static const unsigned char *get(const unsigned char *in, T &value)
+{
+    std::memcpy(&value, in, sizeof(value));
+    return in + sizeof(value);
+}
+
+void Chip8::saveState(SaveState &state) const
+{
+    static_assert(sizeof(display.planes) == 2048 && MEMORY_PAGE_COUNT == 256, "machine layout changed, bump STATE_VERSION");
+    unsigned char pageMask[MEMORY_PAGE_COUNT / 8] = {};
+    std::size_t pageCount = 0;
+    unsigned short version = STATE_VERSION;
+
+    for (unsigned int page = 0; page < MEMORY_PAGE_COUNT; ++page) {
+        if (!memory.isZeroPage(page)) {
+            pageMask[page / 8] |= 1 << page % 8;
+            ++pageCount;
+        }
+    }
+    state.resize(STATE_FIXED_SIZE + pageCount * MEMORY_PAGE_SIZE);
+
+    unsigned char *out = state.data();
+    std::memcpy(out, STATE_MAGIC, 4);
+    out = put(out + 4, version);
+    out = put(out, programCounter);
+    out = put(out, indexRegister);
+    out = put(out, stackPtr);
+    out = put(out, stack);
+    out = put(out, reg);
+    out = put(out, delayTimer);
+    out = put(out, soundTimer);
+    out = put(out, randomState);
+    out = put(out, display.planes);
+    *out++ = display.isHires();
+    *out++ = planeMask;
+    out = put(out, flags);
+    *out++ = waitingForKey ? keyRegister : 0xFF;
+    out = put(out, pageMask);
+    for (unsigned int page = 0; page < MEMORY_PAGE_COUNT; ++page) {
+        if (pageMask[page / 8] & 1 << page % 8) {
+            memory.read(page * MEMORY_PAGE_SIZE, out, MEMORY_PAGE_SIZE);
+            out += MEMORY_PAGE_SIZE;
+        }
+    }
+}
+
+bool Chip8::loadState(const SaveState &state)
+{
+    const unsigned char *in = state.data();
+    unsigned short version = 0;
+    unsigned char hires = 0;
+    unsigned char keyWait = 0;
+    unsigned char pageMask[MEMORY_PAGE_COUNT / 8];
+    std::size_t pageCount = 0;
+
+    if (state.size() < STATE_FIXED_SIZE || std::memcmp(in, STATE_MAGIC, 4) != 0)
+        return false;
+    get(in + 4, version);
+    if (version != STATE_VERSION)
+        return false;
+    // Checked before anything is loaded, a short state leaves the machine
+    // as it was.
+    std::memcpy(pageMask, in + STATE_FIXED_SIZE - sizeof(pageMask), sizeof(pageMask));
+    for (unsigned char bits : pageMask) {
+        for (; bits != 0; bits &= bits - 1)
+            ++pageCount;
+    }
+    if (state.size() != STATE_FIXED_SIZE + pageCount * MEMORY_PAGE_SIZE)
+        return false;
+
+    in = get(in + STATE_HEADER_SIZE, programCounter);
+    in = get(in, indexRegister);
+    in = get(in, stackPtr);
+    in = get(in, stack);
+    in = get(in, reg);
+    in = get(in, delayTimer);
+    in = get(in, soundTimer);
+    in = get(in, randomState);
+    in = get(in, display.planes);
+    in = get(in, hires);
+    in = get(in, planeMask);
+    in = get(in, flags);
+    in = get(in, keyWait);
+    in += sizeof(pageMask);
+    display.width = hires ? DISPLAY_WIDTH : SCREEN_WIDTH;
+    display.height = hires ? DISPLAY_HEIGHT : SCREEN_HEIGHT;
+    waitingForKey = keyWait != 0xFF;
+    keyRegister = keyWait & 0xF;
+    for (unsigned int page = 0; page < MEMORY_PAGE_COUNT; ++page) {
+        if (pageMask[page / 8] & 1 << page % 8) {
+            memory.write(page * MEMORY_PAGE_SIZE, in, MEMORY_PAGE_SIZE);
+            in += MEMORY_PAGE_SIZE;
+        } else {
+            memory.clearPage(page);
+        }
+    }
+
+    memoryWritten(0, MEMORY_SIZE);
+    dirtyRows = ~0ull;
+    frontend->setBuzzer(soundTimer > 0);
+    return true;
+}
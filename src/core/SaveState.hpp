@@ -0,0 +1,26 @@
+#ifndef NESEMULATOR_SAVESTATE_HPP
+#define NESEMULATOR_SAVESTATE_HPP
+
+#include <vector>
+#include "PagedMemory.hpp"
+
+#define STATE_MAGIC "C8ST"
+#define STATE_VERSION 5
+
+// Host byte order:
+//   magic[4] version[2] programCounter[2] indexRegister[2] stackPtr[2]
+//   stack[32] reg[16] delayTimer soundTimer randomState[4] planes[2048]
+//   hires planeMask flags[16] keyWait pageMask[32]
+// then MEMORY_PAGE_SIZE bytes for each page set in pageMask, in address
+// order. planes are the display's, hires is 1 in 128x64 mode and keyWait
+// is the register FX0A is waiting to fill, 0xFF when not waiting. Pages of
+// all zeroes are left out, so a CHIP-8 program's state is a few KB and only
+// XO-CHIP programs that fill their 64 KB pay for it.
+#define STATE_HEADER_SIZE 6
+#define STATE_FIXED_SIZE (STATE_HEADER_SIZE + 2 + 2 + 2 + 32 + 16 + 1 + 1 + 4 + 2048 + 1 + 1 + 16 + 1 + MEMORY_PAGE_COUNT / 8)
+#define STATE_MAX_SIZE (STATE_FIXED_SIZE + MEMORY_SIZE)
+
+// Saving into the same SaveState again reuses its storage.
+typedef std::vector<unsigned char> SaveState;
+
+#endif //NESEMULATOR_SAVESTATE_HPP
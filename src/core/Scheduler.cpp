@@ -0,0 +1,82 @@
+#include <thread>
+#include "Scheduler.hpp"
+#include "Chip8.hpp"
+
+// Below this, sleep_for overshoots by about as much as it waits, so the
+// last stretch before a deadline is spun instead.
+static const std::chrono::microseconds spinThreshold(1500);
+static const std::chrono::nanoseconds framePeriod(1000000000 / TIMER_FREQUENCY);
+// Further behind than this (debugger, suspended laptop), start over from
+// now instead of running frames back to back to catch up.
+static const int maxLateFrames = 5;
+
+Scheduler::Scheduler(Chip8 &chip8, unsigned int instructionsPerSecond) : chip8(chip8),
+    instructionsPerSecond(instructionsPerSecond), nextFrame(Clock::now())
+{
+}
+
+void Scheduler::setInstructionsPerSecond(unsigned int newInstructionsPerSecond)
+{
+    instructionsPerSecond = newInstructionsPerSecond;
+    cycleRemainder = 0;
+}
+
+void Scheduler::setTurbo(bool enabled)
+{
+    turbo = enabled;
+    nextFrame = Clock::now();
+}
+
+void Scheduler::runFrame()
+{
+    cycleRemainder += instructionsPerSecond;
+    unsigned long cycles = cycleRemainder / TIMER_FREQUENCY;
+    cycleRemainder %= TIMER_FREQUENCY;
+
+    chip8.runFrame(cycles);
+    // Halted in FX0A, a frame is only polling and timers: even in turbo,
+    // sleep until the next one, and through the spin at the end too.
+    if (chip8.isWaitingForKey())
+        waitForNextFrame(false);
+    else if (!turbo)
+        waitForNextFrame(true);
+}
+
+void Scheduler::run()
+{
+    nextFrame = Clock::now();
+    while (chip8.isRunning())
+        runFrame();
+}
+
+void Scheduler::run(unsigned long frames)
+{
+    nextFrame = Clock::now();
+    while (frames-- > 0 && chip8.isRunning())
+        runFrame();
+}
+
+void Scheduler::waitForNextFrame(bool precise)
+{
+    Clock::time_point now = Clock::now();
+
+    nextFrame += framePeriod;
+    if (now - nextFrame > framePeriod * maxLateFrames)
+        nextFrame = now;
+    if (precise)
+        waitUntil(nextFrame);
+    else
+        std::this_thread::sleep_until(nextFrame);
+}
+
+void Scheduler::waitUntil(Clock::time_point deadline)
+{
+    Clock::time_point now = Clock::now();
+
+    while (deadline - now > spinThreshold) {
+        std::this_thread::sleep_for(deadline - now - spinThreshold);
+        now = Clock::now();
+    }
+    while (Clock::now() < deadline)
+        ;
+}
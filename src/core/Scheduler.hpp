@@ -0,0 +1,36 @@
+#ifndef NESEMULATOR_SCHEDULER_HPP
+#define NESEMULATOR_SCHEDULER_HPP
+
+#include <chrono>
+
+class Chip8;
+
+#define TIMER_FREQUENCY 60
+#define DEFAULT_IPS 600
+
+// Runs a Chip8 one 60 Hz frame at a time: instructionsPerSecond / 60
+// instructions, one timer tick, one present. Frames are paced to the wall
+// clock unless turbo is on, in which case they run back to back. A machine
+// waiting for a key is always paced, without spinning.
+class Scheduler {
+    public:
+        explicit Scheduler(Chip8 &chip8, unsigned int instructionsPerSecond = DEFAULT_IPS);
+        void setInstructionsPerSecond(unsigned int instructionsPerSecond);
+        void setTurbo(bool enabled);
+        void runFrame();
+        void run();
+        void run(unsigned long frames);
+    private:
+        typedef std::chrono::steady_clock Clock;
+        // Spins the last stretch for precision, or only sleeps.
+        void waitForNextFrame(bool precise);
+        static void waitUntil(Clock::time_point deadline);
+        Chip8 &chip8;
+        unsigned int instructionsPerSecond;
+        // Leftover of instructionsPerSecond / 60, carried to the next frame.
+        unsigned int cycleRemainder = 0;
+        bool turbo = false;
+        Clock::time_point nextFrame;
+};
+
+#endif //NESEMULATOR_SCHEDULER_HPP
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "ScriptedFrontend.hpp"
+#include "Scheduler.hpp"
+
+bool loadInputScript(const std::string &filePath, std::vector<InputEvent> &events)
+{
+    std::ifstream inFile(filePath);
+
+    if (!inFile)
+        return false;
+    return parseInputScript(inFile, events);
+}
+
+bool parseInputScript(std::istream &in, std::vector<InputEvent> &events)
+{
+    std::string line;
+
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        unsigned long frame;
+        unsigned int key;
+        std::string state;
+
+        if (!(fields >> frame))
+            continue;
+        if (!(fields >> std::hex >> key >> state) || key > 0xF || (state != "down" && state != "up"))
+            return false;
+        events.push_back({frame, static_cast<unsigned char>(key), state == "down"});
+    }
+    std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) {
+        return a.frame < b.frame;
+    });
+    return true;
+}
+
+ScriptedFrontend::ScriptedFrontend(std::vector<InputEvent> events) : events(std::move(events))
+{
+}
+
+bool ScriptedFrontend::isOpen() const
+{
+    return true;
+}
+
+// Events are stamped with the start of their frame. One the queue has no
+// room for stays for the next frame.
+void ScriptedFrontend::pollInput(InputQueue &queue)
+{
+    for (; nextEvent < events.size() && events[nextEvent].frame <= frame; ++nextEvent) {
+        const InputEvent &event = events[nextEvent];
+
+        if (!queue.push({event.frame * 1000000 / TIMER_FREQUENCY, event.key, event.pressed}))
+            break;
+    }
+    ++frame;
+}
+
+void ScriptedFrontend::present(const Display &, std::uint64_t)
+{
+}
+
+void ScriptedFrontend::setBuzzer(bool)
+{
+}
@@ -0,0 +1,35 @@
+#ifndef NESEMULATOR_SCRIPTEDFRONTEND_HPP
+#define NESEMULATOR_SCRIPTEDFRONTEND_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+#include "Frontend.hpp"
+
+struct InputEvent {
+    unsigned long frame;
+    unsigned char key;
+    bool pressed;
+};
+
+// Reads "<frame> <key 0-F> <down|up>" lines, '#' starts a comment.
+bool loadInputScript(const std::string &filePath, std::vector<InputEvent> &events);
+// The same from a script already in memory.
+bool parseInputScript(std::istream &in, std::vector<InputEvent> &events);
+
+// Headless frontend replaying an input script, one pollInput per frame.
+class ScriptedFrontend : public Frontend {
+    public:
+        ScriptedFrontend() = default;
+        explicit ScriptedFrontend(std::vector<InputEvent> events);
+        bool isOpen() const override;
+        void pollInput(InputQueue &queue) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+    private:
+        std::vector<InputEvent> events;
+        std::size_t nextEvent = 0;
+        unsigned long frame = 0;
+};
+
+#endif //NESEMULATOR_SCRIPTEDFRONTEND_HPP
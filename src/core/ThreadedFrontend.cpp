@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstring>
+#include "ThreadedFrontend.hpp"
+
+ThreadedFrontend::ThreadedFrontend(Frontend &presenter) : presenter(presenter)
+{
+    presenter.releaseRenderContext();
+    thread = std::thread(&ThreadedFrontend::render, this);
+}
+
+ThreadedFrontend::~ThreadedFrontend()
+{
+    stopping.store(true);
+    wake.notify_one();
+    thread.join();
+    presenter.acquireRenderContext();
+}
+
+bool ThreadedFrontend::isOpen() const
+{
+    return presenter.isOpen();
+}
+
+void ThreadedFrontend::pollInput(InputQueue &events)
+{
+    presenter.pollInput(events);
+}
+
+// Rows changed since the frame the render thread last showed are worked
+// out over there, since it may have skipped some frames in between.
+void ThreadedFrontend::present(const Display &display, std::uint64_t)
+{
+    Frame &frame = frames.back();
+
+    frame.display = display;
+    frame.sequence = ++published;
+    frames.publish();
+    lastPublished.store(published, std::memory_order_release);
+    wake.notify_one();
+}
+
+void ThreadedFrontend::setBuzzer(bool on)
+{
+    presenter.setBuzzer(on);
+}
+
+unsigned long ThreadedFrontend::publishedFrames() const
+{
+    return lastPublished.load(std::memory_order_acquire);
+}
+
+unsigned long ThreadedFrontend::presentedFrames() const
+{
+    return presented.load(std::memory_order_acquire);
+}
+
+void ThreadedFrontend::render()
+{
+    Display shown;
+    bool first = true;
+
+    presenter.acquireRenderContext();
+    while (true) {
+        bool stop = stopping.load();
+
+        if (frames.update()) {
+            const Frame &frame = frames.front();
+            std::uint64_t changedRows = 0;
+
+            for (unsigned int row = 0; row < frame.display.height; ++row)
+                if (first || !frame.display.sameRow(shown, row))
+                    changedRows |= 1ull << row;
+            shown = frame.display;
+            first = false;
+            presenter.present(frame.display, changedRows);
+            presented.fetch_add(1, std::memory_order_release);
+        } else if (stop) {
+            break;
+        } else {
+            // present() notifies without the lock, so a wakeup can slip in
+            // between the check and the wait: the timeout bounds that.
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+    presenter.releaseRenderContext();
+}
@@ -0,0 +1,50 @@
+#ifndef NESEMULATOR_THREADEDFRONTEND_HPP
+#define NESEMULATOR_THREADEDFRONTEND_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "Chip8.hpp"
+#include "Frontend.hpp"
+#include "TripleBuffer.hpp"
+
+// Moves presentation of another frontend to a render thread. present()
+// only copies the framebuffer into a triple buffer and returns, so vsync
+// or driver stalls never hold up the emulation thread; the render thread
+// always shows the newest complete frame and skips the ones it was too
+// slow for. Input, buzzer and isOpen() stay on the calling thread.
+class ThreadedFrontend : public Frontend {
+    public:
+        explicit ThreadedFrontend(Frontend &presenter);
+        ThreadedFrontend(const ThreadedFrontend &) = delete;
+        ThreadedFrontend &operator=(const ThreadedFrontend &) = delete;
+        // Presents the last published frame, then joins the render thread.
+        ~ThreadedFrontend() override;
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+        unsigned long publishedFrames() const;
+        unsigned long presentedFrames() const;
+    private:
+        struct Frame {
+            Display display;
+            unsigned long sequence;
+        };
+        void render();
+        Frontend &presenter;
+        TripleBuffer<Frame> frames;
+        unsigned long published = 0;
+        std::atomic<unsigned long> lastPublished{0};
+        std::atomic<unsigned long> presented{0};
+        std::atomic<bool> stopping{false};
+        // Only used to sleep the render thread between frames, present()
+        // never takes the lock.
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::thread thread;
+};
+
+#endif //NESEMULATOR_THREADEDFRONTEND_HPP
@@ -0,0 +1,129 @@
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Tracer.hpp"
+
+// The tracer whose ring gets written when the process crashes. Only one
+// can be armed at a time.
+static Tracer *crashTracer = nullptr;
+static const int crashSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+static std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+Tracer::Tracer(std::size_t capacity, bool recordRegisterDelta) :
+    records(roundUpToPowerOfTwo(capacity)), mask(records.size() - 1), recordRegisterDelta(recordRegisterDelta)
+{
+}
+
+Tracer::~Tracer()
+{
+    if (crashTracer == this) {
+        crashTracer = nullptr;
+        for (int signal : crashSignals)
+            std::signal(signal, SIG_DFL);
+    }
+}
+
+void Tracer::record(unsigned short programCounter, unsigned short opcode, unsigned char instruction, const unsigned char *reg)
+{
+    if (recordRegisterDelta)
+        closeDelta(reg);
+
+    TraceRecord &record = records[head & mask];
+    record.programCounter = programCounter;
+    record.opcode = opcode;
+    record.instruction = instruction;
+    record.changedRegister = TRACE_NO_REGISTER;
+    record.oldValue = 0;
+    record.newValue = 0;
+    ++head;
+}
+
+// The previous record's delta is only known once the next instruction is
+// about to run, so it is filled in here instead of after each handler.
+void Tracer::closeDelta(const unsigned char *reg)
+{
+    if (head != 0) {
+        TraceRecord &previous = records[(head - 1) & mask];
+        for (unsigned char i = 0; i < 16; ++i) {
+            if (reg[i] != previousReg[i]) {
+                previous.changedRegister = i;
+                previous.oldValue = previousReg[i];
+                previous.newValue = reg[i];
+                break;
+            }
+        }
+    }
+    std::memcpy(previousReg, reg, sizeof(previousReg));
+}
+
+void Tracer::clear()
+{
+    head = 0;
+}
+
+std::size_t Tracer::size() const
+{
+    return head < records.size() ? head : records.size();
+}
+
+bool Tracer::dump(const std::string &filePath) const
+{
+    int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return false;
+    bool written = writeTo(fd);
+    return close(fd) == 0 && written;
+}
+
+// Only async-signal-safe calls from here on, it also runs from crashHandler.
+bool Tracer::writeTo(int fd) const
+{
+    TraceHeader header{};
+    std::size_t count = size();
+    std::size_t first = (head - count) & mask;
+
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.count = count;
+    if (write(fd, &header, sizeof(header)) != sizeof(header))
+        return false;
+
+    // Oldest first: the tail of the ring, then its start.
+    std::size_t tail = records.size() - first < count ? records.size() - first : count;
+    ssize_t tailBytes = tail * sizeof(TraceRecord);
+    ssize_t headBytes = (count - tail) * sizeof(TraceRecord);
+    if (write(fd, records.data() + first, tailBytes) != tailBytes)
+        return false;
+    return headBytes == 0 || write(fd, records.data(), headBytes) == headBytes;
+}
+
+void Tracer::dumpOnCrash(const std::string &filePath)
+{
+    crashPath = filePath;
+    crashTracer = this;
+    for (int signal : crashSignals)
+        std::signal(signal, &Tracer::crashHandler);
+}
+
+void Tracer::crashHandler(int signal)
+{
+    if (crashTracer != nullptr) {
+        int fd = open(crashTracer->crashPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            crashTracer->writeTo(fd);
+            close(fd);
+        }
+    }
+    std::signal(signal, SIG_DFL);
+    raise(signal);
+}
@@ -0,0 +1,55 @@
+#ifndef NESEMULATOR_TRACER_HPP
+#define NESEMULATOR_TRACER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 2
+#define TRACE_NO_REGISTER 0xFF
+
+// One executed instruction, 8 bytes on disk and in memory.
+struct TraceRecord {
+    std::uint16_t programCounter;
+    std::uint16_t opcode;
+    std::uint8_t instruction;
+    // First V register the instruction changed, TRACE_NO_REGISTER if none
+    // or if deltas are not recorded.
+    std::uint8_t changedRegister;
+    std::uint8_t oldValue;
+    std::uint8_t newValue;
+};
+
+struct TraceHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t reserved;
+};
+
+// Fixed-size ring of the last executed instructions. Nothing is allocated
+// or formatted while recording; the ring is written out as raw records
+// and turned into text by chip8_tracedump.
+class Tracer {
+    public:
+        explicit Tracer(std::size_t capacity = 1 << 16, bool recordRegisterDelta = false);
+        ~Tracer();
+        void record(unsigned short programCounter, unsigned short opcode, unsigned char instruction, const unsigned char *reg);
+        void clear();
+        std::size_t size() const;
+        bool dump(const std::string &filePath) const;
+        void dumpOnCrash(const std::string &filePath);
+    private:
+        void closeDelta(const unsigned char *reg);
+        bool writeTo(int fd) const;
+        static void crashHandler(int signal);
+        std::vector<TraceRecord> records;
+        std::size_t mask;
+        std::uint64_t head = 0;
+        bool recordRegisterDelta;
+        unsigned char previousReg[16]{};
+        std::string crashPath;
+};
+
+#endif //NESEMULATOR_TRACER_HPP
@@ -0,0 +1,48 @@
+#ifndef NESEMULATOR_TRIPLEBUFFER_HPP
+#define NESEMULATOR_TRIPLEBUFFER_HPP
+
+#include <atomic>
+
+// Single producer, single consumer handoff of the latest value. The
+// producer fills back() and publishes it, the consumer takes the newest
+// published value with update() and reads front(). Neither side ever
+// waits for the other: a value published while the consumer is busy
+// replaces the previous one, which is then simply never seen.
+template <typename T>
+class TripleBuffer {
+    public:
+        T &back()
+        {
+            return slots[backIndex];
+        }
+
+        void publish()
+        {
+            backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // True if a newer value than front() was published.
+        bool update()
+        {
+            if ((middle.load(std::memory_order_acquire) & FRESH) == 0)
+                return false;
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        const T &front() const
+        {
+            return slots[frontIndex];
+        }
+    private:
+        static const unsigned int INDEX = 0x3;
+        static const unsigned int FRESH = 0x4;
+        T slots[3]{};
+        // Slot owned by each side, and the one in between plus whether it
+        // holds a value the consumer has not taken yet.
+        unsigned int backIndex = 0;
+        std::atomic<unsigned int> middle{1};
+        unsigned int frontIndex = 2;
+};
+
+#endif //NESEMULATOR_TRIPLEBUFFER_HPP
@@ -0,0 +1,84 @@
+#include <cstring>
+#include <vector>
+#include "WavWriter.hpp"
+
+#define WAV_HEADER_SIZE 44
+
+static void putLittle(unsigned char *out, std::uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+WavWriter::WavWriter(const std::string &path, unsigned int sampleRate) : sampleRate(sampleRate)
+{
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        failed = true;
+        return;
+    }
+    writeHeader();
+}
+
+WavWriter::~WavWriter()
+{
+    close();
+}
+
+bool WavWriter::good() const
+{
+    return !failed;
+}
+
+unsigned long WavWriter::samplesWritten() const
+{
+    return dataBytes / 2;
+}
+
+void WavWriter::write(const std::int16_t *samples, std::size_t count)
+{
+    std::vector<unsigned char> bytes(count * 2);
+
+    if (file == nullptr || count == 0)
+        return;
+    for (std::size_t i = 0; i < count; ++i)
+        putLittle(&bytes[i * 2], static_cast<std::uint16_t>(samples[i]), 2);
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+        failed = true;
+    dataBytes += bytes.size();
+}
+
+bool WavWriter::close()
+{
+    if (file == nullptr)
+        return good();
+    if (std::fseek(file, 0, SEEK_SET) != 0)
+        failed = true;
+    else
+        writeHeader();
+    if (std::fclose(file) != 0)
+        failed = true;
+    file = nullptr;
+    return good();
+}
+
+// RIFF / WAVE with a single PCM fmt chunk then the data chunk.
+void WavWriter::writeHeader()
+{
+    unsigned char header[WAV_HEADER_SIZE];
+
+    std::memcpy(header, "RIFF", 4);
+    putLittle(header + 4, 36 + dataBytes, 4);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    putLittle(header + 16, 16, 4);
+    putLittle(header + 20, 1, 2);
+    putLittle(header + 22, 1, 2);
+    putLittle(header + 24, sampleRate, 4);
+    putLittle(header + 28, sampleRate * 2, 4);
+    putLittle(header + 32, 2, 2);
+    putLittle(header + 34, 16, 2);
+    std::memcpy(header + 36, "data", 4);
+    putLittle(header + 40, dataBytes, 4);
+    if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+        failed = true;
+}
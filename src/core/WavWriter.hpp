@@ -0,0 +1,29 @@
+#ifndef NESEMULATOR_WAVWRITER_HPP
+#define NESEMULATOR_WAVWRITER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// 16-bit mono PCM .wav file. The header's sizes are filled in on close.
+class WavWriter {
+    public:
+        WavWriter(const std::string &path, unsigned int sampleRate);
+        WavWriter(const WavWriter &) = delete;
+        WavWriter &operator=(const WavWriter &) = delete;
+        ~WavWriter();
+        // False if the file could not be opened or written.
+        bool good() const;
+        void write(const std::int16_t *samples, std::size_t count);
+        // Finishes the header. Returns good().
+        bool close();
+        unsigned long samplesWritten() const;
+    private:
+        void writeHeader();
+        std::FILE *file = nullptr;
+        unsigned int sampleRate;
+        std::uint32_t dataBytes = 0;
+        bool failed = false;
+};
+
+#endif //NESEMULATOR_WAVWRITER_HPP
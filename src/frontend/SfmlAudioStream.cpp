@@ -0,0 +1,30 @@
+#include <algorithm>
+#include "SfmlAudioStream.hpp"
+
+// Samples per pull, about 12 ms at 44.1 kHz.
+#define STREAM_CHUNK 512
+
+SfmlAudioStream::SfmlAudioStream(SampleRing &ring, unsigned int sampleRate) : ring(ring), buffer(STREAM_CHUNK)
+{
+    initialize(1, sampleRate);
+}
+
+// The audio thread must be gone before the ring it reads.
+SfmlAudioStream::~SfmlAudioStream()
+{
+    stop();
+}
+
+bool SfmlAudioStream::onGetData(Chunk &data)
+{
+    std::size_t count = ring.read(buffer.data(), buffer.size());
+
+    std::fill(buffer.begin() + count, buffer.end(), 0);
+    data.samples = buffer.data();
+    data.sampleCount = buffer.size();
+    return true;
+}
+
+void SfmlAudioStream::onSeek(sf::Time)
+{
+}
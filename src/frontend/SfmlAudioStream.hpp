@@ -0,0 +1,22 @@
+#ifndef NESEMULATOR_SFMLAUDIOSTREAM_HPP
+#define NESEMULATOR_SFMLAUDIOSTREAM_HPP
+
+#include <vector>
+#include <SFML/Audio.hpp>
+#include "core/SampleRing.hpp"
+
+// Real-time sink: SFML's audio thread pulls whatever the ring holds and
+// pads with silence when the emulation is behind, so neither side ever
+// waits for the other.
+class SfmlAudioStream : public sf::SoundStream {
+    public:
+        SfmlAudioStream(SampleRing &ring, unsigned int sampleRate);
+        ~SfmlAudioStream() override;
+    private:
+        bool onGetData(Chunk &data) override;
+        void onSeek(sf::Time timeOffset) override;
+        SampleRing &ring;
+        std::vector<sf::Int16> buffer;
+};
+
+#endif //NESEMULATOR_SFMLAUDIOSTREAM_HPP
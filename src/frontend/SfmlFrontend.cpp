@@ -0,0 +1,151 @@
+#include <array>
+#include <cstring>
+#include "SfmlFrontend.hpp"
+
+// Gray level of each plane colour: plain CHIP-8 stays black and white,
+// XO-CHIP's other two colours are the grays in between.
+static const sf::Uint8 palette[4] = {0, 255, 85, 170};
+
+// RGBA for each of the 256 possible 4-pixel runs of both planes, plane 0
+// in the high nibble, MSB first.
+static const std::array<std::array<sf::Uint8, 4 * 4>, 256> expandedNibbles = [] {
+    std::array<std::array<sf::Uint8, 4 * 4>, 256> table{};
+
+    for (int index = 0; index < 256; index++) {
+        for (int bit = 0; bit < 4; bit++) {
+            int colour = (index >> (7 - bit) & 1) | (index >> (3 - bit) & 1) << 1;
+            sf::Uint8 value = palette[colour];
+            table[index][bit * 4] = value;
+            table[index][bit * 4 + 1] = value;
+            table[index][bit * 4 + 2] = value;
+            table[index][bit * 4 + 3] = 255; //no opacity
+        }
+    }
+    return table;
+}();
+
+SfmlFrontend::SfmlFrontend() : window(sf::VideoMode(800, 600, 32), sf::String("chip8"))
+{
+    texture.create(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    graphicsPixels = new sf::Uint8[DISPLAY_WIDTH * DISPLAY_HEIGHT * 4];
+    sprite.setTexture(texture);
+    sprite.setPosition({0.0, 0.0});
+}
+
+SfmlFrontend::~SfmlFrontend()
+{
+    delete[] graphicsPixels;
+}
+
+bool SfmlFrontend::isOpen() const
+{
+    return window.isOpen() && !closeRequested;
+}
+
+// Keypad key for a host key, or -1 when it is not part of the keypad.
+static int keypadKey(sf::Keyboard::Key code)
+{
+    switch (code) {
+        case sf::Keyboard::X: return 0x0;
+        case sf::Keyboard::Num1: return 0x1;
+        case sf::Keyboard::Num2: return 0x2;
+        case sf::Keyboard::Num3: return 0x3;
+        case sf::Keyboard::A: return 0x4;
+        case sf::Keyboard::Z: return 0x5;
+        case sf::Keyboard::E: return 0x6;
+        case sf::Keyboard::Q: return 0x7;
+        case sf::Keyboard::S: return 0x8;
+        case sf::Keyboard::D: return 0x9;
+        case sf::Keyboard::W: return 0xA;
+        case sf::Keyboard::C: return 0xB;
+        case sf::Keyboard::Num4: return 0xC;
+        case sf::Keyboard::R: return 0xD;
+        case sf::Keyboard::F: return 0xE;
+        case sf::Keyboard::V: return 0xF;
+        default: return -1;
+    }
+}
+
+// Only the window's event queue is read, the keyboard itself is never
+// queried. Keys held when focus is lost are released, their release event
+// would go to another window.
+void SfmlFrontend::pollInput(InputQueue &events)
+{
+    sf::Event event{};
+
+    while (window.pollEvent(event)) {
+        if (event.type == sf::Event::Closed) {
+            closeRequested = true;
+        } else if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) {
+            int key = keypadKey(event.key.code);
+            bool pressed = event.type == sf::Event::KeyPressed;
+
+            if (key >= 0 && heldKeys[key] != pressed) {
+                heldKeys[key] = pressed;
+                events.push({inputTimestamp(), static_cast<unsigned char>(key), pressed});
+            }
+        } else if (event.type == sf::Event::LostFocus) {
+            for (unsigned char key = 0; key < 16; key++) {
+                if (heldKeys[key]) {
+                    heldKeys[key] = false;
+                    events.push({inputTimestamp(), key, false});
+                }
+            }
+        }
+    }
+}
+
+void SfmlFrontend::present(const Display &display, std::uint64_t changedRows)
+{
+    // Both modes fill the same 640x320 of the window.
+    if (display.width != shownWidth) {
+        float scale = 640.0f / display.width;
+        sprite.setTextureRect(sf::IntRect(0, 0, display.width, display.height));
+        sprite.setScale({scale, scale});
+        shownWidth = display.width;
+    }
+    // Convert and upload each run of consecutive changed rows on its own.
+    while (changedRows != 0) {
+        int firstRow = __builtin_ctzll(changedRows);
+        std::uint64_t run = changedRows >> firstRow;
+        int rowCount = run == ~0ull ? 64 : __builtin_ctzll(~run);
+        mapPixels(display, firstRow, rowCount);
+        changedRows &= rowCount == 64 ? 0 : ~(((1ull << rowCount) - 1) << firstRow);
+    }
+    window.clear(sf::Color::Black);
+    window.draw(sprite);
+    window.display();
+}
+
+void SfmlFrontend::setBuzzer(bool)
+{
+}
+
+void SfmlFrontend::releaseRenderContext()
+{
+    window.setActive(false);
+}
+
+void SfmlFrontend::acquireRenderContext()
+{
+    window.setActive(true);
+}
+
+// Rows are display.width pixels apart in graphicsPixels, so a run of them
+// uploads in one go.
+void SfmlFrontend::mapPixels(const Display &display, int firstRow, int rowCount)
+{
+    const unsigned int width = display.width;
+
+    for (int y = firstRow; y < firstRow + rowCount; y++)
+    {
+        sf::Uint8 *line = graphicsPixels + y * width * 4;
+        for (unsigned int x = 0; x < width; x += 4) {
+            unsigned int shift = 60 - x % 64;
+            unsigned int index = (display.planes[0][y][x / 64] >> shift & 0xF) << 4
+                                 | (display.planes[1][y][x / 64] >> shift & 0xF);
+            std::memcpy(line + x * 4, expandedNibbles[index].data(), 4 * 4);
+        }
+    }
+    texture.update(graphicsPixels + firstRow * width * 4, width, rowCount, 0, firstRow);
+}
@@ -0,0 +1,35 @@
+#ifndef NESEMULATOR_SFMLFRONTEND_HPP
+#define NESEMULATOR_SFMLFRONTEND_HPP
+
+#include <SFML/Graphics.hpp>
+#include "core/Frontend.hpp"
+
+class SfmlFrontend : public Frontend {
+    public:
+        SfmlFrontend();
+        ~SfmlFrontend() override;
+        bool isOpen() const override;
+        void pollInput(InputQueue &events) override;
+        void present(const Display &display, std::uint64_t changedRows) override;
+        void setBuzzer(bool on) override;
+        void releaseRenderContext() override;
+        void acquireRenderContext() override;
+    private:
+        void mapPixels(const Display &display, int firstRow, int rowCount);
+        sf::RenderWindow window;
+        sf::Texture texture;
+        sf::Sprite sprite;
+        sf::Uint8 *graphicsPixels = nullptr;
+        // Width of the mode the sprite is set up for, the texture holds
+        // the top left corner of the high resolution one in low
+        // resolution.
+        unsigned int shownWidth = 0;
+        // Closing is deferred to the destructor: the window may still be
+        // drawn to from the render thread.
+        bool closeRequested = false;
+        // Keypad keys as last reported, so auto-repeat never reaches the
+        // queue.
+        bool heldKeys[16]{};
+};
+
+#endif //NESEMULATOR_SFMLFRONTEND_HPP
@@ -2,10 +2,231 @@
 // Created by abel on 28/01/2020.
 //
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/AudioFrontend.hpp"
+#include "core/CaptureFrontend.hpp"
+#include "core/Checkpoint.hpp"
 #include "core/Chip8.hpp"
+#include "core/Hash.hpp"
+#include "core/NullFrontend.hpp"
+#include "core/Scheduler.hpp"
+#include "core/WavWriter.hpp"
+#ifdef CHIP8_WITH_SFML
+#include "core/ThreadedFrontend.hpp"
+#include "frontend/SfmlAudioStream.hpp"
+#include "frontend/SfmlFrontend.hpp"
+#endif
+#ifdef CHIP8_TRACE
+#include "core/Tracer.hpp"
+#endif
+#ifdef CHIP8_PROFILE
+#include "core/Profiler.hpp"
+#endif
 
-int main()
+int main(int argc, char **argv)
 {
-    Chip8 chip8("toto.rom");
-    chip8.runGame();
+    const char *romPath = "toto.rom";
+    bool headless = false;
+    bool turbo = false;
+    unsigned int instructionsPerSecond = DEFAULT_IPS;
+    const char *tracePath = nullptr;
+    const char *profilePath = nullptr;
+    unsigned long frames = 0;
+    const char *capturePath = nullptr;
+    CaptureFormat captureFormat = CAPTURE_Y4M;
+    unsigned int captureScale = 1;
+    const char *wavPath = nullptr;
+    const char *quirkDatabasePath = nullptr;
+    bool overrideQuirks = false;
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+    std::uint32_t seed = 1;
+    const char *checkpointPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--turbo") == 0)
+            turbo = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            capturePath = argv[++i];
+        else if (std::strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+            if (!parseCaptureFormat(argv[++i], captureFormat)) {
+                std::fprintf(stderr, "unknown capture format %s, expected raw, y4m or png\n", argv[i]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--capture-scale") == 0 && i + 1 < argc)
+            captureScale = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--wav") == 0 && i + 1 < argc)
+            wavPath = argv[++i];
+        else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if (!parseQuirkProfile(argv[++i], quirks)) {
+                std::fprintf(stderr, "unknown quirk profile %s, expected default, vip, chip48, schip or xochip\n", argv[i]);
+                return 1;
+            }
+            overrideQuirks = true;
+        } else if (std::strcmp(argv[i], "--quirk-db") == 0 && i + 1 < argc)
+            quirkDatabasePath = argv[++i];
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--checkpoints") == 0 && i + 1 < argc)
+            checkpointPath = argv[++i];
+        else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            profilePath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+            instructionsPerSecond = std::strtoul(argv[++i], nullptr, 10);
+        else
+            romPath = argv[i];
+    }
+
+    std::string error;
+    if (quirkDatabasePath != nullptr && !loadQuirkDatabase(quirkDatabasePath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    Chip8 chip8;
+    if (!chip8.loadFile(romPath))
+        return 1;
+    if (overrideQuirks)
+        chip8.setQuirks(quirks);
+    chip8.setSeed(seed);
+    // Every frame from the first, for chip8_verify to replay.
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (checkpointPath != nullptr) {
+        std::ifstream romFile(romPath, std::ios::binary);
+        std::vector<unsigned char> rom((std::istreambuf_iterator<char>(romFile)), std::istreambuf_iterator<char>());
+        CheckpointHeader header{};
+
+        std::memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+        header.version = CHECKPOINT_VERSION;
+        header.romHash = fnv1a64(rom.data(), rom.size());
+        header.seed = seed;
+        header.quirks = chip8.getQuirks();
+        checkpoints.reset(new CheckpointWriter(checkpointPath, header));
+        if (!checkpoints->good()) {
+            std::fprintf(stderr, "cannot write checkpoints to %s\n", checkpointPath);
+            return 1;
+        }
+        chip8.setCheckpointWriter(checkpoints.get());
+    }
+    Scheduler scheduler(chip8, instructionsPerSecond);
+    scheduler.setTurbo(turbo);
+#ifdef CHIP8_TRACE
+    Tracer tracer(1 << 20, true);
+    if (tracePath != nullptr) {
+        tracer.dumpOnCrash(tracePath);
+        chip8.setTracer(&tracer);
+    }
+#endif
+#ifdef CHIP8_PROFILE
+    Profiler profiler;
+    if (profilePath != nullptr)
+        chip8.setProfiler(&profiler);
+#endif
+    // Runs on output through the buzzer, and the capture sink if one was
+    // asked for. The buzzer plays on the audio device unless it goes to a
+    // .wav file.
+    auto run = [&](Frontend &output, bool playAudio) {
+        std::unique_ptr<WavWriter> wav;
+        bool ok = true;
+
+        if (wavPath != nullptr) {
+            wav.reset(new WavWriter(wavPath, AUDIO_SAMPLE_RATE));
+            if (!wav->good()) {
+                std::fprintf(stderr, "cannot write audio to %s\n", wavPath);
+                return false;
+            }
+        }
+        AudioFrontend audio(output, AUDIO_SAMPLE_RATE);
+        audio.setWavWriter(wav.get());
+#ifdef CHIP8_WITH_SFML
+        std::unique_ptr<SfmlAudioStream> stream;
+        if (playAudio && wav == nullptr) {
+            stream.reset(new SfmlAudioStream(audio.samples(), audio.sampleRate()));
+            stream->play();
+        }
+#else
+        (void)playAudio;
+#endif
+        if (capturePath != nullptr) {
+            CaptureFrontend capture(audio, captureFormat, capturePath, captureScale);
+            chip8.setFrontend(capture);
+            if (frames > 0)
+                scheduler.run(frames);
+            else
+                scheduler.run();
+            chip8.setFrontend(audio);
+            if (!capture.good()) {
+                std::fprintf(stderr, "cannot write capture to %s\n", capturePath);
+                ok = false;
+            }
+        } else {
+            chip8.setFrontend(audio);
+            if (frames > 0)
+                scheduler.run(frames);
+            else
+                scheduler.run();
+        }
+        chip8.setFrontend(output);
+        audio.flush();
+        if (wav != nullptr && !wav->close()) {
+            std::fprintf(stderr, "cannot write audio to %s\n", wavPath);
+            ok = false;
+        }
+        return ok;
+    };
+    bool ok;
+#ifdef CHIP8_WITH_SFML
+    if (!headless) {
+        SfmlFrontend window;
+        ThreadedFrontend frontend(window);
+        ok = run(frontend, true);
+    } else
+#else
+    (void)headless;
+#endif
+    {
+        NullFrontend frontend;
+        ok = run(frontend, false);
+    }
+    if (checkpoints != nullptr) {
+        chip8.setCheckpointWriter(nullptr);
+        if (!checkpoints->close()) {
+            std::fprintf(stderr, "cannot write checkpoints to %s\n", checkpointPath);
+            ok = false;
+        }
+    }
+#ifdef CHIP8_TRACE
+    if (tracePath != nullptr)
+        tracer.dump(tracePath);
+#else
+    (void)tracePath;
+#endif
+#ifdef CHIP8_PROFILE
+    if (profilePath != nullptr) {
+        std::FILE *flat = std::fopen(profilePath, "w");
+        std::FILE *collapsed = std::fopen((std::string(profilePath) + ".collapsed").c_str(), "w");
+        if (flat != nullptr) {
+            profiler.dumpFlat(flat);
+            std::fclose(flat);
+        }
+        if (collapsed != nullptr) {
+            profiler.dumpCollapsed(collapsed);
+            std::fclose(collapsed);
+        }
+    }
+#else
+    (void)profilePath;
+#endif
+    return ok ? 0 : 1;
 }
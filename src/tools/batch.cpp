@@ -0,0 +1,85 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "batch/BatchRunner.hpp"
+#include "core/Scheduler.hpp"
+
+// Runs a manifest of ROM jobs on every core and prints one tab-separated
+// result line per job, in manifest order.
+int main(int argc, char **argv)
+{
+    const char *manifestPath = nullptr;
+    const char *packPath = nullptr;
+    unsigned int threads = std::thread::hardware_concurrency();
+    unsigned long cyclesPerFrame = DEFAULT_IPS / TIMER_FREQUENCY;
+    bool hashAudio = false;
+    const char *quirkDatabasePath = nullptr;
+    bool overrideQuirks = false;
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--audio") == 0)
+            hashAudio = true;
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            packPath = argv[++i];
+        else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if (!parseQuirkProfile(argv[++i], quirks)) {
+                std::fprintf(stderr, "unknown quirk profile %s\n", argv[i]);
+                return 1;
+            }
+            overrideQuirks = true;
+        } else if (std::strcmp(argv[i], "--quirk-db") == 0 && i + 1 < argc)
+            quirkDatabasePath = argv[++i];
+        else if (std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+            cyclesPerFrame = std::strtoul(argv[++i], nullptr, 10) / TIMER_FREQUENCY;
+        else
+            manifestPath = argv[i];
+    }
+    if (manifestPath == nullptr || cyclesPerFrame == 0) {
+        std::fprintf(stderr, "usage: %s [--threads N] [--ips N] [--pack file] [--audio] [--quirks profile]\n"
+                             "       [--quirk-db file] <manifest>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string error;
+    if (!loadManifest(manifestPath, jobs, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    for (BatchJob &job : jobs) {
+        job.hashAudio = hashAudio;
+        job.overrideQuirks = overrideQuirks;
+        job.quirks = quirks;
+    }
+    if (quirkDatabasePath != nullptr && !loadQuirkDatabase(quirkDatabasePath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    RomPack pack;
+    if (packPath != nullptr && !pack.open(packPath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<BatchResult> results = runBatch(jobs, cyclesPerFrame, threads, packPath != nullptr ? &pack : nullptr);
+    int failures = 0;
+    std::printf("rom\tstatus\tcycles\tframes\tidle_cycles\tframebuffer_hash\t%swall_us\n", hashAudio ? "audio_hash\t" : "");
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        const BatchResult &result = results[i];
+        if (!result.ok)
+            ++failures;
+        std::printf("%s\t%s\t%lu\t%lu\t%" PRIu64 "\t%016" PRIx64 "\t", jobs[i].romPath.c_str(),
+                    result.ok ? "ok" : result.error.c_str(), result.cycles, result.frames, result.idleCycles,
+                    result.framebufferHash);
+        if (hashAudio)
+            std::printf("%016" PRIx64 "\t", result.audioHash);
+        std::printf("%.0f\n", result.wallSeconds * 1e6);
+    }
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,267 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "core/Lockstep.hpp"
+#include "core/RecordingFrontend.hpp"
+#include "core/Scheduler.hpp"
+#include "core/ThreadedFrontend.hpp"
+
+// Interpreter throughput on synthetic workloads, one per opcode class,
+// plus any real ROMs given on the command line. Prints one JSON object so
+// runs can be diffed and tracked over time. ROMs built in with
+// CHIP8_RECOMPILE_ROMS are timed recompiled and interpreted.
+
+typedef std::chrono::steady_clock Clock;
+
+struct Workload {
+    const char *name;
+    std::vector<unsigned short> program;
+};
+
+static const Workload workloads[] = {
+        {"alu", {
+                0x6001,         // 200: V0 = 1
+                0x7101,         // 202: V1 += 1
+                0x8014,         //      V0 += V1
+                0x8213,         //      V2 ^= V1
+                0x8322,         //      V3 &= V2
+                0x8431,         //      V4 |= V3
+                0x8505,         //      V5 -= V0
+                0x8616,         //      V6 >>= 1
+                0x1202,         //      goto 202
+        }},
+        {"branch", {
+                0x7001,         // 200: V0 += 1
+                0x3080,         // 202: skip if V0 == 0x80
+                0x120A,         // 204: goto 20A
+                0x6000,         // 206: V0 = 0
+                0x1200,         // 208: goto 200
+                0x4100,         // 20A: skip if V1 != 0
+                0x7102,         // 20C: V1 += 2
+                0x5010,         // 20E: skip if V0 == V1
+                0x9010,         // 210: skip if V0 != V1
+                0x1200,         // 212: goto 200
+                0x1200,         // 214: goto 200
+        }},
+        {"sprite", {
+                0x6000,         // 200: V0 = 0
+                0x6100,         // 202: V1 = 0
+                0xA000,         // 204: I = glyph "0"
+                0xD015,         // 206: draw 8x5 at V0, V1
+                0x7007,         // 208: V0 += 7
+                0x7103,         // 20A: V1 += 3
+                0x1204,         // 20C: goto 204
+        }},
+        {"memory", {
+                0xA300,         // 200: I = 300
+                0x7001,         // 202: V0 += 1
+                0xF033,         // 204: BCD V0 at I
+                0xF355,         // 206: dump V0-V3
+                0xF365,         // 208: load V0-V3
+                0x1202,         // 20A: goto 202
+        }},
+};
+
+// Waits out the delay timer, the idle loop skipIdleLoop looks for.
+static const Workload idleWorkload = {"idle", {
+        0x6010,         // 200: V0 = 16
+        0xF015,         // 202: delay = V0
+        0xF007,         // 204: V0 = delay
+        0x3000,         // 206: skip if V0 == 0
+        0x1204,         // 208: goto 204
+        0x7101,         // 20A: V1 += 1
+        0x1200,         // 20C: goto 200
+}};
+
+static bool loadProgram(Chip8 &chip8, const std::vector<unsigned short> &program)
+{
+    std::vector<unsigned char> rom;
+
+    for (unsigned short word : program) {
+        rom.push_back(word >> 8);
+        rom.push_back(word & 0xFF);
+    }
+    return chip8.loadRom(rom.data(), rom.size());
+}
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void printRun(const char *name, unsigned long instructions, double seconds, bool last)
+{
+    std::printf("    {\"name\": \"%s\", \"instructions\": %lu, \"seconds\": %.6f, "
+                "\"mips\": %.2f, \"ns_per_instruction\": %.3f}%s\n",
+                name, instructions, seconds, instructions / seconds / 1e6,
+                seconds * 1e9 / instructions, last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long cycles = 50000000;
+    std::vector<std::string> romPaths;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+            cycles = std::strtoul(argv[++i], nullptr, 10);
+        else
+            romPaths.push_back(argv[i]);
+    }
+
+#if defined(CHIP8_DISPATCH_LEGACY)
+    const char *dispatch = "legacy";
+#elif defined(CHIP8_DISPATCH_THREADED)
+    const char *dispatch = "threaded";
+#elif defined(CHIP8_DISPATCH_PREDECODED)
+    const char *dispatch = "predecoded";
+#else
+    const char *dispatch = "table";
+#endif
+#ifdef CHIP8_JIT
+    const bool jit = true;
+#else
+    const bool jit = false;
+#endif
+    std::printf("{\n  \"dispatch\": \"%s\",\n  \"jit\": %s,\n  \"cycles\": %lu,\n  \"workloads\": [\n",
+                dispatch, jit ? "true" : "false", cycles);
+
+    const std::size_t workloadCount = sizeof(workloads) / sizeof(workloads[0]);
+    for (std::size_t i = 0; i < workloadCount; ++i) {
+        Chip8 chip8;
+        loadProgram(chip8, workloads[i].program);
+        Clock::time_point start = Clock::now();
+        chip8.runCycles(cycles);
+        printRun(workloads[i].name, cycles, secondsSince(start), i + 1 == workloadCount);
+    }
+
+    // The same workloads on every lockstep lane, each lane seeded apart,
+    // counting lane-instructions so the rate compares with the above.
+    std::printf("  ],\n  \"lockstep\": {\"lanes\": %d, \"workloads\": [\n", LOCKSTEP_LANES);
+    for (std::size_t i = 0; i < workloadCount; ++i) {
+        Chip8 chip8;
+        loadProgram(chip8, workloads[i].program);
+        std::unique_ptr<Lockstep> lockstep(new Lockstep(chip8));
+        for (unsigned int lane = 0; lane < lockstep->lanes(); ++lane)
+            lockstep->setSeed(lane, lane + 1);
+        Clock::time_point start = Clock::now();
+        lockstep->runCycles(cycles / LOCKSTEP_LANES);
+        printRun(workloads[i].name, cycles / LOCKSTEP_LANES * LOCKSTEP_LANES, secondsSince(start), i + 1 == workloadCount);
+    }
+    std::printf("  ]},\n");
+
+    // The alu workload under every quirk profile, each with its own
+    // interpreter, so the rates should match the default one. With the
+    // JIT the other profiles interpret the logic and shift instructions.
+    std::printf("  \"quirks\": [\n");
+    for (int profile = 0; profile < QUIRK_PROFILE_COUNT; ++profile) {
+        Chip8 chip8;
+        loadProgram(chip8, workloads[0].program);
+        chip8.setQuirks(static_cast<QuirkProfile>(profile));
+        Clock::time_point start = Clock::now();
+        chip8.runCycles(cycles);
+        printRun(quirkProfileNames[profile], cycles, secondsSince(start), profile + 1 == QUIRK_PROFILE_COUNT);
+    }
+    std::printf("  ],\n");
+
+    // Decode cost on its own: every 16-bit word through the switch decoder.
+    const unsigned int decodeRounds = 200;
+    unsigned long checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (unsigned int round = 0; round < decodeRounds; ++round)
+        for (unsigned int word = 0; word < 0x10000; ++word)
+            checksum += Chip8::decode(static_cast<unsigned short>(word));
+    double decodeSeconds = secondsSince(start);
+    std::printf("  \"decode\": {\"ns_per_decode\": %.3f, \"checksum\": %lu},\n",
+                decodeSeconds * 1e9 / (decodeRounds * 0x10000UL), checksum);
+
+    // Whole frames at the default speed: instructions, timer tick, present.
+    const unsigned long frames = 1000000;
+    Chip8 framed;
+    loadProgram(framed, workloads[2].program);
+    start = Clock::now();
+    for (unsigned long frame = 0; frame < frames; ++frame)
+        framed.runFrame(DEFAULT_IPS / TIMER_FREQUENCY);
+    double frameSeconds = secondsSince(start);
+    std::printf("  \"frames\": {\"ips\": %d, \"frames\": %lu, \"fps\": %.0f},\n", DEFAULT_IPS, frames, frames / frameSeconds);
+
+    // The same frames spent waiting on the delay timer.
+    Chip8 idle;
+    loadProgram(idle, idleWorkload.program);
+    start = Clock::now();
+    for (unsigned long frame = 0; frame < frames; ++frame)
+        idle.runFrame(DEFAULT_IPS / TIMER_FREQUENCY);
+    double idleSeconds = secondsSince(start);
+    unsigned long idleCycles = frames * (DEFAULT_IPS / TIMER_FREQUENCY);
+    std::printf("  \"idle\": {\"cycles\": %lu, \"skipped\": %" PRIu64 ", \"fps\": %.0f},\n", idleCycles,
+                idle.idleCyclesSkipped(), frames / idleSeconds);
+
+    // A display that takes a whole 60 Hz frame to present, inline and
+    // behind the render thread: only the latter should keep running at
+    // emulation speed.
+    const unsigned long stalledFrames = 120;
+    const std::chrono::microseconds stall(1000000 / TIMER_FREQUENCY);
+    double stalledSeconds[2] = {};
+    unsigned long shownFrames = 0;
+    for (int threaded = 0; threaded < 2; ++threaded) {
+        RecordingFrontend display(stall);
+        Chip8 stalled;
+        loadProgram(stalled, workloads[2].program);
+        start = Clock::now();
+        if (threaded) {
+            ThreadedFrontend frontend(display);
+            stalled.setFrontend(frontend);
+            for (unsigned long frame = 0; frame < stalledFrames; ++frame)
+                stalled.runFrame(DEFAULT_IPS / TIMER_FREQUENCY);
+            stalledSeconds[threaded] = secondsSince(start);
+        } else {
+            stalled.setFrontend(display);
+            for (unsigned long frame = 0; frame < stalledFrames; ++frame)
+                stalled.runFrame(DEFAULT_IPS / TIMER_FREQUENCY);
+            stalledSeconds[threaded] = secondsSince(start);
+        }
+        shownFrames = display.frames().size();
+    }
+    std::printf("  \"stalled_present\": {\"frames\": %lu, \"inline_fps\": %.0f, \"threaded_fps\": %.0f, "
+                "\"threaded_shown\": %lu},\n", stalledFrames, stalledFrames / stalledSeconds[0],
+                stalledFrames / stalledSeconds[1], shownFrames);
+
+    struct RomRun {
+        std::string path;
+        double seconds;
+    };
+    std::vector<RomRun> romRuns;
+    for (const std::string &romPath : romPaths) {
+        std::ifstream inFile(romPath, std::ios::binary);
+        std::vector<unsigned char> rom((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+        Chip8 chip8;
+        if (!inFile.is_open() || !chip8.loadRom(rom.data(), rom.size())) {
+            std::fprintf(stderr, "%s: cannot load\n", romPath.c_str());
+            continue;
+        }
+        // Recompiled ROMs run a second time interpreted, from the same
+        // start, to compare.
+        std::unique_ptr<Chip8> interpreted = chip8.fork();
+        start = Clock::now();
+        chip8.runCycles(cycles);
+        romRuns.push_back({romPath + (chip8.isRecompiled() ? " (recompiled)" : ""), secondsSince(start)});
+        if (chip8.isRecompiled()) {
+            interpreted->setRecompiled(nullptr);
+            start = Clock::now();
+            interpreted->runCycles(cycles);
+            romRuns.push_back({romPath + " (interpreted)", secondsSince(start)});
+        }
+    }
+    std::printf("  \"roms\": [\n");
+    for (std::size_t i = 0; i < romRuns.size(); ++i)
+        printRun(romRuns[i].path.c_str(), cycles, romRuns[i].seconds, i + 1 == romRuns.size());
+    std::printf("  ]\n}\n");
+    return 0;
+}
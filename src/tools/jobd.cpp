@@ -0,0 +1,229 @@
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "batch/JobServer.hpp"
+#include "core/Hash.hpp"
+
+// Serves ROM jobs on a Unix socket until interrupted, or with --load
+// drives such a server from several connections at once and prints the
+// job rate and latency percentiles as JSON.
+
+typedef std::chrono::steady_clock Clock;
+
+static JobServer *runningServer = nullptr;
+
+static void stopServer(int)
+{
+    if (runningServer != nullptr)
+        runningServer->stop();
+}
+
+static void usage(const char *program)
+{
+    std::fprintf(stderr, "usage: %s [--workers N] [--queue N] [--max-connections N] [--receive-timeout ms] [--ips N]\n"
+                         "             [--pack file] [--quirk-db file] <socket>\n"
+                         "       %s --load [--connections N] [--jobs N] [--cycles N] [--timeout ms] [--script file]\n"
+                         "             [--hash] <socket> <rom>\n", program, program);
+}
+
+static int serve(int argc, char **argv)
+{
+    JobServerOptions options;
+    const char *socketPath = nullptr;
+    const char *packPath = nullptr;
+    const char *quirkDatabasePath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            options.workers = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc)
+            options.queueCapacity = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--max-connections") == 0 && i + 1 < argc)
+            options.maxConnections = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--receive-timeout") == 0 && i + 1 < argc)
+            options.receiveTimeoutMilliseconds = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+            options.cyclesPerFrame = std::strtoul(argv[++i], nullptr, 10) / TIMER_FREQUENCY;
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            packPath = argv[++i];
+        else if (std::strcmp(argv[i], "--quirk-db") == 0 && i + 1 < argc)
+            quirkDatabasePath = argv[++i];
+        else
+            socketPath = argv[i];
+    }
+    if (socketPath == nullptr || options.cyclesPerFrame == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string error;
+    RomPack pack;
+    if (packPath != nullptr) {
+        if (!pack.open(packPath, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        options.pack = &pack;
+    }
+    if (quirkDatabasePath != nullptr && !loadQuirkDatabase(quirkDatabasePath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    JobServer server(options);
+    if (!server.listen(socketPath, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.run();
+    runningServer = nullptr;
+
+    JobServerStatistics statistics = server.statistics();
+    std::fprintf(stderr, "%" PRIu64 " jobs completed, %" PRIu64 " timed out, %" PRIu64 " turned away busy\n",
+                 statistics.completed, statistics.timedOut, statistics.rejected);
+    return 0;
+}
+
+static int load(int argc, char **argv)
+{
+    unsigned int connections = 4;
+    unsigned long jobs = 1000;
+    unsigned long cycles = 100000;
+    std::uint32_t timeout = 0;
+    const char *scriptPath = nullptr;
+    bool byHash = false;
+    std::vector<const char *> paths;
+
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--connections") == 0 && i + 1 < argc)
+            connections = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobs = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+            cycles = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+            timeout = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--script") == 0 && i + 1 < argc)
+            scriptPath = argv[++i];
+        else if (std::strcmp(argv[i], "--hash") == 0)
+            byHash = true;
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2 || connections == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream romFile(paths[1], std::ios::binary);
+    std::vector<unsigned char> rom((std::istreambuf_iterator<char>(romFile)), std::istreambuf_iterator<char>());
+    if (!romFile.is_open() || rom.empty()) {
+        std::fprintf(stderr, "cannot read ROM %s\n", paths[1]);
+        return 1;
+    }
+    if (byHash) {
+        std::uint64_t hash = fnv1a64(rom.data(), rom.size());
+        rom.assign(reinterpret_cast<const unsigned char *>(&hash), reinterpret_cast<const unsigned char *>(&hash + 1));
+    }
+    std::string script;
+    if (scriptPath != nullptr) {
+        std::ifstream scriptFile(scriptPath);
+        if (!scriptFile.is_open()) {
+            std::fprintf(stderr, "cannot read script %s\n", scriptPath);
+            return 1;
+        }
+        script.assign((std::istreambuf_iterator<char>(scriptFile)), std::istreambuf_iterator<char>());
+    }
+
+    // Every connection sends its next job as soon as the last one is
+    // answered, each job seeded with its index.
+    std::mutex resultsMutex;
+    std::vector<double> latencies;
+    unsigned long statuses[JOB_STATUS_COUNT] = {};
+    unsigned long failures = 0;
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (unsigned int c = 0; c < connections; ++c) {
+        threads.emplace_back([&, c] {
+            std::string error;
+            int fd = connectJobServer(paths[0], error);
+            std::vector<double> ownLatencies;
+            unsigned long ownStatuses[JOB_STATUS_COUNT] = {};
+            unsigned long ownFailures = 0;
+
+            if (fd < 0) {
+                std::lock_guard<std::mutex> lock(resultsMutex);
+                std::fprintf(stderr, "%s\n", error.c_str());
+            }
+            for (unsigned long job = c; job < jobs; job += connections) {
+                JobRequestHeader header{};
+                JobResponse response;
+
+                std::memcpy(header.magic, JOB_REQUEST_MAGIC, 4);
+                header.version = JOB_PROTOCOL_VERSION;
+                header.flags = byHash ? JOB_ROM_HASH : 0;
+                header.cycles = cycles;
+                header.seed = job + 1;
+                header.timeoutMilliseconds = timeout;
+                header.romSize = rom.size();
+                header.scriptSize = script.size();
+                Clock::time_point sent = Clock::now();
+                if (fd < 0 || !runRemoteJob(fd, header, rom.data(), script, response)) {
+                    ++ownFailures;
+                    continue;
+                }
+                if (response.status < JOB_STATUS_COUNT)
+                    ++ownStatuses[response.status];
+                if (response.status != JOB_BUSY)
+                    ownLatencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+            }
+            if (fd >= 0)
+                close(fd);
+
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            latencies.insert(latencies.end(), ownLatencies.begin(), ownLatencies.end());
+            for (int s = 0; s < JOB_STATUS_COUNT; ++s)
+                statuses[s] += ownStatuses[s];
+            failures += ownFailures;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()))];
+    };
+    std::printf("{\n  \"connections\": %u,\n  \"jobs\": %lu,\n  \"cycles\": %lu,\n  \"seconds\": %.6f,\n"
+                "  \"jobs_per_second\": %.1f,\n", connections, jobs, cycles, seconds, latencies.size() / seconds);
+    std::printf("  \"statuses\": {");
+    for (int s = 0; s < JOB_STATUS_COUNT; ++s)
+        std::printf("\"%s\": %lu, ", jobStatusNames[s], statuses[s]);
+    std::printf("\"failed\": %lu},\n", failures);
+    std::printf("  \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}\n}\n",
+                percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999),
+                latencies.empty() ? 0.0 : latencies.back());
+    return failures == 0 ? 0 : 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--load") == 0)
+        return load(argc, argv);
+    return serve(argc, argv);
+}
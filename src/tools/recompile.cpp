@@ -0,0 +1,409 @@
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "core/Hash.hpp"
+#include "core/Recompiled.hpp"
+#include "core/RomPack.hpp"
+
+// Static recompiler: follows every path from 0x200 through jumps, calls,
+// returns and skips, splits what it reaches into basic blocks and writes
+// them out as a C++ source with one function per block, to be built into
+// the emulator. Registers, I, the delay timer, the stack and control flow
+// are compiled inline; every other instruction calls the interpreter
+// handler in place. BNNN targets are not followed, they are known only
+// at run time and the interpreter takes them.
+
+struct Rom {
+    std::vector<unsigned char> bytes;
+
+    unsigned int end() const
+    {
+        return 0x200 + bytes.size();
+    }
+
+    bool contains(unsigned int address, unsigned int length) const
+    {
+        return address >= 0x200 && address + length <= end();
+    }
+
+    unsigned short word(unsigned int address) const
+    {
+        return bytes[address - 0x200] << 8 | bytes[address - 0x200 + 1];
+    }
+};
+
+static unsigned int instructionLength(OpCode kind)
+{
+    return kind == SET_I_LONG ? 4 : 2;
+}
+
+static bool isSkip(OpCode kind)
+{
+    return kind == JMP_EQ || kind == JMP_NEQ || kind == JMP_EQ_REG || kind == JMP_NEQ_REG ||
+           kind == JMP_KEY_PRESSED || kind == JMP_NKEY_PRESSED;
+}
+
+// Interpreted instructions after which the block has to hand back: FX0A
+// halts the machine, 00FD spins in place and memory writes may land on
+// code, which the next block's check catches.
+static bool endsBlock(OpCode kind)
+{
+    return kind == GET_KEY || kind == EXIT || kind == STORES_BINARY || kind == REG_DUMP || kind == SAVE_RANGE;
+}
+
+static bool isJump(OpCode kind)
+{
+    return kind == GOTO || kind == SUBR_CALL || kind == RETURN || kind == JMP_TO || isSkip(kind);
+}
+
+// Where a taken skip at address lands, over both words of F000 NNNN.
+static unsigned int skipTarget(const Rom &rom, unsigned int address)
+{
+    return address + 2 + (rom.word(address + 2) == 0xF000 ? 4 : 2);
+}
+
+class Recompiler {
+    public:
+        explicit Recompiler(const Rom &rom) : rom(rom), reached(rom.bytes.size(), false)
+        {
+        }
+
+        // Marks every instruction reachable from 0x200 and the addresses
+        // blocks have to start at.
+        void explore()
+        {
+            std::vector<unsigned int> pending;
+
+            addLeader(0x200, pending);
+            while (!pending.empty()) {
+                unsigned int address = pending.back();
+                pending.pop_back();
+
+                while (rom.contains(address, 2) && !reached[address - 0x200]) {
+                    unsigned short opcode = rom.word(address);
+                    OpCode kind = Chip8::decode(opcode);
+                    unsigned int length = instructionLength(kind);
+
+                    // Data, or an instruction cut off by the end of the
+                    // ROM: the interpreter deals with whatever runs there.
+                    if (kind == UNKNOWN || kind == CALL || !rom.contains(address, length))
+                        break;
+                    if (isSkip(kind) && !rom.contains(address + 2, 2))
+                        break;
+                    reached[address - 0x200] = true;
+                    if (kind == GOTO) {
+                        addLeader(opcode & 0x0FFF, pending);
+                        break;
+                    }
+                    if (kind == SUBR_CALL) {
+                        addLeader(opcode & 0x0FFF, pending);
+                        addLeader(address + 2, pending);
+                        break;
+                    }
+                    if (kind == RETURN || kind == JMP_TO || kind == EXIT)
+                        break;
+                    if (isSkip(kind)) {
+                        addLeader(address + 2, pending);
+                        addLeader(skipTarget(rom, address), pending);
+                        break;
+                    }
+                    if (endsBlock(kind)) {
+                        addLeader(address + length, pending);
+                        break;
+                    }
+                    address += length;
+                }
+            }
+        }
+
+        // Compiles every block and writes the source, or fails if there is
+        // nothing to compile.
+        bool write(std::FILE *out, const std::string &name) const
+        {
+            struct Block {
+                unsigned int address;
+                unsigned int length;
+                unsigned int instructions;
+                std::string body;
+            };
+            std::vector<Block> blocks;
+
+            for (unsigned int leader : leaders) {
+                Block block = {leader, 0, 0, ""};
+                unsigned int next = 0;
+
+                // A run longer than the cap goes on in a block of its own.
+                while (compileBlock(block.address, block.body, block.length, block.instructions, next)) {
+                    blocks.push_back(block);
+                    if (next == 0)
+                        break;
+                    block = {next, 0, 0, ""};
+                }
+            }
+            if (blocks.empty())
+                return false;
+
+            std::fprintf(out, "// Generated by chip8_recompile from %s, do not edit.\n\n", name.c_str());
+            std::fprintf(out, "#include \"core/RecompiledMachine.hpp\"\n\n");
+            // A block that only jumps leaves the machine unnamed, so the
+            // output builds clean under -Wextra.
+            for (const Block &block : blocks)
+                std::fprintf(out, "static unsigned short block_%04X(RecompiledMachine &%s)\n{\n%s}\n\n",
+                             block.address, block.body.find("m.") != std::string::npos ? "m" : "",
+                             block.body.c_str());
+
+            std::fprintf(out, "static const unsigned char rom[] = {");
+            for (std::size_t i = 0; i < rom.bytes.size(); ++i)
+                std::fprintf(out, "%s0x%02X,", i % 12 == 0 ? "\n        " : " ", rom.bytes[i]);
+            std::fprintf(out, "\n};\n\nstatic const RecompiledBlock blocks[] = {\n");
+            for (const Block &block : blocks)
+                std::fprintf(out, "        {0x%04X, %u, %u, block_%04X},\n", block.address, block.length,
+                             block.instructions, block.address);
+            std::fprintf(out, "};\n\nstatic const std::int32_t blockAt[] = {");
+
+            std::vector<std::int32_t> blockAt(rom.bytes.size(), -1);
+            for (std::size_t i = 0; i < blocks.size(); ++i)
+                blockAt[blocks[i].address - 0x200] = i;
+            for (std::size_t i = 0; i < blockAt.size(); ++i)
+                std::fprintf(out, "%s%d,", i % 16 == 0 ? "\n        " : " ", blockAt[i]);
+
+            std::fprintf(out, "\n};\n\nstatic const RecompiledProgram program = {\n"
+                              "        \"%s\", 0x%016" PRIX64 "ull, rom, sizeof(rom),\n"
+                              "        blocks, sizeof(blocks) / sizeof(blocks[0]), blockAt\n};\n\n"
+                              "static RecompiledRegistration registration(program);\n",
+                         name.c_str(), fnv1a64(rom.bytes.data(), rom.bytes.size()));
+            return true;
+        }
+    private:
+        void addLeader(unsigned int address, std::vector<unsigned int> &pending)
+        {
+            // Blocks start at even addresses only so that, sorted, they
+            // never overlap. Odd targets are left to the interpreter.
+            if (address % 2 != 0 || !rom.contains(address, 2))
+                return;
+            if (leaders.insert(address).second)
+                pending.push_back(address);
+        }
+
+        bool isLeader(unsigned int address) const
+        {
+            return leaders.count(address) != 0;
+        }
+
+        // The body of the block at address: its instructions up to a jump
+        // or a skip, the next block or the cap, in which case next is where
+        // the rest goes on.
+        bool compileBlock(unsigned int address, std::string &body, unsigned int &length, unsigned int &instructions,
+                          unsigned int &next) const
+        {
+            unsigned int pc = address;
+            char line[160];
+
+            instructions = 0;
+            next = 0;
+            while (rom.contains(pc, 2) && reached[pc - 0x200]) {
+                unsigned short opcode = rom.word(pc);
+                OpCode kind = Chip8::decode(opcode);
+                unsigned int x = (opcode & 0x0F00) >> 8;
+                unsigned int y = (opcode & 0x00F0) >> 4;
+                unsigned int nn = opcode & 0x00FF;
+
+                if (pc != address && isLeader(pc))
+                    break;
+                if (instructions == RECOMPILED_MAX_BLOCK_INSTRUCTIONS) {
+                    next = pc;
+                    break;
+                }
+                // Jumped into the middle of F000 NNNN: it runs interpreted.
+                if (instructionLength(kind) == 4 && isLeader(pc + 2))
+                    break;
+                ++instructions;
+                if (isJump(kind)) {
+                    compileJump(kind, opcode, pc, body);
+                    length = pc - address + (isSkip(kind) ? 4 : 2);
+                    return true;
+                }
+                if (endsBlock(kind)) {
+                    std::snprintf(line, sizeof(line), "    m.interpret(0x%04X);\n    return m.PC;\n", pc);
+                    body += line;
+                    length = pc - address + 2;
+                    return true;
+                }
+                switch (kind) {
+                    case SET_VAL:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] = 0x%02X;\n", x, nn);
+                        break;
+                    case ADD_VAL:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] += 0x%02X;\n", x, nn);
+                        break;
+                    case SET_REG:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] = m.V[0x%X];\n", x, y);
+                        break;
+                    case OR:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] |= m.V[0x%X];\n", x, y);
+                        break;
+                    case AND:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] &= m.V[0x%X];\n", x, y);
+                        break;
+                    case XOR:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] ^= m.V[0x%X];\n", x, y);
+                        break;
+                    // Flags and shift source depend on the quirks, the
+                    // machine applies them.
+                    case ADD_REG:
+                        std::snprintf(line, sizeof(line), "    m.addReg(0x%X, 0x%X);\n", x, y);
+                        break;
+                    case SUB_REG:
+                        std::snprintf(line, sizeof(line), "    m.subReg(0x%X, 0x%X);\n", x, y);
+                        break;
+                    case RSHIFT_REG:
+                        std::snprintf(line, sizeof(line), "    m.rshiftReg(0x%X, 0x%X);\n", x, y);
+                        break;
+                    case SUB_REG_BIS:
+                        std::snprintf(line, sizeof(line), "    m.subRegBis(0x%X, 0x%X);\n", x, y);
+                        break;
+                    case LSHIFT_REG:
+                        std::snprintf(line, sizeof(line), "    m.lshiftReg(0x%X, 0x%X);\n", x, y);
+                        break;
+                    case SET_I:
+                        std::snprintf(line, sizeof(line), "    m.I = 0x%03X;\n", opcode & 0x0FFF);
+                        break;
+                    case SET_I_LONG:
+                        std::snprintf(line, sizeof(line), "    m.I = 0x%04X;\n", rom.word(pc + 2));
+                        break;
+                    case ADD_I:
+                        std::snprintf(line, sizeof(line), "    m.I += m.V[0x%X];\n", x);
+                        break;
+                    case SET_I_CHAR:
+                        std::snprintf(line, sizeof(line), "    m.I = m.V[0x%X] * 5;\n", x);
+                        break;
+                    case SET_I_BIG_CHAR:
+                        std::snprintf(line, sizeof(line), "    m.I = 0x%02X + (m.V[0x%X] & 0xF) * 10;\n", BIG_FONTSET_ADDRESS, x);
+                        break;
+                    case GET_DELAY:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] = m.DT;\n", x);
+                        break;
+                    case SET_DELAY_TMR:
+                        std::snprintf(line, sizeof(line), "    m.DT = m.V[0x%X];\n", x);
+                        break;
+                    case SET_REG_RAND:
+                        std::snprintf(line, sizeof(line), "    m.V[0x%X] = m.random() & 0x%02X;\n", x, nn);
+                        break;
+                    default:
+                        std::snprintf(line, sizeof(line), "    m.interpret(0x%04X);\n", pc);
+                        break;
+                }
+                body += line;
+                pc += instructionLength(kind);
+            }
+            if (instructions == 0)
+                return false;
+            std::snprintf(line, sizeof(line), "    return 0x%04X;\n", static_cast<unsigned short>(pc));
+            body += line;
+            length = pc - address;
+            return true;
+        }
+
+        void compileJump(OpCode kind, unsigned short opcode, unsigned int pc, std::string &body) const
+        {
+            unsigned int x = (opcode & 0x0F00) >> 8;
+            unsigned int y = (opcode & 0x00F0) >> 4;
+            unsigned int nn = opcode & 0x00FF;
+            char condition[64] = "";
+            char line[160];
+
+            switch (kind) {
+                case GOTO:
+                    std::snprintf(line, sizeof(line), "    return 0x%03X;\n", opcode & 0x0FFF);
+                    body += line;
+                    return;
+                case SUBR_CALL:
+                    std::snprintf(line, sizeof(line), "    m.stack[m.SP & 0xF] = 0x%04X;\n    m.SP++;\n    return 0x%03X;\n",
+                                  pc, opcode & 0x0FFF);
+                    body += line;
+                    return;
+                case RETURN:
+                    body += "    --m.SP;\n    return m.stack[m.SP & 0xF] + 2;\n";
+                    return;
+                case JMP_TO:
+                    std::snprintf(line, sizeof(line), "    return m.V[0x0] + 0x%03X;\n", opcode & 0x0FFF);
+                    body += line;
+                    return;
+                case JMP_EQ:
+                    std::snprintf(condition, sizeof(condition), "m.V[0x%X] == 0x%02X", x, nn);
+                    break;
+                case JMP_NEQ:
+                    std::snprintf(condition, sizeof(condition), "m.V[0x%X] != 0x%02X", x, nn);
+                    break;
+                case JMP_EQ_REG:
+                    std::snprintf(condition, sizeof(condition), "m.V[0x%X] == m.V[0x%X]", x, y);
+                    break;
+                case JMP_NEQ_REG:
+                    std::snprintf(condition, sizeof(condition), "m.V[0x%X] != m.V[0x%X]", x, y);
+                    break;
+                case JMP_KEY_PRESSED:
+                    std::snprintf(condition, sizeof(condition), "m.keyPressed[m.V[0x%X] & 0xF]", x);
+                    break;
+                case JMP_NKEY_PRESSED:
+                    std::snprintf(condition, sizeof(condition), "!m.keyPressed[m.V[0x%X] & 0xF]", x);
+                    break;
+                default:
+                    break;
+            }
+            std::snprintf(line, sizeof(line), "    return %s ? 0x%04X : 0x%04X;\n", condition,
+                          static_cast<unsigned short>(skipTarget(rom, pc)), pc + 2);
+            body += line;
+        }
+
+        const Rom &rom;
+        // Per ROM byte, whether an instruction reachable from 0x200 starts there.
+        std::vector<bool> reached;
+        std::set<unsigned int> leaders;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 && argc != 4) {
+        std::fprintf(stderr, "usage: %s <rom> <output.cpp> [name]\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream inFile(argv[1], std::ios::binary);
+    Rom rom;
+    rom.bytes.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    if (!inFile.is_open() || rom.bytes.empty() || rom.bytes.size() > MAX_ROM_SIZE) {
+        std::fprintf(stderr, "%s: cannot load, expected 1 to %d bytes\n", argv[1], MAX_ROM_SIZE);
+        return 1;
+    }
+
+    std::string name = argc == 4 ? argv[3] : std::filesystem::path(argv[1]).stem().string();
+    for (char &c : name)
+        if (c == '"' || c == '\\' || c < ' ')
+            c = '_';
+
+    Recompiler recompiler(rom);
+    recompiler.explore();
+
+    std::FILE *out = std::fopen(argv[2], "w");
+    if (out == nullptr) {
+        std::fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+    if (!recompiler.write(out, name)) {
+        std::fprintf(stderr, "%s: nothing reachable from 0x200 to recompile\n", argv[1]);
+        std::fclose(out);
+        std::remove(argv[2]);
+        return 1;
+    }
+    if (std::fclose(out) != 0) {
+        std::fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "core/Hash.hpp"
+#include "core/RomPack.hpp"
+
+// Packs every regular file under a directory into one ROM pack and prints
+// "<hash> <path>" per ROM, or lists the index of an existing pack.
+int main(int argc, char **argv)
+{
+    std::string error;
+
+    if (argc == 3 && std::strcmp(argv[1], "--list") == 0) {
+        RomPack pack;
+        if (!pack.open(argv[2], error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        for (std::size_t i = 0; i < pack.size(); ++i)
+            std::printf("%016" PRIx64 " %u\n", pack.entry(i).hash, pack.entry(i).size);
+        return 0;
+    }
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <pack> <rom directory>\n       %s --list <pack>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> paths;
+    std::error_code code;
+    for (std::filesystem::recursive_directory_iterator it(argv[2], code), end; !code && it != end; it.increment(code))
+        if (it->is_regular_file())
+            paths.push_back(it->path());
+    if (code) {
+        std::fprintf(stderr, "%s: %s\n", argv[2], code.message().c_str());
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<std::vector<unsigned char>> roms;
+    for (const std::filesystem::path &path : paths) {
+        std::ifstream inFile(path, std::ios::binary);
+        std::vector<unsigned char> rom((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+
+        if (rom.empty() || rom.size() > MAX_ROM_SIZE) {
+            std::fprintf(stderr, "skipping %s: %zu bytes\n", path.c_str(), rom.size());
+            continue;
+        }
+        std::printf("%016" PRIx64 " %s\n", fnv1a64(rom.data(), rom.size()), path.c_str());
+        roms.push_back(std::move(rom));
+    }
+    if (!writeRomPack(argv[1], roms, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
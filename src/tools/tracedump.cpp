@@ -0,0 +1,40 @@
+#include <cstdio>
+#include <cstring>
+#include "core/Chip8.hpp"
+#include "core/Tracer.hpp"
+
+// Prints a binary trace written by Tracer::dump, one instruction per line.
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = std::fopen(argv[1], "rb");
+    if (file == nullptr) {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    TraceHeader header{};
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION) {
+        std::fprintf(stderr, "%s: not a version %d trace\n", argv[1], TRACE_VERSION);
+        std::fclose(file);
+        return 1;
+    }
+
+    TraceRecord record{};
+    for (std::uint32_t i = 0; i < header.count && std::fread(&record, sizeof(record), 1, file) == 1; ++i) {
+        const char *name = record.instruction <= UNKNOWN ? opCodeNames[record.instruction] : "?";
+        std::printf("%03X  %04X  ", record.programCounter, record.opcode);
+        if (record.changedRegister != TRACE_NO_REGISTER)
+            std::printf("%-14s  V%X %02X -> %02X\n", name, record.changedRegister, record.oldValue, record.newValue);
+        else
+            std::printf("%s\n", name);
+    }
+    std::fclose(file);
+    return 0;
+}
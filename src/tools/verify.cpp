@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "core/Checkpoint.hpp"
+#include "core/Chip8.hpp"
+#include "core/Hash.hpp"
+
+// Replays a checkpoint log recorded with emu --checkpoints: the ROM from
+// the same start, each frame running the recorded number of instructions
+// with the recorded key events, uncapped. Stops at the first frame whose
+// end state differs from the log and prints what differs.
+
+// Hands the machine the key events the log recorded for the frame.
+class ReplayFrontend : public Frontend {
+    public:
+        bool isOpen() const override
+        {
+            return true;
+        }
+
+        void pollInput(InputQueue &events) override
+        {
+            for (unsigned int i = 0; i < count; ++i)
+                events.push({0, keys[i].key, keys[i].pressed != 0});
+            count = 0;
+        }
+
+        void present(const Display &, std::uint64_t) override
+        {
+        }
+
+        void setBuzzer(bool) override
+        {
+        }
+
+        CheckpointKey keys[INPUT_QUEUE_SIZE];
+        unsigned int count = 0;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <checkpoint log> <rom>\n", argv[0]);
+        return 1;
+    }
+
+    CheckpointReader log(argv[1]);
+    if (!log.good()) {
+        std::fprintf(stderr, "%s\n", log.error().c_str());
+        return 1;
+    }
+    const CheckpointHeader &header = log.header();
+    std::ifstream romFile(argv[2], std::ios::binary);
+    std::vector<unsigned char> rom((std::istreambuf_iterator<char>(romFile)), std::istreambuf_iterator<char>());
+    if (!romFile.is_open() || rom.empty()) {
+        std::fprintf(stderr, "cannot read ROM %s\n", argv[2]);
+        return 1;
+    }
+    if (fnv1a64(rom.data(), rom.size()) != header.romHash) {
+        std::fprintf(stderr, "%s is not the ROM the log was recorded from (%016llx)\n", argv[2],
+                     static_cast<unsigned long long>(header.romHash));
+        return 1;
+    }
+    if (header.quirks >= QUIRK_PROFILE_COUNT) {
+        std::fprintf(stderr, "log recorded with unknown quirk profile %u\n", header.quirks);
+        return 1;
+    }
+
+    Chip8 chip8;
+    ReplayFrontend frontend;
+    if (!chip8.loadRom(rom.data(), rom.size()))
+        return 1;
+    chip8.setQuirks(static_cast<QuirkProfile>(header.quirks));
+    chip8.setSeed(header.seed);
+    chip8.setFrontend(frontend);
+
+    FrameCheckpoint expected;
+    FrameCheckpoint actual;
+    unsigned long frame = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (log.next(expected, frontend.keys)) {
+        frontend.count = expected.eventCount;
+        chip8.runFrame(expected.cycles);
+        chip8.saveCheckpoint(actual);
+        std::string difference = describeCheckpointDifference(expected, actual);
+        if (!difference.empty()) {
+            std::printf("frame %lu differs:\n%s", frame, difference.c_str());
+            return 2;
+        }
+        ++frame;
+    }
+    if (!log.good()) {
+        std::fprintf(stderr, "%s after frame %lu\n", log.error().c_str(), frame);
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%lu frames match (%.0f frames/s)\n", frame, seconds > 0 ? frame / seconds : 0.0);
+    return 0;
+}
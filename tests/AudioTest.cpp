@@ -0,0 +1,85 @@
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+#include "core/AudioFrontend.hpp"
+#include "core/Chip8.hpp"
+#include "core/NullFrontend.hpp"
+
+// A fixed buzzer pattern rendered offline must come out sample for sample
+// the same on every run and every host: the hash and count below are the
+// golden values chip8_batch --audio regression runs rely on. The same run
+// written to a WAV file must hold exactly the samples hashed.
+
+#define FRAMES 120
+#define CYCLES_PER_FRAME 1000
+#define EXPECTED_SAMPLES 88200ul
+#define EXPECTED_HASH 0xDBFEB571DD39A725ULL
+#define WAV_PATH "AudioTest.wav"
+#define WAV_HEADER_SIZE 44
+
+// Beeps for 5 frames, then waits 10 on the delay timer, over and over.
+static const unsigned char program[] = {
+        0x60, 0x05,     // 200: V0 = 5
+        0xF0, 0x18,     // 202: sound = V0
+        0x61, 0x0A,     // 204: V1 = 10
+        0xF1, 0x15,     // 206: delay = V1
+        0xF1, 0x07,     // 208: V1 = delay
+        0x31, 0x00,     // 20A: skip if V1 == 0
+        0x12, 0x08,     // 20C: goto 208
+        0x12, 0x00,     // 20E: goto 200
+};
+
+// Runs the pattern through audio. False if the ROM does not load.
+static bool render(AudioFrontend &audio)
+{
+    Chip8 chip8;
+
+    if (!chip8.loadRom(program, sizeof(program)))
+        return false;
+    chip8.setFrontend(audio);
+    for (int frame = 0; frame < FRAMES; ++frame)
+        chip8.runFrame(CYCLES_PER_FRAME);
+    audio.flush();
+    return true;
+}
+
+int main()
+{
+    NullFrontend null;
+    AudioFrontend audio(null, AUDIO_SAMPLE_RATE, 0);
+    if (!render(audio)) {
+        std::printf("the buzzer ROM does not load\n");
+        return 1;
+    }
+    if (audio.renderedSamples() != EXPECTED_SAMPLES || audio.sampleHash() != EXPECTED_HASH) {
+        std::printf("expected %lu samples hashing to %016" PRIx64 ", got %lu hashing to %016" PRIx64 "\n",
+                    EXPECTED_SAMPLES, static_cast<std::uint64_t>(EXPECTED_HASH),
+                    audio.renderedSamples(), audio.sampleHash());
+        return 1;
+    }
+
+    WavWriter wav(WAV_PATH, AUDIO_SAMPLE_RATE);
+    AudioFrontend recorded(null);
+    recorded.setWavWriter(&wav);
+    if (!render(recorded) || !wav.close()) {
+        std::printf("could not write %s\n", WAV_PATH);
+        return 1;
+    }
+    std::FILE *file = std::fopen(WAV_PATH, "rb");
+    std::vector<unsigned char> bytes;
+    if (file != nullptr) {
+        unsigned char buffer[4096];
+        std::size_t count;
+        while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            bytes.insert(bytes.end(), buffer, buffer + count);
+        std::fclose(file);
+    }
+    std::remove(WAV_PATH);
+    if (bytes.size() != WAV_HEADER_SIZE + 2 * EXPECTED_SAMPLES ||
+        fnv1a64(bytes.data() + WAV_HEADER_SIZE, bytes.size() - WAV_HEADER_SIZE) != EXPECTED_HASH) {
+        std::printf("%s holds %zu bytes, not the %lu samples hashed\n", WAV_PATH, bytes.size(), EXPECTED_SAMPLES);
+        return 1;
+    }
+    std::printf("%lu samples, hash %016" PRIx64 "\n", audio.renderedSamples(), audio.sampleHash());
+    return 0;
+}
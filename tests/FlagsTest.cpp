@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <memory>
+#include "core/Chip8.hpp"
+#include "core/Lockstep.hpp"
+
+// 8XY4 to 8XYE under every quirk profile, through step(), runCycles and
+// a lockstep lane, against VX and VF worked out by hand. The default
+// profile keeps the flags this interpreter always set; the others set VF
+// last, 0 or 1, from the operands as they were. y or x being F is where
+// the two differ most.
+
+#define CYCLES 5
+
+struct Expected {
+    unsigned char vx;
+    unsigned char vf;
+};
+
+struct FlagCase {
+    const char *name;
+    unsigned short opcode;
+    unsigned char v1;
+    unsigned char v2;
+    unsigned char vf;
+    // The default profile, the profiles shifting VY (VIP, XO-CHIP), then
+    // those shifting VX in place (CHIP-48, SUPER-CHIP). VX is V1, or VF
+    // itself when the opcode's x is F.
+    Expected baseline;
+    Expected shiftsVY;
+    Expected shiftsVX;
+};
+
+static const FlagCase cases[] = {
+        {"8124 carry", 0x8124, 0xFF, 0x02, 0x00, {0x01, 0x00}, {0x01, 0x01}, {0x01, 0x01}},
+        {"8124", 0x8124, 0x10, 0x20, 0x55, {0x30, 0x00}, {0x30, 0x00}, {0x30, 0x00}},
+        {"8125", 0x8125, 0x30, 0x10, 0x55, {0x20, 0x01}, {0x20, 0x01}, {0x20, 0x01}},
+        {"8125 borrow", 0x8125, 0x10, 0x30, 0x55, {0xE0, 0x00}, {0xE0, 0x00}, {0xE0, 0x00}},
+        {"8125 equal", 0x8125, 0x10, 0x10, 0x55, {0x00, 0x01}, {0x00, 0x01}, {0x00, 0x01}},
+        {"8127", 0x8127, 0x10, 0x30, 0x55, {0x20, 0x01}, {0x20, 0x01}, {0x20, 0x01}},
+        {"8127 borrow", 0x8127, 0x30, 0x10, 0x55, {0xE0, 0x00}, {0xE0, 0x00}, {0xE0, 0x00}},
+        {"8126", 0x8126, 0x05, 0x0C, 0x55, {0x02, 0x01}, {0x06, 0x00}, {0x02, 0x01}},
+        {"812E", 0x812E, 0x81, 0x40, 0x55, {0x02, 0x00}, {0x80, 0x00}, {0x02, 0x01}},
+        {"812E bit 6", 0x812E, 0x41, 0xC0, 0x55, {0x82, 0x80}, {0x80, 0x01}, {0x82, 0x00}},
+        {"81F6", 0x81F6, 0x00, 0x00, 0x03, {0x00, 0x00}, {0x01, 0x01}, {0x00, 0x00}},
+        {"81FE", 0x81FE, 0x00, 0x00, 0x81, {0x00, 0x00}, {0x02, 0x01}, {0x00, 0x00}},
+        {"8F24", 0x8F24, 0x00, 0x02, 0xFF, {0x02, 0x02}, {0x01, 0x01}, {0x01, 0x01}},
+        {"8F25", 0x8F25, 0x00, 0x20, 0x10, {0xE0, 0xE0}, {0x00, 0x00}, {0x00, 0x00}},
+        {"8F16", 0x8F16, 0x03, 0x00, 0x04, {0x00, 0x00}, {0x01, 0x01}, {0x00, 0x00}},
+};
+
+static const Expected &expected(const FlagCase &flagCase, QuirkProfile profile)
+{
+    if (profile == QUIRKS_DEFAULT)
+        return flagCase.baseline;
+    return quirkSettings(profile).shiftReadsVY ? flagCase.shiftsVY : flagCase.shiftsVX;
+}
+
+static bool check(const FlagCase &flagCase, QuirkProfile profile, const char *path, const Chip8 &chip8)
+{
+    FrameCheckpoint checkpoint;
+    chip8.saveCheckpoint(checkpoint);
+    const Expected &want = expected(flagCase, profile);
+    unsigned char vx = (flagCase.opcode & 0x0F00) == 0x0F00 ? checkpoint.reg[0xF] : checkpoint.reg[1];
+
+    if (vx == want.vx && checkpoint.reg[0xF] == want.vf)
+        return true;
+    std::printf("%s, %s quirks, %s: expected VX %02X VF %02X, got VX %02X VF %02X\n", flagCase.name,
+                quirkProfileNames[profile], path, want.vx, want.vf, vx, checkpoint.reg[0xF]);
+    return false;
+}
+
+int main()
+{
+    unsigned int failures = 0;
+
+    for (const FlagCase &flagCase : cases) {
+        const unsigned char program[] = {
+                0x61, flagCase.v1,                                          // 200: V1 = v1
+                0x62, flagCase.v2,                                          // 202: V2 = v2
+                0x6F, flagCase.vf,                                          // 204: VF = vf
+                static_cast<unsigned char>(flagCase.opcode >> 8),
+                static_cast<unsigned char>(flagCase.opcode & 0xFF),         // 206: the case
+                0x12, 0x08,                                                 // 208: goto 208
+        };
+        for (int profile = 0; profile < QUIRK_PROFILE_COUNT; ++profile) {
+            QuirkProfile quirks = static_cast<QuirkProfile>(profile);
+            Chip8 stepped;
+            Chip8 run;
+            Chip8 lane;
+            for (Chip8 *chip8 : {&stepped, &run, &lane}) {
+                chip8->loadRom(program, sizeof(program));
+                chip8->setRecompiled(nullptr);
+                chip8->setQuirks(quirks);
+            }
+            std::unique_ptr<Lockstep> lockstep(new Lockstep(lane, 1));
+            for (int i = 0; i < CYCLES; ++i)
+                stepped.step();
+            run.runCycles(CYCLES);
+            lockstep->runCycles(CYCLES);
+            lockstep->extract(0, lane);
+
+            failures += !check(flagCase, quirks, "step", stepped);
+            failures += !check(flagCase, quirks, "runCycles", run);
+            failures += !check(flagCase, quirks, "lockstep", lane);
+        }
+    }
+    std::printf("%zu cases x %d quirk profiles, %u failed\n", sizeof(cases) / sizeof(cases[0]), QUIRK_PROFILE_COUNT,
+                failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "batch/JobServer.hpp"
+#include "core/Checkpoint.hpp"
+#include "core/ScriptedFrontend.hpp"
+
+// JobServer in process on a socket of its own, with this side as the
+// client: a job's response against the same job run here, then a deadline
+// running out, a header the server cannot frame, a request stalling
+// halfway and a connection past the limit, each with the response or the
+// end of stream it must get.
+
+#define CYCLES_PER_FRAME 100
+#define MAX_CONNECTIONS 2
+#define RECEIVE_TIMEOUT_MILLISECONDS 200
+
+// Draws its sprite from the ROM itself, then idles.
+static const unsigned char rom[] = {
+        0x00, 0xE0, 0x60, 0x05, 0x61, 0x07, 0x80, 0x14, 0xA2, 0x00, 0xD0, 0x15, 0x12, 0x0C
+};
+static const char script[] = "0 4 down\n2 4 up\n";
+
+typedef std::chrono::steady_clock Clock;
+
+static JobRequestHeader requestFor(std::uint64_t cycles, std::uint32_t timeoutMilliseconds)
+{
+    JobRequestHeader header{};
+
+    std::memcpy(header.magic, JOB_REQUEST_MAGIC, 4);
+    header.version = JOB_PROTOCOL_VERSION;
+    header.cycles = cycles;
+    header.seed = 7;
+    header.timeoutMilliseconds = timeoutMilliseconds;
+    header.romSize = sizeof(rom);
+    header.scriptSize = sizeof(script) - 1;
+    return header;
+}
+
+static bool connectTo(const std::string &socketPath, int &fd)
+{
+    std::string error;
+
+    fd = connectJobServer(socketPath, error);
+    if (fd < 0) {
+        std::printf("connect: %s\n", error.c_str());
+        return false;
+    }
+    // A server that never answers fails the case instead of hanging it.
+    timeval timeout{};
+    timeout.tv_sec = 5;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+// The server closed the connection: the next read finds the end.
+static bool closedByServer(int fd)
+{
+    char byte;
+    return recv(fd, &byte, 1, 0) == 0;
+}
+
+// The job as JobServer::runJob runs it, on a machine of its own.
+static bool checkResponse(const JobRequestHeader &header, const JobResponse &response)
+{
+    std::vector<InputEvent> events;
+    std::istringstream in(script);
+    parseInputScript(in, events);
+    ScriptedFrontend frontend(std::move(events));
+    Chip8 chip8;
+    std::uint64_t cycles = 0;
+    std::uint64_t frames = 0;
+
+    chip8.loadRom(rom, sizeof(rom));
+    chip8.setFrontend(frontend);
+    chip8.setSeed(header.seed);
+    for (std::uint64_t budget = 0; budget < header.cycles; budget += CYCLES_PER_FRAME, ++frames)
+        cycles += chip8.runFrame(CYCLES_PER_FRAME);
+
+    FrameCheckpoint expected;
+    chip8.saveCheckpoint(expected);
+    bool same = response.status == JOB_OK && response.cycles == cycles && response.frames == frames &&
+                response.framebufferHash == expected.displayHash && response.programCounter == expected.programCounter &&
+                response.indexRegister == expected.indexRegister &&
+                std::memcmp(response.reg, expected.reg, sizeof(response.reg)) == 0;
+    if (!same)
+        std::printf("round trip: status %s, %llu cycles, %llu frames, hash %016llx, PC %03X; expected ok, %llu, %llu, "
+                    "%016llx, %03X\n", jobStatusNames[response.status % JOB_STATUS_COUNT],
+                    static_cast<unsigned long long>(response.cycles), static_cast<unsigned long long>(response.frames),
+                    static_cast<unsigned long long>(response.framebufferHash), response.programCounter,
+                    static_cast<unsigned long long>(cycles), static_cast<unsigned long long>(frames),
+                    static_cast<unsigned long long>(expected.displayHash), expected.programCounter);
+    return same;
+}
+
+// A job, then one with a deadline it cannot meet, on the same connection.
+static bool runJobs(const std::string &socketPath)
+{
+    int fd;
+    if (!connectTo(socketPath, fd))
+        return false;
+
+    JobResponse response{};
+    JobRequestHeader header = requestFor(10 * CYCLES_PER_FRAME, 0);
+    bool ok = runRemoteJob(fd, header, rom, script, response) && checkResponse(header, response);
+    if (ok) {
+        header = requestFor(~0ull >> 1, 20);
+        ok = runRemoteJob(fd, header, rom, script, response) && response.status == JOB_TIMEOUT &&
+             response.frames > 0 && response.cycles < header.cycles;
+        if (!ok)
+            std::printf("deadline: status %s after %llu frames\n", jobStatusNames[response.status % JOB_STATUS_COUNT],
+                        static_cast<unsigned long long>(response.frames));
+    } else {
+        std::printf("round trip failed\n");
+    }
+    close(fd);
+    return ok;
+}
+
+// A header with the wrong magic, and one with a ROM too large to frame:
+// each gets JOB_BAD_REQUEST, then the end of the stream.
+static bool badRequests(const std::string &socketPath)
+{
+    JobRequestHeader headers[2] = {requestFor(1, 0), requestFor(1, 0)};
+    headers[0].magic[0] = 'X';
+    headers[1].romSize = MAX_ROM_SIZE + 1;
+
+    for (const JobRequestHeader &header : headers) {
+        int fd;
+        JobResponse response{};
+        if (!connectTo(socketPath, fd))
+            return false;
+        bool ok = sendAll(fd, &header, sizeof(header)) && receiveAll(fd, &response, sizeof(response)) &&
+                  response.status == JOB_BAD_REQUEST && closedByServer(fd);
+        close(fd);
+        if (!ok) {
+            std::printf("bad request: status %s, or the connection stayed open\n",
+                        jobStatusNames[response.status % JOB_STATUS_COUNT]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Half a ROM, then nothing: dropped once the receive timeout runs out.
+static bool stalledRequest(const std::string &socketPath)
+{
+    int fd;
+    if (!connectTo(socketPath, fd))
+        return false;
+
+    JobRequestHeader header = requestFor(1, 0);
+    Clock::time_point start = Clock::now();
+    bool ok = sendAll(fd, &header, sizeof(header)) && sendAll(fd, rom, sizeof(rom) / 2) && closedByServer(fd);
+    long milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    close(fd);
+    if (!ok || milliseconds < RECEIVE_TIMEOUT_MILLISECONDS / 2) {
+        std::printf("stalled request: %s after %ld ms\n", ok ? "dropped" : "not dropped", milliseconds);
+        return false;
+    }
+    return true;
+}
+
+// MAX_CONNECTIONS served, the next one turned away busy until one of them
+// goes.
+static bool connectionLimit(const std::string &socketPath)
+{
+    int held[MAX_CONNECTIONS];
+    JobResponse response{};
+    bool ok = true;
+
+    for (int &fd : held) {
+        // A job through each, so the server has taken them all.
+        JobRequestHeader header = requestFor(CYCLES_PER_FRAME, 0);
+        ok = ok && connectTo(socketPath, fd) && runRemoteJob(fd, header, rom, script, response);
+    }
+    int extra;
+    if (ok && connectTo(socketPath, extra)) {
+        ok = receiveAll(extra, &response, sizeof(response)) && response.status == JOB_BUSY && closedByServer(extra);
+        if (!ok)
+            std::printf("connection past the limit: status %s, or the connection stayed open\n",
+                        jobStatusNames[response.status % JOB_STATUS_COUNT]);
+        close(extra);
+    }
+    close(held[0]);
+
+    // The server notices the close on its own time.
+    bool served = false;
+    for (int attempt = 0; ok && !served && attempt < 200; ++attempt) {
+        JobRequestHeader header = requestFor(CYCLES_PER_FRAME, 0);
+        if (!connectTo(socketPath, extra))
+            return false;
+        served = runRemoteJob(extra, header, rom, script, response) && response.status == JOB_OK;
+        close(extra);
+        if (!served)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (ok && !served)
+        std::printf("connection limit: still busy after a connection closed\n");
+    for (int i = 1; i < MAX_CONNECTIONS; ++i)
+        close(held[i]);
+    return ok && served;
+}
+
+int main()
+{
+    std::string socketPath = "/tmp/chip8-jobserver-test-" + std::to_string(getpid()) + ".sock";
+    JobServerOptions options;
+    options.workers = 1;
+    options.maxConnections = MAX_CONNECTIONS;
+    options.receiveTimeoutMilliseconds = RECEIVE_TIMEOUT_MILLISECONDS;
+    options.cyclesPerFrame = CYCLES_PER_FRAME;
+    JobServer server(options);
+    std::string error;
+
+    if (!server.listen(socketPath, error)) {
+        std::printf("%s\n", error.c_str());
+        return 1;
+    }
+    std::thread serving(&JobServer::run, &server);
+    unsigned int failures = 0;
+    failures += !runJobs(socketPath);
+    failures += !badRequests(socketPath);
+    failures += !stalledRequest(socketPath);
+    failures += !connectionLimit(socketPath);
+    server.stop();
+    serving.join();
+
+    JobServerStatistics statistics = server.statistics();
+    if (statistics.timedOut != 1 || statistics.rejected == 0) {
+        std::printf("statistics: %llu timed out, %llu turned away busy\n",
+                    static_cast<unsigned long long>(statistics.timedOut),
+                    static_cast<unsigned long long>(statistics.rejected));
+        ++failures;
+    }
+    std::printf("4 cases and the statistics, %u failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "core/Lockstep.hpp"
+#include "TestRoms.hpp"
+
+// Lockstep lanes against scalar machines over the test ROM corpus under
+// every quirk profile. Each lane has its own seed and its own key presses,
+// so lanes split at random draws and key tests and have to regroup; after
+// every frame each lane must be bit-identical to a scalar Chip8 given the
+// same seed, keys and cycles.
+
+#define LANES 16
+#define FRAMES 10
+#define CYCLES_PER_FRAME 600
+
+// Hands the machine the key events queued for the next frame.
+class KeyFrontend : public Frontend {
+    public:
+        bool isOpen() const override
+        {
+            return true;
+        }
+
+        void pollInput(InputQueue &events) override
+        {
+            for (const KeyEvent &event : pending)
+                events.push(event);
+            pending.clear();
+        }
+
+        void present(const Display &, std::uint64_t) override
+        {
+        }
+
+        void setBuzzer(bool) override
+        {
+        }
+
+        std::vector<KeyEvent> pending;
+};
+
+// Whether lane holds key down during frame: a different pattern per lane.
+static bool keyDown(unsigned int lane, unsigned int frame, unsigned char key)
+{
+    return (lane * 7 + frame * 3 + key) % 11 == 0;
+}
+
+static bool runRom(const TestRom &rom, QuirkProfile profile)
+{
+    Chip8 prototype;
+    if (!prototype.loadRom(rom.bytes.data(), rom.bytes.size())) {
+        std::printf("%s: does not load\n", rom.name.c_str());
+        return false;
+    }
+    prototype.setRecompiled(nullptr);
+    prototype.setQuirks(profile);
+    std::unique_ptr<Lockstep> lockstep(new Lockstep(prototype, LANES));
+
+    std::vector<std::unique_ptr<Chip8>> scalars;
+    std::vector<KeyFrontend> frontends(LANES);
+    for (unsigned int lane = 0; lane < LANES; ++lane) {
+        scalars.emplace_back(new Chip8);
+        scalars[lane]->loadRom(rom.bytes.data(), rom.bytes.size());
+        scalars[lane]->setRecompiled(nullptr);
+        scalars[lane]->setQuirks(profile);
+        scalars[lane]->setSeed(lane + 1);
+        scalars[lane]->setFrontend(frontends[lane]);
+        lockstep->setSeed(lane, lane + 1);
+    }
+
+    Chip8 extracted;
+    SaveState laneState;
+    SaveState scalarState;
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        for (unsigned int lane = 0; lane < LANES; ++lane) {
+            for (unsigned char key = 0; key < 16; ++key) {
+                bool pressed = keyDown(lane, frame, key);
+                if (frame == 0 ? !pressed : pressed == keyDown(lane, frame - 1, key))
+                    continue;
+                lockstep->setKey(lane, key, pressed);
+                frontends[lane].pending.push_back({0, key, pressed});
+            }
+            scalars[lane]->runFrame(CYCLES_PER_FRAME);
+        }
+        lockstep->runFrame(CYCLES_PER_FRAME);
+
+        for (unsigned int lane = 0; lane < LANES; ++lane) {
+            lockstep->extract(lane, extracted);
+            extracted.saveState(laneState);
+            scalars[lane]->saveState(scalarState);
+            if (laneState != scalarState) {
+                FrameCheckpoint expected;
+                FrameCheckpoint actual;
+                scalars[lane]->saveCheckpoint(expected);
+                extracted.saveCheckpoint(actual);
+                std::string difference = describeCheckpointDifference(expected, actual);
+                std::printf("%s, %s quirks, lane %u, frame %u:\n%s", rom.name.c_str(), quirkProfileNames[profile],
+                            lane, frame, difference.empty() ? "memory, display or stack differs\n" : difference.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::vector<TestRom> roms = testRoms(TEST_RANDOM_ROMS);
+    unsigned int failures = 0;
+
+    for (const TestRom &rom : roms) {
+        for (int profile = 0; profile < QUIRK_PROFILE_COUNT; ++profile) {
+            if (!runRom(rom, static_cast<QuirkProfile>(profile)))
+                ++failures;
+        }
+    }
+    std::printf("%zu ROMs x %d quirk profiles x %d lanes, %u failed\n", roms.size(), QUIRK_PROFILE_COUNT, LANES, failures);
+    return failures == 0 ? 0 : 1;
+}
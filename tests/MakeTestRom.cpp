@@ -0,0 +1,26 @@
+#include <cstdio>
+#include <fstream>
+#include "TestRoms.hpp"
+
+// Writes one ROM of the test corpus to a file, for the build to recompile.
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <rom name> <output>\n", argv[0]);
+        return 1;
+    }
+    for (const TestRom &rom : testRoms(TEST_RANDOM_ROMS)) {
+        if (rom.name != argv[1])
+            continue;
+        std::ofstream out(argv[2], std::ios::binary);
+        out.write(reinterpret_cast<const char *>(rom.bytes.data()), rom.bytes.size());
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+        return 0;
+    }
+    std::fprintf(stderr, "no test ROM named %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "TestRoms.hpp"
+
+// Each ROM named on the command line, recompiled into this test by the
+// build, against the same ROM interpreted: the frame checkpoints chip8_verify
+// compares, and the whole save state, after every frame.
+
+#define FRAMES 120
+#define CYCLES_PER_FRAME 1000
+
+static bool runRom(const TestRom &rom)
+{
+    Chip8 recompiled;
+    Chip8 interpreted;
+
+    if (!recompiled.loadRom(rom.bytes.data(), rom.bytes.size()) ||
+        !interpreted.loadRom(rom.bytes.data(), rom.bytes.size())) {
+        std::printf("%s: does not load\n", rom.name.c_str());
+        return false;
+    }
+    if (!recompiled.isRecompiled()) {
+        std::printf("%s: not recompiled into the test\n", rom.name.c_str());
+        return false;
+    }
+    interpreted.setRecompiled(nullptr);
+    recompiled.setSeed(rom.bytes.size());
+    interpreted.setSeed(rom.bytes.size());
+
+    FrameCheckpoint expected;
+    FrameCheckpoint actual;
+    SaveState expectedState;
+    SaveState actualState;
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        recompiled.runFrame(CYCLES_PER_FRAME);
+        interpreted.runFrame(CYCLES_PER_FRAME);
+        interpreted.saveCheckpoint(expected);
+        recompiled.saveCheckpoint(actual);
+        std::string difference = describeCheckpointDifference(expected, actual);
+        interpreted.saveState(expectedState);
+        recompiled.saveState(actualState);
+        if (difference.empty() && expectedState != actualState)
+            difference = "memory, display or stack differs\n";
+        if (!difference.empty()) {
+            std::printf("%s, frame %u differs:\n%s", rom.name.c_str(), frame, difference.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<TestRom> roms = testRoms(TEST_RANDOM_ROMS);
+    unsigned int failures = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const TestRom *found = nullptr;
+        for (const TestRom &rom : roms) {
+            if (rom.name == argv[i])
+                found = &rom;
+        }
+        if (found == nullptr) {
+            std::printf("no test ROM named %s\n", argv[i]);
+            ++failures;
+        } else if (!runRom(*found)) {
+            ++failures;
+        }
+    }
+    std::printf("%d recompiled ROMs, %u failed\n", argc - 1, failures);
+    return failures == 0 ? 0 : 1;
+}
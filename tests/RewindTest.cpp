@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "core/Rewind.hpp"
+
+// Records frames into a small budget with one keyframe for the whole
+// run, so the deltas wrap over their own keyframe, then rewinds all the
+// history left and checks every frame comes back as it was.
+
+#define FRAMES 400
+#define CYCLES_PER_FRAME 200
+
+// Random digits all over the screen: every frame's XOR against the first
+// one is a good part of the display.
+static const unsigned char program[] = {
+        0xA0, 0x00,     // 200: I = 0
+        0xC0, 0x3F,     // 202: V0 = rand & 3F
+        0xC1, 0x1F,     // 204: V1 = rand & 1F
+        0xD0, 0x15,     // 206: draw 8x5 at V0, V1
+        0x72, 0x01,     // 208: V2 += 1
+        0x12, 0x02,     // 20A: goto 202
+};
+
+int main()
+{
+    Chip8 chip8;
+    if (!chip8.loadRom(program, sizeof(program)))
+        return 1;
+    chip8.setSeed(7);
+
+    Rewind rewind(16 * 1024, 1000000);
+    std::vector<SaveState> recorded(FRAMES);
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        chip8.runFrame(CYCLES_PER_FRAME);
+        chip8.saveState(recorded[frame]);
+        rewind.push(chip8);
+    }
+
+    std::size_t kept = rewind.frames();
+    if (kept == 0 || kept >= FRAMES) {
+        std::printf("expected the budget to hold part of the %d frames, it holds %zu\n", FRAMES, kept);
+        return 1;
+    }
+    SaveState restored;
+    for (std::size_t i = 0; i < kept; ++i) {
+        std::size_t frame = FRAMES - 1 - i;
+        if (!rewind.rewind(chip8)) {
+            std::printf("rewind to frame %zu failed with %zu frames kept\n", frame, kept - i);
+            return 1;
+        }
+        chip8.saveState(restored);
+        if (restored != recorded[frame]) {
+            std::printf("frame %zu differs after rewinding\n", frame);
+            return 1;
+        }
+    }
+    if (rewind.rewind(chip8) || rewind.frames() != 0) {
+        std::printf("history outlived its %zu frames\n", kept);
+        return 1;
+    }
+    std::printf("%zu of %d frames rewound\n", kept, FRAMES);
+    return 0;
+}
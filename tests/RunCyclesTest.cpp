@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/Chip8.hpp"
+#include "TestRoms.hpp"
+
+// runCycles against step() over the test ROM corpus under every quirk
+// profile. runCycles takes whatever fast path the core was built with, the
+// JIT or the block cache, and skips idle loops; step() is the plain
+// interpreter one instruction at a time. Both machines are compared after
+// every runCycles call, the calls sized at random so they end inside
+// blocks as well as between them. Halfway through the fast machine forks;
+// the child starts on the parent's translations, runs beside it, and
+// carries on alone once the parent is gone. runCycles has to return as
+// many instructions as step() ran, fewer once FX0A halts the machine.
+
+#define FRAMES 40
+#define CYCLES_PER_FRAME 1000
+#define MAX_CHUNK 64
+
+// The first field that differs, or the first differing byte of the state.
+static std::string describeDifference(const Chip8 &expected, const Chip8 &actual)
+{
+    FrameCheckpoint expectedCheckpoint;
+    FrameCheckpoint actualCheckpoint;
+    expected.saveCheckpoint(expectedCheckpoint);
+    actual.saveCheckpoint(actualCheckpoint);
+    std::string difference = describeCheckpointDifference(expectedCheckpoint, actualCheckpoint);
+    if (!difference.empty())
+        return difference;
+
+    SaveState expectedState;
+    SaveState actualState;
+    expected.saveState(expectedState);
+    actual.saveState(actualState);
+    if (expectedState == actualState)
+        return difference;
+    std::size_t i = 0;
+    while (i < expectedState.size() && i < actualState.size() && expectedState[i] == actualState[i])
+        ++i;
+    return "state byte " + std::to_string(i) + " differs (memory, display or stack)\n";
+}
+
+static bool runRom(const TestRom &rom, QuirkProfile profile)
+{
+    // The fast machine, then from halfway its fork, then the fork alone.
+    std::vector<std::unique_ptr<Chip8>> fast;
+    Chip8 reference;
+    std::uint32_t chunkState = 1;
+
+    fast.emplace_back(new Chip8());
+    for (Chip8 *chip8 : {fast[0].get(), &reference}) {
+        if (!chip8->loadRom(rom.bytes.data(), rom.bytes.size())) {
+            std::printf("%s: does not load\n", rom.name.c_str());
+            return false;
+        }
+        // Never the recompiled program a build may have for the ROM.
+        chip8->setRecompiled(nullptr);
+        chip8->setQuirks(profile);
+        chip8->setSeed(rom.bytes.size());
+    }
+
+    SaveState fastState;
+    SaveState referenceState;
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        if (frame == FRAMES / 2)
+            fast.push_back(fast[0]->fork());
+        else if (frame == FRAMES * 3 / 4)
+            fast.erase(fast.begin());
+        unsigned long cycles = 0;
+        while (cycles < CYCLES_PER_FRAME) {
+            chunkState = chunkState * 1103515245u + 12345u;
+            unsigned long chunk = std::min<unsigned long>(1 + (chunkState >> 8) % MAX_CHUNK, CYCLES_PER_FRAME - cycles);
+            // The fork first, so it is the side copying the code it shares
+            // and the one left running on the copy.
+            unsigned long run[2] = {};
+            for (std::size_t i = fast.size(); i-- > 0;)
+                run[i] = fast[i]->runCycles(chunk);
+            unsigned long stepped = 0;
+            while (stepped < chunk && !reference.isWaitingForKey()) {
+                reference.step();
+                ++stepped;
+            }
+            cycles += chunk;
+            for (std::size_t i = 0; i < fast.size(); ++i) {
+                if (run[i] != stepped) {
+                    std::printf("%s, %s quirks, frame %u, after %lu cycles: runCycles ran %lu, step() %lu\n",
+                                rom.name.c_str(), quirkProfileNames[profile], frame, cycles, run[i], stepped);
+                    return false;
+                }
+            }
+
+            reference.saveState(referenceState);
+            for (const std::unique_ptr<Chip8> &chip8 : fast) {
+                chip8->saveState(fastState);
+                if (fastState != referenceState) {
+                    std::printf("%s, %s quirks, frame %u, after %lu cycles%s:\n%s", rom.name.c_str(),
+                                quirkProfileNames[profile], frame, cycles, frame < FRAMES / 2 ? "" : chip8 == fast.back() ? ", forked" : ", parent",
+                                describeDifference(reference, *chip8).c_str());
+                    return false;
+                }
+            }
+        }
+        for (std::unique_ptr<Chip8> &chip8 : fast)
+            chip8->tickTimers();
+        reference.tickTimers();
+    }
+    return true;
+}
+
+int main()
+{
+    std::vector<TestRom> roms = testRoms(TEST_RANDOM_ROMS);
+    unsigned int failures = 0;
+
+    for (const TestRom &rom : roms) {
+        for (int profile = 0; profile < QUIRK_PROFILE_COUNT; ++profile) {
+            if (!runRom(rom, static_cast<QuirkProfile>(profile)))
+                ++failures;
+        }
+    }
+    std::printf("%zu ROMs x %d quirk profiles, %u failed\n", roms.size(), QUIRK_PROFILE_COUNT, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+#ifndef NESEMULATOR_TESTROMS_HPP
+#define NESEMULATOR_TESTROMS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Random ROMs in the corpus the tests share.
+#define TEST_RANDOM_ROMS 40
+
+// The ROM corpus the equivalence tests run every execution path over:
+// hand-written programs aimed at what the fast paths special-case, then
+// random ones built from the opcodes real programs use.
+
+struct TestRom {
+    std::string name;
+    std::vector<unsigned char> bytes;
+};
+
+inline std::vector<unsigned char> romBytes(const std::vector<unsigned short> &program)
+{
+    std::vector<unsigned char> rom;
+
+    for (unsigned short word : program) {
+        rom.push_back(word >> 8);
+        rom.push_back(word & 0xFF);
+    }
+    return rom;
+}
+
+inline const std::vector<TestRom> &handWrittenRoms()
+{
+    static const std::vector<TestRom> roms = {
+            {"alu", romBytes({
+                    0x6001,         // 200: V0 = 1
+                    0x7101,         // 202: V1 += 1
+                    0x8014,         //      V0 += V1
+                    0x8213,         //      V2 ^= V1
+                    0x8322,         //      V3 &= V2
+                    0x8431,         //      V4 |= V3
+                    0x8505,         //      V5 -= V0
+                    0x8616,         //      V6 >>= 1
+                    0x8767,         //      V7 = V6 - V7
+                    0x881E,         //      V8 <<= 1
+                    0x1202,         //      goto 202
+            })},
+            {"branch", romBytes({
+                    0x7001,         // 200: V0 += 1
+                    0x3080,         // 202: skip if V0 == 0x80
+                    0x120A,         // 204: goto 20A
+                    0x6000,         // 206: V0 = 0
+                    0x1200,         // 208: goto 200
+                    0x4100,         // 20A: skip if V1 != 0
+                    0x7102,         // 20C: V1 += 2
+                    0x5010,         // 20E: skip if V0 == V1
+                    0x9010,         // 210: skip if V0 != V1
+                    0x1200,         // 212: goto 200
+                    0x1200,         // 214: goto 200
+            })},
+            {"sprite", romBytes({
+                    0x6000,         // 200: V0 = 0
+                    0x6100,         // 202: V1 = 0
+                    0xA000,         // 204: I = glyph "0"
+                    0xD015,         // 206: draw 8x5 at V0, V1
+                    0x7007,         // 208: V0 += 7
+                    0x7103,         // 20A: V1 += 3
+                    0x3F01,         // 20C: skip if VF == 1
+                    0x1204,         // 20E: goto 204
+                    0x00E0,         // 210: clear
+                    0x1204,         // 212: goto 204
+            })},
+            {"memory", romBytes({
+                    0xA300,         // 200: I = 300
+                    0x7001,         // 202: V0 += 1
+                    0xF033,         // 204: BCD V0 at I
+                    0xF355,         // 206: dump V0-V3
+                    0xF365,         // 208: load V0-V3
+                    0xF01E,         //      I += V0
+                    0xF133,         //      BCD V1 at I
+                    0x1200,         //      goto 200
+            })},
+            // Waits out the delay timer, the idle loop skipIdleLoop looks for.
+            {"idle", romBytes({
+                    0x6005,         // 200: V0 = 5
+                    0xF015,         // 202: delay = V0
+                    0xF007,         // 204: V0 = delay
+                    0x3000,         // 206: skip if V0 == 0
+                    0x1204,         // 208: goto 204
+                    0x7101,         // 20A: V1 += 1
+                    0x1200,         // 20C: goto 200
+            })},
+            {"calls", romBytes({
+                    0x2208,         // 200: call 208
+                    0x7101,         // 202: V1 += 1
+                    0x220C,         // 204: call 20C
+                    0x1200,         // 206: goto 200
+                    0x7201,         // 208: V2 += 1
+                    0x00EE,         // 20A: return
+                    0x8124,         // 20C: V1 += V2
+                    0x00EE,         // 20E: return
+            })},
+            // Halts in FX0A until a key goes down, none does in tests
+            // that do not press any.
+            {"keywait", romBytes({
+                    0xF30A,         // 200: V3 = next key
+                    0x8434,         // 202: V4 += V3
+                    0xE39E,         // 204: skip if key V3 is down
+                    0x1200,         // 206: goto 200
+                    0x7501,         // 208: V5 += 1
+                    0x1204,         // 20A: goto 204
+            })},
+            // Patches the instruction at 212 every time round the loop,
+            // alternating V1 += rr and V1 = rr with a random rr, so
+            // anything translated from it must be dropped each time.
+            {"selfmod", romBytes({
+                    0x6071,         // 200: V0 = 71
+                    0x6510,         // 202: V5 = 10
+                    0xA212,         // 204: I = 212
+                    0xC1FF,         // 206: V1 = rand
+                    0xF155,         // 208: [212] = V0, [213] = V1
+                    0x8053,         // 20A: V0 ^= V5
+                    0x7301,         // 20C: V3 += 1
+                    0x1212,         // 20E: goto 212
+                    0x1200,         // 210: not reached
+                    0x7100,         // 212: V1 += 0, patched
+                    0x8414,         // 214: V4 += V1
+                    0x1204,         // 216: goto 204
+            })},
+            // Every run the block cache fuses into a superinstruction,
+            // the skips both taken and not.
+            {"fused", romBytes({
+                    0x6000,         // 200: V0 = 0
+                    0x6105,         // 202: V1 = 5
+                    0x6208,         // 204: V2 = 8
+                    0xA000,         // 206: I = glyph "0"
+                    0xD125,         // 208: draw 8x5 at V1, V2
+                    0xA300,         // 20A: I = 300
+                    0xF265,         // 20C: load V0-V2
+                    0xF31E,         // 20E: I += V3
+                    0xF065,         // 210: load V0
+                    0x7301,         // 212: V3 += 1
+                    0x3340,         // 214: skip if V3 == 40
+                    0x1212,         // 216: goto 212
+                    0x7401,         // 218: V4 += 1
+                    0x4420,         // 21A: skip if V4 != 20
+                    0x1200,         // 21C: goto 200
+                    0x7501,         // 21E: V5 += 1
+                    0x1218,         // 220: goto 218
+            })},
+            // A jump table through BNNN, BXNN under the SUPER-CHIP quirks.
+            {"bnnn", romBytes({
+                    0xC003,         // 200: V0 = rand & 3
+                    0x8004,         // 202: V0 += V0
+                    0xB208,         // 204: goto 208 + V0
+                    0x1200,         // 206: not reached
+                    0x1210,         // 208: case 0
+                    0x1214,         // 20A: case 1
+                    0x1218,         // 20C: case 2
+                    0x121C,         // 20E: case 3
+                    0x7101,         // 210: V1 += 1
+                    0x1200,         // 212: goto 200
+                    0x7201,         // 214: V2 += 1
+                    0x1200,         // 216: goto 200
+                    0x7301,         // 218: V3 += 1
+                    0x1200,         // 21A: goto 200
+                    0x7401,         // 21C: V4 += 1
+                    0x1200,         // 21E: goto 200
+            })},
+    };
+    return roms;
+}
+
+// size instructions, the last two jumps back to the start so no skip can
+// run off the end. Jumps and calls land on instructions and I stays in a
+// data area past the program; "selfmod" is the one that writes over its
+// own code. No 00EE, which would return to wherever the stack has wrapped
+// to, and no FX0A: nothing presses a key.
+inline std::vector<unsigned char> randomRom(std::uint32_t seed, unsigned int size = 96)
+{
+    std::uint32_t state = seed * 2654435761u + 1;
+    auto next = [&state](std::uint32_t range) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 8) % range;
+    };
+    // The program ends up at least size - 1 instructions long.
+    auto target = [&] {
+        return 0x200 + 2 * next(size - 1);
+    };
+    std::vector<unsigned short> program;
+    const unsigned int dataArea = 0x200 + 2 * size;
+
+    // Room for the closing jumps after an ANNN FX55 pair.
+    while (program.size() + 4 <= size) {
+        unsigned int x = next(16);
+        unsigned int y = next(16);
+        unsigned int nn = next(256);
+        static const unsigned int aluOps[] = {0, 1, 2, 3, 4, 5, 6, 7, 0xE};
+        switch (next(24)) {
+            case 0: case 1: case 2:
+                program.push_back(0x6000 | x << 8 | nn);
+                break;
+            case 3: case 4: case 5:
+                program.push_back(0x7000 | x << 8 | nn);
+                break;
+            case 6: case 7: case 8: case 9:
+                program.push_back(0x8000 | x << 8 | y << 4 | aluOps[next(9)]);
+                break;
+            case 10:
+                program.push_back(0x3000 | x << 8 | nn);
+                break;
+            case 11:
+                program.push_back(0x4000 | x << 8 | nn);
+                break;
+            case 12:
+                program.push_back((next(2) ? 0x5000 : 0x9000) | x << 8 | y << 4);
+                break;
+            case 13:
+                program.push_back(0x1000 | target());
+                break;
+            case 14:
+                program.push_back(0x2000 | target());
+                break;
+            case 15:
+                program.push_back(0xA000 | (dataArea + next(0x100)));
+                break;
+            case 16:
+                program.push_back(0xF01E | x << 8);
+                break;
+            case 17:
+                program.push_back(0xC000 | x << 8 | nn);
+                break;
+            case 18:
+                program.push_back(0xD000 | x << 8 | y << 4 | next(16));
+                break;
+            case 19: {
+                static const unsigned short timers[] = {0xF007, 0xF015, 0xF018, 0xF029};
+                program.push_back(timers[next(4)] | x << 8);
+                break;
+            }
+            case 20: {
+                static const unsigned short memoryOps[] = {0xF033, 0xF055, 0xF065};
+                // FX1E may have taken I anywhere since.
+                program.push_back(0xA000 | (dataArea + next(0x100)));
+                program.push_back(memoryOps[next(3)] | x << 8);
+                break;
+            }
+            case 21:
+                program.push_back((next(2) ? 0xE09E : 0xE0A1) | x << 8);
+                break;
+            case 22: {
+                static const unsigned short screenOps[] = {0x00E0, 0x00FB, 0x00FC, 0x00FE, 0x00FF, 0x00C3};
+                program.push_back(screenOps[next(6)]);
+                break;
+            }
+            default:
+                program.push_back(0xF075 | (x & 7) << 8);
+                break;
+        }
+    }
+    program.push_back(0x1200);
+    program.push_back(0x1200);
+    return romBytes(program);
+}
+
+// Every hand-written ROM then count random ones.
+inline std::vector<TestRom> testRoms(unsigned int count)
+{
+    std::vector<TestRom> roms = handWrittenRoms();
+
+    for (unsigned int i = 0; i < count; ++i)
+        roms.push_back({"random" + std::to_string(i), randomRom(i + 1)});
+    return roms;
+}
+
+#endif //NESEMULATOR_TESTROMS_HPP
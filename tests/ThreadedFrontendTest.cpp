@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "core/RecordingFrontend.hpp"
+#include "core/ThreadedFrontend.hpp"
+
+// ThreadedFrontend over a RecordingFrontend standing in for the display,
+// keeping up and stalled. Frame k carries k in its top row and a bar on a
+// row of its own, so every frame received says which one it was. What
+// arrives must be presented frames in order, none twice, each exactly as
+// presented, with the rows that differ from the frame shown before it,
+// and the last one presented always last.
+
+#define FRAMES 200
+
+static Display frameFor(unsigned long sequence)
+{
+    Display display;
+
+    display.planes[0][0][0] = sequence;
+    display.planes[0][1 + sequence % (SCREEN_HEIGHT - 1)][0] = ~0ull;
+    return display;
+}
+
+static bool sameDisplay(const Display &a, const Display &b)
+{
+    return a.width == b.width && a.height == b.height && std::memcmp(a.planes, b.planes, sizeof(a.planes)) == 0;
+}
+
+// Presents FRAMES frames paceMicroseconds apart to a presenter taking
+// presentDelay per frame. expectSkips: it is too slow to be shown them all.
+static bool runCase(const char *name, std::chrono::microseconds presentDelay, unsigned int paceMicroseconds,
+                    bool expectSkips)
+{
+    RecordingFrontend recorder(presentDelay);
+    {
+        ThreadedFrontend threaded(recorder);
+        Display previous;
+        for (unsigned long sequence = 1; sequence <= FRAMES; ++sequence) {
+            Display display = frameFor(sequence);
+            std::uint64_t changedRows = 0;
+            for (unsigned int row = 0; row < display.height; ++row)
+                if (!display.sameRow(previous, row))
+                    changedRows |= 1ull << row;
+            threaded.present(display, changedRows);
+            previous = display;
+            if (paceMicroseconds > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(paceMicroseconds));
+        }
+    }
+
+    const std::vector<RecordedFrame> &frames = recorder.frames();
+    unsigned long last = 0;
+    const Display *shown = nullptr;
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const RecordedFrame &frame = frames[i];
+        unsigned long sequence = frame.display.planes[0][0][0];
+
+        if (sequence <= last || sequence > FRAMES) {
+            std::printf("%s: frame %zu received is presented frame %lu, after %lu\n", name, i, sequence, last);
+            return false;
+        }
+        if (!sameDisplay(frame.display, frameFor(sequence))) {
+            std::printf("%s: presented frame %lu arrived with other contents\n", name, sequence);
+            return false;
+        }
+        std::uint64_t changedRows = 0;
+        for (unsigned int row = 0; row < frame.display.height; ++row)
+            if (shown == nullptr || !frame.display.sameRow(*shown, row))
+                changedRows |= 1ull << row;
+        if (frame.changedRows != changedRows) {
+            std::printf("%s: presented frame %lu arrived with changed rows %016llx, expected %016llx\n", name,
+                        sequence, static_cast<unsigned long long>(frame.changedRows),
+                        static_cast<unsigned long long>(changedRows));
+            return false;
+        }
+        last = sequence;
+        shown = &frame.display;
+    }
+    if (last != FRAMES) {
+        std::printf("%s: the last frame received is %lu, not the last presented %d\n", name, last, FRAMES);
+        return false;
+    }
+    if (expectSkips && frames.size() == FRAMES) {
+        std::printf("%s: a stalled presenter received every frame\n", name);
+        return false;
+    }
+    std::printf("%s: %zu of %d frames received\n", name, frames.size(), FRAMES);
+    return true;
+}
+
+int main()
+{
+    bool ok = runCase("keeping up", std::chrono::microseconds(0), 500, false);
+    ok = runCase("stalled", std::chrono::microseconds(2000), 200, true) && ok;
+    return ok ? 0 : 1;
+}